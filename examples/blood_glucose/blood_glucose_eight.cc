@@ -16,24 +16,21 @@ namespace ArithHomFA {
                                             std::vector<seal::Ciphertext> &result) {
     static bool initial = true;
     static std::vector<seal::Ciphertext> lastValuation = valuation;
-    std::array<seal::Plaintext, 2> plains;
-    this->encoder.encode(-5, this->scale, plains.front());
-    this->encoder.encode(3, this->scale, plains.back());
     if (initial) {
       // hack to prevent making transparent ciphertext
       result.at(0) = valuation.front();
       result.at(1) = valuation.front();
     } else {
-      this->evaluator.sub_plain(valuation.front(), plains.front(), result.front());
+      this->evaluator.sub_plain(valuation.front(), this->constant(-5), result.front());
       this->evaluator.sub_inplace(result.front(), lastValuation.front());
-      this->evaluator.sub_plain(valuation.front(), plains.back(), result.back());
+      this->evaluator.sub_plain(valuation.front(), this->constant(3), result.back());
       this->evaluator.sub_inplace(result.back(), lastValuation.front());
       this->evaluator.negate_inplace(result.back());
     }
     lastValuation = valuation;
     initial = false;
-    this->evaluator.mod_switch_to_inplace(result.front(), context.last_parms_id());
-    this->evaluator.mod_switch_to_inplace(result.back(), context.last_parms_id());
+    this->evaluator.mod_switch_to_inplace(result.front(), this->lastParmsId());
+    this->evaluator.mod_switch_to_inplace(result.back(), this->lastParmsId());
   }
 
   void CKKSPredicate::evalPredicateInternal(const std::vector<double> &valuation, std::vector<double> &result) {
@@ -55,4 +52,6 @@ namespace ArithHomFA {
   const std::size_t CKKSPredicate::signalSize = 1;
   const std::size_t CKKSPredicate::predicateSize = 2;
   const std::vector<double> CKKSPredicate::references = {10, 10};
+  // The constants encoded in advance
+  const PredicateConstants predicateConstants = {-5, 3};
 } // namespace ArithHomFA
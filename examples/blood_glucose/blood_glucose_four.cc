@@ -14,11 +14,9 @@ namespace ArithHomFA {
      */
     void CKKSPredicate::evalPredicateInternal(const std::vector<seal::Ciphertext> &valuation,
                                               std::vector<seal::Ciphertext> &result) {
-        seal::Plaintext plain;
-        this->encoder.encode(200, this->scale, plain);
-        this->evaluator.sub_plain(valuation.front(), plain, result.front());
+        this->evaluator.sub_plain(valuation.front(), this->constant(200), result.front());
         this->evaluator.negate_inplace(result.front());
-        this->evaluator.mod_switch_to_inplace(result.front(), context.last_parms_id());
+        this->evaluator.mod_switch_to_inplace(result.front(), this->lastParmsId());
     }
 
     void CKKSPredicate::evalPredicateInternal(const std::vector<double> &valuation,
@@ -30,4 +28,6 @@ namespace ArithHomFA {
     const std::size_t CKKSPredicate::signalSize = 1;
     const std::size_t CKKSPredicate::predicateSize = 1;
     const std::vector<double> CKKSPredicate::references = {200};
+    // The constants encoded in advance
+    const PredicateConstants predicateConstants = {200};
 }
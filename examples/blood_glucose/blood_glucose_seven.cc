@@ -14,14 +14,11 @@ namespace ArithHomFA {
      */
     void CKKSPredicate::evalPredicateInternal(const std::vector<seal::Ciphertext> &valuation,
                                               std::vector<seal::Ciphertext> &result) {
-        std::array<seal::Plaintext, 2> plains;
-        this->encoder.encode(70, this->scale, plains.front());
-        this->encoder.encode(180, this->scale, plains.back());
-        this->evaluator.sub_plain(valuation.front(), plains.front(), result.front());
-        this->evaluator.sub_plain(valuation.front(), plains.back(), result.back());
+        this->evaluator.sub_plain(valuation.front(), this->constant(70), result.front());
+        this->evaluator.sub_plain(valuation.front(), this->constant(180), result.back());
         this->evaluator.negate_inplace(result.back());
-        this->evaluator.mod_switch_to_inplace(result.front(), context.last_parms_id());
-        this->evaluator.mod_switch_to_inplace(result.back(), context.last_parms_id());
+        this->evaluator.mod_switch_to_inplace(result.front(), this->lastParmsId());
+        this->evaluator.mod_switch_to_inplace(result.back(), this->lastParmsId());
     }
 
     void CKKSPredicate::evalPredicateInternal(const std::vector<double> &valuation,
@@ -35,4 +32,6 @@ namespace ArithHomFA {
     const std::size_t CKKSPredicate::predicateSize = 2;
     // The approximate maximum value of the difference between the signal and the threshold
     const std::vector<double> CKKSPredicate::references = {300, 300};
+    // The constants encoded in advance
+    const PredicateConstants predicateConstants = {70, 180};
 }
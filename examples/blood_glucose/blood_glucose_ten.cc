@@ -14,10 +14,8 @@ namespace ArithHomFA {
      */
     void CKKSPredicate::evalPredicateInternal(const std::vector<seal::Ciphertext> &valuation,
                                               std::vector<seal::Ciphertext> &result) {
-        std::array<seal::Plaintext, 1> plains;
-        this->encoder.encode(60, this->scale, plains.front());
-        this->evaluator.sub_plain(valuation.front(), plains.front(), result.front());
-        this->evaluator.mod_switch_to_inplace(result.front(), context.last_parms_id());
+        this->evaluator.sub_plain(valuation.front(), this->constant(60), result.front());
+        this->evaluator.mod_switch_to_inplace(result.front(), this->lastParmsId());
     }
 
     void CKKSPredicate::evalPredicateInternal(const std::vector<double> &valuation,
@@ -30,4 +28,6 @@ namespace ArithHomFA {
     const std::size_t CKKSPredicate::predicateSize = 1;
     // The approximate maximum value of the difference between the signal and the threshold
     const std::vector<double> CKKSPredicate::references = {300};
+    // The constants encoded in advance
+    const PredicateConstants predicateConstants = {60};
 }
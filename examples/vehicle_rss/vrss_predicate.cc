@@ -6,6 +6,15 @@
 #include "ckks_predicate.hh"
 
 namespace ArithHomFA {
+    namespace {
+      /* Constants basically based on the setting of the simulator: */
+      const double raw_rho = 0.1;
+      const double raw_a_maxAcc = 2;
+      const double raw_a_maxBr = 9;
+      const double raw_a_minBr = 7;
+      const double raw_d_lat = 4;
+    } // namespace
+
     /*!
      * @brief Compute predicates for monitoring RSS (responsibility-sensitive safety) properties
      *
@@ -42,25 +51,17 @@ namespace ArithHomFA {
      */
     void CKKSPredicate::evalPredicateInternal(const std::vector<seal::Ciphertext> &valuation,
                                               std::vector<seal::Ciphertext> &result) {
-      /* Constants basically based on the setting of the simulator: */
-      const double raw_rho = 0.1;
-      const double raw_a_maxAcc = 2;
-      const double raw_a_maxBr = 9;
-      const double raw_a_minBr = 7;
-      const double raw_d_lat = 4;
-      seal::Plaintext
-        rho, a_maxAcc, a_maxBr, a_minBr, d_lat,
-        rho_times_a_maxAcc, half_rho_times_a_maxAcc, inv_double_a_minBr, inv_double_a_maxBr, plain_one;
-      this->encoder.encode(raw_rho, this->scale, rho);
-      this->encoder.encode(raw_a_maxAcc, this->scale, a_maxAcc);
-      this->encoder.encode(raw_a_maxBr, this->scale, a_maxBr);
-      this->encoder.encode(raw_a_minBr, this->scale, a_minBr);
-      this->encoder.encode(raw_d_lat, this->scale, d_lat);
-      this->encoder.encode(raw_rho * raw_a_maxAcc, this->scale, rho_times_a_maxAcc);
-      this->encoder.encode(raw_rho * raw_a_maxAcc / 2, this->scale, half_rho_times_a_maxAcc);
-      this->encoder.encode(1 / (2 * raw_a_minBr), this->scale, inv_double_a_minBr);
-      this->encoder.encode(1 / (2 * raw_a_maxBr), this->scale, inv_double_a_maxBr);
-      this->encoder.encode(1, this->scale, plain_one);
+      /* The constants encoded by CKKSPredicate::prepare(): */
+      const seal::Plaintext &rho = this->constant(raw_rho);
+      const seal::Plaintext &a_maxAcc = this->constant(raw_a_maxAcc);
+      const seal::Plaintext &a_maxBr = this->constant(raw_a_maxBr);
+      const seal::Plaintext &a_minBr = this->constant(raw_a_minBr);
+      const seal::Plaintext &d_lat = this->constant(raw_d_lat);
+      const seal::Plaintext &rho_times_a_maxAcc = this->constant(raw_rho * raw_a_maxAcc);
+      const seal::Plaintext &half_rho_times_a_maxAcc = this->constant(raw_rho * raw_a_maxAcc / 2);
+      const seal::Plaintext &inv_double_a_minBr = this->constant(1 / (2 * raw_a_minBr));
+      const seal::Plaintext &inv_double_a_maxBr = this->constant(1 / (2 * raw_a_maxBr));
+      const seal::Plaintext &plain_one = this->constant(1);
 
       /* Inputs:
        * x_b = valuation.at(0);
@@ -146,9 +147,9 @@ namespace ArithHomFA {
       // Switch to the last level
       for (int i = 0; i < 8; ++i) {
           if (result.at(i).scale() > scale * 2) {
-              this->evaluator.rescale_to_inplace(result.at(i), context.last_parms_id());
+              this->evaluator.rescale_to_inplace(result.at(i), this->lastParmsId());
           } else {
-              this->evaluator.mod_switch_to_inplace(result.at(i), context.last_parms_id());
+              this->evaluator.mod_switch_to_inplace(result.at(i), this->lastParmsId());
           }
       }
     }
@@ -192,4 +193,15 @@ namespace ArithHomFA {
     const std::size_t CKKSPredicate::predicateSize = 8;
     // The approximate maximum value of the difference between the signal and the threshold
     const std::vector<double> CKKSPredicate::references = {250, 100, 350, 30, 30, 30, 10, 10};
+    // The constants used in the evaluation of the ciphertexts
+    const PredicateConstants predicateConstants = {raw_rho,
+                                                   raw_a_maxAcc,
+                                                   raw_a_maxBr,
+                                                   raw_a_minBr,
+                                                   raw_d_lat,
+                                                   raw_rho * raw_a_maxAcc,
+                                                   raw_rho * raw_a_maxAcc / 2,
+                                                   1 / (2 * raw_a_minBr),
+                                                   1 / (2 * raw_a_maxBr),
+                                                   1};
 }
@@ -5,9 +5,14 @@
 
 #pragma once
 
+#include <stdexcept>
+
+#include <omp.h>
+
 #include "tfhe++.hpp"
 #include <seal/seal.h>
 
+#include "ckks_to_tfhe.hh"
 #include "seal_config.hh"
 #include "tic_toc.hh"
 
@@ -23,6 +28,8 @@ namespace ArithHomFA {
   template<RunnerMode mode>
   class AbstractRunner {
   public:
+    virtual ~AbstractRunner() = default;
+
     /*!
      * @brief Feeds a valuation to the DFA with valuations
      */
@@ -35,6 +42,43 @@ namespace ArithHomFA {
       timer.print();
     }
 
+    /*!
+     * @brief Converts the CKKS ciphertexts of the predicates to TRGSW ciphertexts in parallel
+     *
+     * @param [in] converter The converter from CKKS to TFHE
+     * @param [in] ckksCiphers The CKKS ciphertexts to convert. They may contain several time steps.
+     * @param [out] trgsws The resulting TRGSW ciphertexts
+     * @param [in] references The reference values of the predicates. The i-th ciphertext is amplified with
+     * references.at(i % references.size()). They are not used in the slow mode.
+     *
+     * @pre converter is initialized
+     * @throws std::invalid_argument if references is empty and they are used
+     */
+    static void toLv1TRGSWFFTs(const CKKSToTFHE &converter, const std::vector<seal::Ciphertext> &ckksCiphers,
+                               std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>> &trgsws,
+                               const std::vector<double> &references) {
+      if constexpr (mode != RunnerMode::slow) {
+        if (references.empty() && !ckksCiphers.empty()) {
+          throw std::invalid_argument("No reference values are given for the conversion of the predicates");
+        }
+      }
+      trgsws.resize(ckksCiphers.size());
+      // Enable nested parallelization
+      omp_set_nested(1);
+      // Note: this parallelization can decelerate if the queue is small
+#pragma omp parallel for default(none) shared(ckksCiphers, trgsws, converter, references)
+      for (std::size_t i = 0; i < ckksCiphers.size(); ++i) {
+        if constexpr (mode == RunnerMode::normal) {
+          converter.toLv1TRGSWFFT(ckksCiphers.at(i), trgsws.at(i), references.at(i % references.size()));
+        } else if constexpr (mode == RunnerMode::fast) {
+          converter.toLv1TRGSWFFTPoor(ckksCiphers.at(i), trgsws.at(i), references.at(i % references.size()));
+        } else {
+          converter.toLv1TRGSWFFTGood(ckksCiphers.at(i), trgsws.at(i));
+        }
+      }
+      omp_set_nested(0);
+    }
+
   protected:
     TicTocForRunner timer;
     static void CircuitBootstrappingFFT(auto &trgsw, auto &tlwe, auto &ekey) {
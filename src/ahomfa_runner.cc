@@ -3,29 +3,43 @@
  * @date 2023/05/02
  */
 
+#include <filesystem>
 #include <iostream>
+#include <numeric>
 #include <optional>
+#include <unordered_set>
 
 #include <CLI/CLI.hpp>
-#include <boost/range/adaptor/reversed.hpp>
 #include <seal/seal.h>
 #include <tfhe++.hpp>
 
 #include "archive.hpp"
+#include "bootstrapping_policy.hpp"
+#include "cpu_dispatch.hpp"
 #include "graph.hpp"
+#include "numa_executor.hpp"
 #include "tfhepp_util.hpp"
 #include "utility.hpp"
 
 #include "abstract_runner.hh"
 #include "ahomfa_runner.hh"
 #include "block_runner.hh"
+#include "ckks_packed_encoder.hh"
 #include "ckks_predicate.hh"
+#include "mapped_bootstrapping_key.hh"
+#include "mapped_cipher_reader.hh"
+#include "monitoring_server.hh"
+#include "multi_spec_runner.hh"
 #include "offline_runner.hh"
+#include "pipelined_runner.hh"
 #include "plain_runner.hh"
+#include "predicate_converter.hh"
 #include "reverse_runner.hh"
+#include "reversed_cipher_reader.hh"
 #include "seal_config.hh"
 #include "sized_cipher_reader.hh"
 #include "sized_cipher_writer.hh"
+#include "raw_tlwe_writer.hh"
 #include "sized_tlwe_writer.hh"
 
 namespace {
@@ -39,7 +53,10 @@ namespace {
     PLAIN,
     REVERSE,
     BLOCK,
-    OFFLINE
+    OFFLINE,
+    SERVER,
+    CONVERT,
+    MULTI
   };
 
   struct Args {
@@ -47,12 +64,15 @@ namespace {
     TYPE type = TYPE::UNSPECIFIED;
     ArithHomFA::RunnerMode runnerMode = ArithHomFA::RunnerMode::normal;
 
-    bool reversed;
+    bool reversed = false, streaming = false, product = false, numa = false, raw_output = false;
     std::optional<ArithHomFA::SealConfig> sealConfig;
-    std::optional<std::string> spec, bkey, debug_skey, relKey;
+    std::optional<std::string> spec, bkey, debug_skey, relKey, socket, inputPath, trgswInput, specDir, outputDir;
+    std::vector<std::string> specs;
     std::istream *input = &std::cin;
     std::ostream *output = &std::cout;
-    std::optional<size_t> bootstrapping_freq, output_freq;
+    std::optional<size_t> bootstrapping_freq, output_freq, batch_size, pipeline_depth, threads, pack;
+    std::optional<double> failure_probability;
+    std::optional<size_t> max_cmux_depth;
   };
 
   void register_general_options(CLI::App &app, Args &args) {
@@ -62,6 +82,7 @@ namespace {
 
   void add_common_flags(CLI::App &app, Args &args) {
     std::function<void(const std::string &)> callback = [&args](const std::string &path) {
+      args.inputPath = path;
       args.input = new std::ifstream(path);
       if (args.input->fail()) {
         spdlog::error("Failed to open the input file", strerror(errno));
@@ -104,6 +125,17 @@ namespace {
     app.add_option("-f,--specification", args.spec, "The specification to be monitored")->required();
   }
 
+  void add_trgsw_flag(CLI::App &app, Args &args) {
+    app.add_option("--trgsw-input", args.trgswInput,
+                   "Monitor the TRGSW ciphertexts made by the convert subcommand instead of the CKKS ciphertexts")
+        ->check(CLI::ExistingFile);
+  }
+
+  void add_output_format_flag(CLI::App &app, Args &args) {
+    app.add_flag("--raw-output", args.raw_output,
+                 "Write the results in the raw TLWE format, which is faster to write and to read");
+  }
+
   void register_pointwise(CLI::App &app, Args &args) {
     CLI::App *pointwise = app.add_subcommand("pointwise", "Evaluate the given signal point-wise (for debugging)");
     add_common_flags(*pointwise, args);
@@ -141,13 +173,59 @@ namespace {
     register_general_options(*plain, args);
   }
 
+  /*!
+   * @brief Adds the options to choose the bootstrapping policy of the reverse and offline algorithms
+   */
+  void add_bootstrapping_flags(CLI::App &app, Args &args) {
+    auto *bootstrappingFreq =
+        app.add_option("-l,--bootstrapping-freq", args.bootstrapping_freq, "Bootstrap all the weights at this interval")
+            ->check(CLI::PositiveNumber);
+    auto *failureProbability =
+        app.add_option("--max-failure-probability", args.failure_probability,
+                       "Bootstrap each weight only when its estimated noise makes the error probability exceed this")
+            ->check(CLI::Range(0.0, 1.0));
+    auto *maxCmuxDepth =
+        app.add_option("--max-cmux-depth", args.max_cmux_depth,
+                       "Bootstrap each weight only when it is processed by this number of CMUXes since its last "
+                       "bootstrapping")
+            ->check(CLI::PositiveNumber);
+    bootstrappingFreq->excludes(failureProbability);
+    bootstrappingFreq->excludes(maxCmuxDepth);
+    failureProbability->excludes(maxCmuxDepth);
+  }
+
+  std::unique_ptr<BootstrappingPolicy> make_bootstrapping_policy(std::optional<std::size_t> boot_interval,
+                                                                 std::optional<double> failure_probability,
+                                                                 std::optional<std::size_t> max_cmux_depth) {
+    if (max_cmux_depth) {
+      return std::make_unique<DepthBootstrappingPolicy>(*max_cmux_depth);
+    }
+    if (failure_probability) {
+      auto policy =
+          std::make_unique<NoiseBootstrappingPolicy>(NoiseModel::from_tfhepp_params(), *failure_probability);
+      spdlog::debug("\tvariance threshold: {}", policy->threshold());
+      return policy;
+    }
+    return std::make_unique<IntervalBootstrappingPolicy>(*boot_interval);
+  }
+
   void register_offline(CLI::App &app, Args &args) {
     CLI::App *offline = app.add_subcommand("offline", "Execute a monitor with the offline algorithm");
     add_common_flags(*offline, args);
     add_seal_flags(*offline, args);
     add_tfhepp_flags(*offline, args);
     add_spec_flag(*offline, args);
-    offline->add_option("-l,--bootstrapping-freq", args.bootstrapping_freq)->required()->check(CLI::PositiveNumber);
+    add_trgsw_flag(*offline, args);
+    add_output_format_flag(*offline, args);
+    add_bootstrapping_flags(*offline, args);
+    offline->add_option("--batch-size", args.batch_size,
+                        "The number of time steps converted from CKKS to TFHE in parallel at once (0: whole trace)")
+        ->check(CLI::NonNegativeNumber);
+    offline->add_flag("--streaming", args.streaming,
+                      "Read the input file backwards in chunks instead of loading the whole trace (requires -i)");
+    offline->add_option("--pack", args.pack,
+                        "The number of the time steps in each ciphertext encrypted by `ahomfa_util ckks enc --pack`")
+        ->check(CLI::PositiveNumber);
     // Choose the runnerMode from normal (default), fast, slow.
     std::function<void(const std::string &)> mode_callback = [&args](const std::string &mode) {
       if (mode == "normal") {
@@ -162,7 +240,18 @@ namespace {
       }
     };
     offline->add_option_function("-m,--mode", mode_callback, "The mode of the runner (normal, fast, slow)");
-    offline->parse_complete_callback([&args] { args.type = TYPE::OFFLINE; });
+    offline->parse_complete_callback([&args] {
+      if (args.streaming && !args.inputPath) {
+        throw CLI::RequiresError("--streaming", "--input");
+      }
+      if (args.streaming && args.pack) {
+        throw CLI::ExcludesError("--streaming", "--pack");
+      }
+      if (!args.bootstrapping_freq && !args.failure_probability && !args.max_cmux_depth) {
+        throw CLI::RequiredError("--bootstrapping-freq, --max-failure-probability, or --max-cmux-depth");
+      }
+      args.type = TYPE::OFFLINE;
+    });
     register_general_options(*offline, args);
   }
 
@@ -172,8 +261,15 @@ namespace {
     add_seal_flags(*reverse, args);
     add_tfhepp_flags(*reverse, args);
     add_spec_flag(*reverse, args);
-    reverse->add_option("-l,--bootstrapping-freq", args.bootstrapping_freq)->required()->check(CLI::PositiveNumber);
+    add_trgsw_flag(*reverse, args);
+    add_output_format_flag(*reverse, args);
+    add_bootstrapping_flags(*reverse, args);
     reverse->add_flag("--reversed", args.reversed, "The given specification is already reversed");
+    reverse->add_flag("--numa", args.numa, "Run the CMUXes of the DFA on the threads pinned to the NUMA nodes");
+    reverse->add_option("--pipeline-depth", args.pipeline_depth,
+                        "Pipeline the predicate evaluation, the conversion, and the DFA evaluation with the given queue "
+                        "capacity")
+        ->check(CLI::PositiveNumber);
     // Choose the runnerMode from normal (default), fast, slow.
     std::function<void(const std::string &)> mode_callback = [&args](const std::string &mode) {
       if (mode == "normal") {
@@ -188,7 +284,12 @@ namespace {
       }
     };
     reverse->add_option_function("-m,--mode", mode_callback, "The mode of the runner (normal, fast, slow)");
-    reverse->parse_complete_callback([&args] { args.type = TYPE::REVERSE; });
+    reverse->parse_complete_callback([&args] {
+      if (!args.bootstrapping_freq && !args.failure_probability && !args.max_cmux_depth) {
+        throw CLI::RequiredError("--bootstrapping-freq, --max-failure-probability, or --max-cmux-depth");
+      }
+      args.type = TYPE::REVERSE;
+    });
     register_general_options(*reverse, args);
   }
 
@@ -198,7 +299,13 @@ namespace {
     add_seal_flags(*block, args);
     add_tfhepp_flags(*block, args);
     add_spec_flag(*block, args);
+    add_trgsw_flag(*block, args);
+    add_output_format_flag(*block, args);
     block->add_option("-l,--block-size", args.output_freq)->required()->check(CLI::PositiveNumber);
+    block->add_flag("--numa", args.numa, "Run the CMUXes of the DFA on the threads pinned to the NUMA nodes");
+    block->add_option("--pack", args.pack,
+                      "The number of the time steps in each ciphertext encrypted by `ahomfa_util ckks enc --pack`")
+        ->check(CLI::PositiveNumber);
     // Choose the runnerMode from normal (default), fast, slow.
     std::function<void(const std::string &)> mode_callback = [&args](const std::string &mode) {
       if (mode == "normal") {
@@ -217,6 +324,120 @@ namespace {
     register_general_options(*block, args);
   }
 
+  void register_server(CLI::App &app, Args &args) {
+    CLI::App *server =
+        app.add_subcommand("server", "Serve monitors of many streams over a Unix domain socket sharing the keys");
+    add_seal_flags(*server, args);
+    add_tfhepp_flags(*server, args);
+    add_spec_flag(*server, args);
+    server->add_option("-s,--socket", args.socket, "The path of the Unix domain socket to listen to")->required();
+    server->add_option("-j,--threads", args.threads, "The number of the threads to evaluate the streams")
+        ->check(CLI::PositiveNumber);
+    auto *bootstrappingFreq = server->add_option("-l,--bootstrapping-freq", args.bootstrapping_freq,
+                                                 "Use the reverse algorithm with the given bootstrapping frequency")
+                                  ->check(CLI::PositiveNumber);
+    auto *blockSize = server->add_option("--block-size", args.output_freq,
+                                         "Use the block algorithm with the given block size")
+                          ->check(CLI::PositiveNumber);
+    bootstrappingFreq->excludes(blockSize);
+    server->add_flag("--reversed", args.reversed, "The given specification is already reversed")->needs(bootstrappingFreq);
+    // Choose the runnerMode from normal (default), fast, slow.
+    std::function<void(const std::string &)> mode_callback = [&args](const std::string &mode) {
+      if (mode == "normal") {
+        args.runnerMode = ArithHomFA::RunnerMode::normal;
+      } else if (mode == "fast") {
+        args.runnerMode = ArithHomFA::RunnerMode::fast;
+      } else if (mode == "slow") {
+        args.runnerMode = ArithHomFA::RunnerMode::slow;
+      } else {
+        spdlog::error("Invalid mode: {}", mode);
+        exit(1);
+      }
+    };
+    server->add_option_function("-m,--mode", mode_callback, "The mode of the runner (normal, fast, slow)");
+    server->parse_complete_callback([&args, bootstrappingFreq, blockSize] {
+      if (bootstrappingFreq->count() == 0 && blockSize->count() == 0) {
+        throw CLI::RequiredError("--bootstrapping-freq or --block-size");
+      }
+      args.type = TYPE::SERVER;
+    });
+    register_general_options(*server, args);
+  }
+
+  void register_multi(CLI::App &app, Args &args) {
+    CLI::App *multi = app.add_subcommand(
+        "multi", "Execute monitors of several specifications sharing the predicate evaluation and the conversion");
+    add_common_flags(*multi, args);
+    add_seal_flags(*multi, args);
+    add_tfhepp_flags(*multi, args);
+    add_trgsw_flag(*multi, args);
+    auto *specs = multi->add_option("-f,--specification", args.specs, "The specifications to be monitored");
+    auto *specDir =
+        multi->add_option("--spec-dir", args.specDir, "The directory containing the specifications (*.spec)")
+            ->check(CLI::ExistingDirectory);
+    multi->add_option("--output-dir", args.outputDir, "The directory to write the result of each specification")
+        ->required()
+        ->check(CLI::ExistingDirectory);
+    auto *bootstrappingFreq = multi->add_option("-l,--bootstrapping-freq", args.bootstrapping_freq,
+                                                "Use the reverse algorithm with the given bootstrapping frequency")
+                                  ->check(CLI::PositiveNumber);
+    auto *blockSize = multi->add_option("--block-size", args.output_freq,
+                                        "Use the block algorithm with the given block size")
+                          ->check(CLI::PositiveNumber);
+    bootstrappingFreq->excludes(blockSize);
+    multi->add_flag("--reversed", args.reversed, "The given specifications are already reversed")->needs(bootstrappingFreq);
+    multi->add_flag("--product", args.product,
+                    "Monitor the product automaton of the specifications with one DFA evaluation per input");
+    // Choose the runnerMode from normal (default), fast, slow.
+    std::function<void(const std::string &)> mode_callback = [&args](const std::string &mode) {
+      if (mode == "normal") {
+        args.runnerMode = ArithHomFA::RunnerMode::normal;
+      } else if (mode == "fast") {
+        args.runnerMode = ArithHomFA::RunnerMode::fast;
+      } else if (mode == "slow") {
+        args.runnerMode = ArithHomFA::RunnerMode::slow;
+      } else {
+        spdlog::error("Invalid mode: {}", mode);
+        exit(1);
+      }
+    };
+    multi->add_option_function("-m,--mode", mode_callback, "The mode of the runner (normal, fast, slow)");
+    multi->parse_complete_callback([&args, specs, specDir, bootstrappingFreq, blockSize] {
+      if (specs->count() == 0 && specDir->count() == 0) {
+        throw CLI::RequiredError("--specification or --spec-dir");
+      }
+      if (bootstrappingFreq->count() == 0 && blockSize->count() == 0) {
+        throw CLI::RequiredError("--bootstrapping-freq or --block-size");
+      }
+      args.type = TYPE::MULTI;
+    });
+    register_general_options(*multi, args);
+  }
+
+  void register_convert(CLI::App &app, Args &args) {
+    CLI::App *convert =
+        app.add_subcommand("convert", "Evaluate the predicates and save the TRGSW ciphertexts for later monitoring");
+    add_common_flags(*convert, args);
+    add_seal_flags(*convert, args);
+    add_tfhepp_flags(*convert, args);
+    // Choose the runnerMode from normal (default), fast, slow.
+    std::function<void(const std::string &)> mode_callback = [&args](const std::string &mode) {
+      if (mode == "normal") {
+        args.runnerMode = ArithHomFA::RunnerMode::normal;
+      } else if (mode == "fast") {
+        args.runnerMode = ArithHomFA::RunnerMode::fast;
+      } else if (mode == "slow") {
+        args.runnerMode = ArithHomFA::RunnerMode::slow;
+      } else {
+        spdlog::error("Invalid mode: {}", mode);
+        exit(1);
+      }
+    };
+    convert->add_option_function("-m,--mode", mode_callback, "The mode of the conversion (normal, fast, slow)");
+    convert->parse_complete_callback([&args] { args.type = TYPE::CONVERT; });
+    register_general_options(*convert, args);
+  }
+
   void do_plain(const ArithHomFA::SealConfig &config, const std::string &graphFilename, std::istream &istream,
                 std::ostream &ostream) {
     const auto graph = Graph::from_file(graphFilename);
@@ -240,18 +461,110 @@ namespace {
     runner.printTime();
   }
 
+  template<ArithHomFA::RunnerMode mode>
+  void do_convert(const ArithHomFA::SealConfig &config, const std::string &bkey_filename,
+                  const std::string &relinKeysPath, std::istream &istream, std::ostream &ostream) {
+    const seal::SEALContext context = config.makeContext();
+    spdlog::debug("Parameters:");
+    spdlog::debug("\tscale: {}", config.scale);
+    spdlog::debug("\tbkey_filename: {}", bkey_filename);
+    spdlog::debug("\trelinKeysPath: {}", relinKeysPath);
+    auto bkey = ArithHomFA::loadBootstrappingKey(bkey_filename);
+    assert(bkey.ekey && bkey.tlwel1_trlwel1_ikskey && bkey.bkfft && bkey.kskh2m && bkey.kskm2l);
+    seal::RelinKeys relinKeys;
+    {
+      std::ifstream relinKeysStream(relinKeysPath);
+      if (!relinKeysStream) {
+        spdlog::error("Failed to open the relinearization key", strerror(errno));
+        exit(1);
+      }
+      relinKeys.load(context, relinKeysStream);
+    }
+
+    ArithHomFA::PredicateConverter<mode> converter(context, config.scale, bkey,
+                                                   ArithHomFA::CKKSPredicate::getReferences());
+    converter.setRelinKeys(relinKeys);
+    ArithHomFA::SizedCipherReader reader(istream);
+    TRGSWLvl1FFTSerializer serializer(ostream);
+
+    std::vector<seal::Ciphertext> valuations(ArithHomFA::CKKSPredicate::getSignalSize());
+    std::vector<TRGSWLvl1FFT> trgsws;
+    while (istream.good()) {
+      for (auto &valuation: valuations) {
+        if (!reader.read(context, valuation)) {
+          converter.printTime();
+          return;
+        }
+      }
+      converter.convert(valuations, trgsws);
+      for (const auto &trgsw: trgsws) {
+        serializer.save(trgsw);
+      }
+    }
+
+    converter.printTime();
+  }
+
+  /*!
+   * @brief Monitors the TRGSW ciphertexts of the predicates made by the convert subcommand
+   */
+  template<class Runner>
+  void run_raw(Runner &runner, InputStream<TRGSWLvl1FFT> &trgswStream, std::ostream &ostream, bool rawOutput) {
+    auto writer = ArithHomFA::makeTLWEWriter<TFHEpp::lvl1param>(ostream, rawOutput);
+    const std::size_t predicateSize = ArithHomFA::CKKSPredicate::getPredicateSize();
+    if (trgswStream.size() % predicateSize != 0) {
+      spdlog::error("The number of the TRGSW ciphertexts is not a multiple of the number of the predicates");
+      exit(1);
+    }
+    std::vector<TRGSWLvl1FFT> trgsws(predicateSize);
+    while (trgswStream.size() > 0) {
+      for (auto &trgsw: trgsws) {
+        trgsw = trgswStream.next();
+      }
+      writer->write(runner.feedRaw(trgsws));
+    }
+    writer->flush();
+
+    runner.printTime();
+  }
+
+  /*!
+   * @brief Makes the runner evaluate the DFA on the threads pinned to the NUMA nodes
+   */
+  template<class Runner>
+  void use_numa(Runner &runner) {
+    auto executor = std::make_shared<NumaExecutor>();
+    spdlog::info("Use {} NUMA node(s) with {} worker(s)", executor->num_nodes(), executor->num_workers());
+    runner.setExecutor(std::move(executor));
+  }
+
   template<ArithHomFA::RunnerMode mode>
   void do_offline(const ArithHomFA::SealConfig &config, const std::string &spec_filename,
                   const std::string &bkey_filename, const std::string &relinKeysPath, std::istream &istream,
-                  std::ostream &ostream, int boot_interval) {
+                  std::ostream &ostream, std::optional<std::size_t> boot_interval,
+                  std::optional<double> failure_probability, std::optional<std::size_t> max_cmux_depth,
+                  std::size_t batch_size,
+                  const std::optional<std::string> &inputPath, bool streaming,
+                  const std::optional<std::string> &trgswInput, std::optional<std::size_t> pack, bool rawOutput) {
     const seal::SEALContext context = config.makeContext();
     spdlog::debug("Parameters:");
     spdlog::debug("\tscale: {}", config.scale);
     spdlog::debug("\tspec_filename: {}", spec_filename);
     spdlog::debug("\tbkey_filename: {}", bkey_filename);
     spdlog::debug("\trelinKeysPath: {}", relinKeysPath);
-    spdlog::debug("\tboot_interval: {}", boot_interval);
-    auto bkey = read_from_archive<ArithHomFA::BootstrappingKey>(bkey_filename);
+    if (boot_interval) {
+      spdlog::debug("\tboot_interval: {}", *boot_interval);
+    } else if (failure_probability) {
+      spdlog::debug("\tmax_failure_probability: {}", *failure_probability);
+    } else {
+      spdlog::debug("\tmax_cmux_depth: {}", *max_cmux_depth);
+    }
+    spdlog::debug("\tbatch_size: {}", batch_size);
+    spdlog::debug("\tstreaming: {}", streaming);
+    if (pack) {
+      spdlog::debug("\tpack: {}", *pack);
+    }
+    auto bkey = ArithHomFA::loadBootstrappingKey(bkey_filename);
     assert(bkey.ekey && bkey.tlwel1_trlwel1_ikskey && bkey.bkfft && bkey.kskh2m && bkey.kskm2l);
     seal::RelinKeys relinKeys;
     {
@@ -263,42 +576,142 @@ namespace {
       relinKeys.load(context, relinKeysStream);
     }
 
-    ArithHomFA::SizedCipherReader reader(istream);
-    ArithHomFA::SizedTLWEWriter<TFHEpp::lvl1param> writer(ostream);
-    std::vector<seal::Ciphertext> ciphers;
+    if (trgswInput) {
+      // The TRGSW ciphertexts are read from the end, i.e., the predicates of the last time step in the reversed order
+      ReversedTRGSWLvl1InputStreamFromCtxtFile trgswStream(*trgswInput);
+      ArithHomFA::OfflineRunner<mode> runner(
+          context, config.scale, Graph::from_file(spec_filename),
+          trgswStream.size() / ArithHomFA::CKKSPredicate::getPredicateSize(),
+          make_bootstrapping_policy(boot_interval, failure_probability, max_cmux_depth), bkey,
+          ArithHomFA::CKKSPredicate::getReferences());
+      run_raw(runner, trgswStream, ostream, rawOutput);
+      return;
+    }
 
-    while (istream.good()) {
-      // get the cipher text from stdin
-      seal::Ciphertext cipher;
-      if (reader.read(context, cipher)) {
-        ciphers.emplace_back(std::move(cipher));
+    auto writer = ArithHomFA::makeTLWEWriter<TFHEpp::lvl1param>(ostream, rawOutput);
+    // The ciphertexts are consumed from the end of the trace. In the streaming mode, they are read backwards from the
+    // file in chunks. Otherwise, the whole trace is loaded first, directly from the memory-mapped file if given.
+    std::optional<ArithHomFA::ReversedSizedCipherReader> reversedReader;
+    std::vector<seal::Ciphertext> ciphers;
+    std::size_t numCiphers;
+    // With --pack, the number of the time steps in each batch, recorded in its header
+    std::vector<std::size_t> batchSteps;
+    if (streaming) {
+      if (batch_size == 0) {
+        spdlog::error("--batch-size 0 loads the whole trace, which cannot be combined with --streaming");
+        exit(1);
+      }
+      constexpr std::size_t minChunkSize = 16;
+      reversedReader.emplace(*inputPath, context,
+                             std::max(batch_size * ArithHomFA::CKKSPredicate::getSignalSize(), minChunkSize));
+      numCiphers = reversedReader->size();
+    } else {
+      auto readAll = [&](auto &reader) {
+        while (reader.good()) {
+          if (pack) {
+            ArithHomFA::PackedBatchHeader header{};
+            if (!reader.readHeader(header)) {
+              break;
+            }
+            header.validate(*pack);
+            batchSteps.push_back(header.numSteps);
+            for (std::size_t i = 0; i < ArithHomFA::CKKSPredicate::getSignalSize(); ++i) {
+              seal::Ciphertext cipher;
+              if (!reader.read(context, cipher)) {
+                throw std::runtime_error("The last packed batch is truncated");
+              }
+              ciphers.emplace_back(std::move(cipher));
+            }
+            continue;
+          }
+          seal::Ciphertext cipher;
+          if (reader.read(context, cipher)) {
+            ciphers.emplace_back(std::move(cipher));
+          } else {
+            break;
+          }
+        }
+      };
+      if (inputPath) {
+        ArithHomFA::MappedSizedCipherReader reader(*inputPath);
+        readAll(reader);
       } else {
-        break;
+        // get the cipher texts from stdin
+        ArithHomFA::SizedCipherReader reader(istream);
+        readAll(reader);
       }
+      numCiphers = ciphers.size();
     }
+    auto nextCipher = ciphers.rbegin();
+    auto readReversed = [&](seal::Ciphertext &cipher) {
+      if (reversedReader) {
+        return reversedReader->read(cipher);
+      } else if (nextCipher == ciphers.rend()) {
+        return false;
+      }
+      cipher = std::move(*nextCipher++);
+      return true;
+    };
 
-    assert(ciphers.size() % ArithHomFA::CKKSPredicate::getSignalSize() == 0);
-    ArithHomFA::OfflineRunner<mode> runner(context, config.scale, spec_filename,
-                                           ciphers.size() / ArithHomFA::CKKSPredicate::getSignalSize(), boot_interval, bkey,
-                                           ArithHomFA::CKKSPredicate::getReferences());
+    assert(numCiphers % ArithHomFA::CKKSPredicate::getSignalSize() == 0);
+    // With --pack, each valuation holds the time steps recorded in its header
+    const std::size_t numSteps = pack ? std::reduce(batchSteps.begin(), batchSteps.end(), std::size_t{0})
+                                      : numCiphers / ArithHomFA::CKKSPredicate::getSignalSize();
+    ArithHomFA::OfflineRunner<mode> runner(
+        context, config.scale, Graph::from_file(spec_filename), numSteps,
+        make_bootstrapping_policy(boot_interval, failure_probability, max_cmux_depth), bkey,
+        ArithHomFA::CKKSPredicate::getReferences());
     runner.setRelinKeys(relinKeys);
 
+    if (pack) {
+      std::vector<seal::Ciphertext> valuations(ArithHomFA::CKKSPredicate::getSignalSize());
+      for (const std::size_t steps: std::ranges::reverse_view(batchSteps)) {
+        // The signals of a valuation are also read backwards
+        for (auto &valuation: std::ranges::reverse_view(valuations)) {
+          readReversed(valuation);
+        }
+        // Only the recorded time steps are fed, and the padding slots of the last batch are ignored
+        for (const auto &result: runner.feedPacked(valuations, steps)) {
+          writer->write(result);
+        }
+      }
+      writer->flush();
+      runner.printTime();
+      return;
+    }
+
+    if (batch_size == 0 || batch_size > numSteps) {
+      batch_size = numSteps;
+    }
     std::vector<seal::Ciphertext> valuations;
-    valuations.reserve(ArithHomFA::CKKSPredicate::getSignalSize());
-    for (const auto &cipher: boost::adaptors::reverse(ciphers)) {
-      valuations.push_back(cipher);
-      if (valuations.size() == ArithHomFA::CKKSPredicate::getSignalSize()) {
-        writer.write(runner.feed(valuations));
+    valuations.reserve(ArithHomFA::CKKSPredicate::getSignalSize() * batch_size);
+    for (seal::Ciphertext cipher; readReversed(cipher);) {
+      valuations.push_back(std::move(cipher));
+      if (valuations.size() == ArithHomFA::CKKSPredicate::getSignalSize() * batch_size) {
+        if (batch_size == 1) {
+          writer->write(runner.feed(valuations));
+        } else {
+          for (const auto &result: runner.feedBatch(valuations)) {
+            writer->write(result);
+          }
+        }
         valuations.clear();
       }
     }
+    // Feed the remaining time steps
+    if (!valuations.empty()) {
+      for (const auto &result: runner.feedBatch(valuations)) {
+        writer->write(result);
+      }
+    }
+    writer->flush();
 
     runner.printTime();
   }
 
   template<ArithHomFA::RunnerMode mode>
   void run_online(const seal::SEALContext &context, ArithHomFA::AbstractRunner<mode> *runner, std::istream &istream,
-                  std::ostream &ostream, const std::optional<std::string> &debug_skey) {
+                  std::ostream &ostream, const std::optional<std::string> &debug_skey, bool rawOutput) {
     seal::SecretKey secretKey;
     if (debug_skey) {
       std::ifstream secretKeyStream{*debug_skey};
@@ -310,18 +723,16 @@ namespace {
     }
     ArithHomFA::CKKSNoEmbedEncoder encoder(context);
     ArithHomFA::SizedCipherReader reader(istream);
-    ArithHomFA::SizedTLWEWriter<TFHEpp::lvl1param> writer(ostream);
+    auto writer = ArithHomFA::makeTLWEWriter<TFHEpp::lvl1param>(ostream, rawOutput);
 
     std::vector<seal::Ciphertext> valuations;
     valuations.resize(ArithHomFA::CKKSPredicate::getSignalSize());
     spdlog::debug("Start monitoring with signal size: {}", ArithHomFA::CKKSPredicate::getSignalSize());
 
-    while (istream.good()) {
-      // get the content
+    auto readValuations = [&] {
       for (auto &valuation: valuations) {
         if (!reader.read(context, valuation)) {
-          runner->printTime();
-          return;
+          return false;
         }
         if (debug_skey) {
           seal::Plaintext plain;
@@ -330,26 +741,77 @@ namespace {
           spdlog::debug("valuation (encrypted): {}", encoder.decode(plain));
         }
       }
-      // Evaluate
-      writer.write(runner->feed(valuations));
+      return true;
+    };
+    while (istream.good() && readValuations()) {
+      // Evaluate. The result is not held back by the writer since this is online monitoring.
+      writer->write(runner->feed(valuations));
+      writer->flush();
     }
+    writer->flush();
 
     runner->printTime();
   }
 
+  /*
+   * Monitor the valuations encrypted by `ahomfa_util ckks enc --pack`, where each valuation holds up to pack time steps
+   * as recorded in its header
+   */
+  template<class Runner>
+  void run_packed(const seal::SEALContext &context, Runner &runner, std::istream &istream, std::ostream &ostream,
+                  std::size_t pack, bool rawOutput) {
+    ArithHomFA::SizedCipherReader reader(istream);
+    auto writer = ArithHomFA::makeTLWEWriter<TFHEpp::lvl1param>(ostream, rawOutput);
+
+    std::vector<seal::Ciphertext> valuations(ArithHomFA::CKKSPredicate::getSignalSize());
+    spdlog::debug("Start monitoring with signal size: {} and {} time steps per valuation",
+                  ArithHomFA::CKKSPredicate::getSignalSize(), pack);
+    while (istream.good()) {
+      ArithHomFA::PackedBatchHeader header{};
+      if (!reader.readHeader(header)) {
+        break;
+      }
+      header.validate(pack);
+      if (!std::ranges::all_of(valuations, [&](auto &valuation) { return reader.read(context, valuation); })) {
+        break;
+      }
+      for (const auto &result: runner.feedPacked(valuations, header.numSteps)) {
+        writer->write(result);
+      }
+      // The results of each batch are not held back by the writer since this is online monitoring
+      writer->flush();
+    }
+    writer->flush();
+
+    runner.printTime();
+  }
+
   template<ArithHomFA::RunnerMode mode>
   void do_reverse(const ArithHomFA::SealConfig &config, const std::string &spec_filename,
                   const std::string &bkey_filename, const std::string &relinKeysPath, std::istream &istream,
-                  std::ostream &ostream, int boot_interval, bool reversed,
-                  const std::optional<std::string> &debug_skey) {
+                  std::ostream &ostream, std::optional<std::size_t> boot_interval,
+                  std::optional<double> failure_probability, std::optional<std::size_t> max_cmux_depth,
+                  bool reversed, const std::optional<std::size_t> &pipeline_depth, bool numa,
+                  const std::optional<std::string> &trgswInput, const std::optional<std::string> &debug_skey,
+                  bool rawOutput) {
     const seal::SEALContext context = config.makeContext();
     spdlog::debug("Parameters:");
     spdlog::debug("\tscale: {}", config.scale);
     spdlog::debug("\tspec_filename: {}", spec_filename);
     spdlog::debug("\tbkey_filename: {}", bkey_filename);
     spdlog::debug("\trelinKeysPath: {}", relinKeysPath);
-    spdlog::debug("\tboot_interval: {}", boot_interval);
-    auto bkey = read_from_archive<ArithHomFA::BootstrappingKey>(bkey_filename);
+    if (boot_interval) {
+      spdlog::debug("\tboot_interval: {}", *boot_interval);
+    } else if (failure_probability) {
+      spdlog::debug("\tmax_failure_probability: {}", *failure_probability);
+    } else {
+      spdlog::debug("\tmax_cmux_depth: {}", *max_cmux_depth);
+    }
+    if (pipeline_depth) {
+      spdlog::debug("\tpipeline_depth: {}", *pipeline_depth);
+    }
+    spdlog::debug("\tnuma: {}", numa);
+    auto bkey = ArithHomFA::loadBootstrappingKey(bkey_filename);
     assert(bkey.ekey && bkey.tlwel1_trlwel1_ikskey && bkey.bkfft && bkey.kskh2m && bkey.kskm2l);
     seal::RelinKeys relinKeys;
     {
@@ -361,17 +823,247 @@ namespace {
       relinKeys.load(context, relinKeysStream);
     }
 
-    ArithHomFA::ReverseRunner<mode> runner(context, config.scale, spec_filename, boot_interval, bkey,
-                                           ArithHomFA::CKKSPredicate::getReferences(), reversed);
+    if (trgswInput) {
+      TRGSWLvl1InputStreamFromCtxtFile trgswStream(*trgswInput);
+      ArithHomFA::ReverseRunner<mode> runner(
+          context, config.scale, Graph::from_file(spec_filename),
+          make_bootstrapping_policy(boot_interval, failure_probability, max_cmux_depth), bkey,
+          ArithHomFA::CKKSPredicate::getReferences(), reversed);
+      if (numa) {
+        use_numa(runner);
+      }
+      run_raw(runner, trgswStream, ostream, rawOutput);
+      return;
+    }
+    if (pipeline_depth) {
+      if (debug_skey) {
+        spdlog::warn("The debug secret key is ignored in the pipelined mode");
+      }
+      if (numa) {
+        spdlog::warn("--numa is ignored in the pipelined mode");
+      }
+      ArithHomFA::PipelinedReverseRunner<mode> runner(
+          context, config.scale, Graph::from_file(spec_filename),
+          make_bootstrapping_policy(boot_interval, failure_probability, max_cmux_depth), bkey,
+          ArithHomFA::CKKSPredicate::getReferences(), *pipeline_depth, reversed);
+      spdlog::debug("Constructed the pipelined reverse runner");
+      runner.setRelinKeys(relinKeys);
+      ArithHomFA::SizedCipherReader reader{istream};
+      auto writer = ArithHomFA::makeTLWEWriter<TFHEpp::lvl1param>(ostream, rawOutput);
+      runner.run(context, reader, *writer);
+      writer->flush();
+      runner.printTime();
+      return;
+    }
+
+    ArithHomFA::ReverseRunner<mode> runner(
+        context, config.scale, Graph::from_file(spec_filename),
+        make_bootstrapping_policy(boot_interval, failure_probability, max_cmux_depth), bkey,
+        ArithHomFA::CKKSPredicate::getReferences(), reversed);
     spdlog::debug("Constructed the reverse runner");
     runner.setRelinKeys(relinKeys);
-    run_online(context, &runner, istream, ostream, debug_skey);
+    if (numa) {
+      use_numa(runner);
+    }
+    run_online(context, &runner, istream, ostream, debug_skey, rawOutput);
+  }
+
+  template<ArithHomFA::RunnerMode mode, class DFARunner>
+  void run_multi(const seal::SEALContext &context, ArithHomFA::MultiSpecRunner<mode, DFARunner> &runner,
+                 std::istream &istream, const std::optional<std::string> &trgswInput,
+                 std::vector<std::ofstream> &ostreams) {
+    std::vector<ArithHomFA::SizedTLWEWriter<TFHEpp::lvl1param>> writers;
+    writers.reserve(ostreams.size());
+    for (auto &ostream: ostreams) {
+      writers.emplace_back(ostream);
+    }
+    auto write = [&](const std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>> &results) {
+      for (std::size_t i = 0; i < results.size(); ++i) {
+        writers.at(i).write(results.at(i));
+      }
+    };
+
+    if (trgswInput) {
+      TRGSWLvl1InputStreamFromCtxtFile trgswStream(*trgswInput);
+      const std::size_t predicateSize = ArithHomFA::CKKSPredicate::getPredicateSize();
+      if (trgswStream.size() % predicateSize != 0) {
+        spdlog::error("The number of the TRGSW ciphertexts is not a multiple of the number of the predicates");
+        exit(1);
+      }
+      std::vector<TRGSWLvl1FFT> trgsws(predicateSize);
+      while (trgswStream.size() > 0) {
+        for (auto &trgsw: trgsws) {
+          trgsw = trgswStream.next();
+        }
+        write(runner.feedRaw(trgsws));
+      }
+    } else {
+      ArithHomFA::SizedCipherReader reader(istream);
+      std::vector<seal::Ciphertext> valuations(ArithHomFA::CKKSPredicate::getSignalSize());
+      while (istream.good()) {
+        bool completed = true;
+        for (auto &valuation: valuations) {
+          if (!reader.read(context, valuation)) {
+            completed = false;
+            break;
+          }
+        }
+        if (!completed) {
+          break;
+        }
+        write(runner.feed(valuations));
+      }
+    }
+
+    runner.printTime();
+  }
+
+  template<ArithHomFA::RunnerMode mode>
+  void do_multi(const ArithHomFA::SealConfig &config, std::vector<std::string> spec_filenames,
+                const std::optional<std::string> &specDir, const std::string &outputDir,
+                const std::string &bkey_filename, const std::string &relinKeysPath, std::istream &istream,
+                std::optional<std::size_t> boot_interval, std::optional<std::size_t> blockSize, bool reversed,
+                bool product, const std::optional<std::string> &trgswInput) {
+    const seal::SEALContext context = config.makeContext();
+    if (specDir) {
+      std::vector<std::string> found;
+      for (const auto &entry: std::filesystem::directory_iterator(*specDir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".spec") {
+          found.push_back(entry.path().string());
+        }
+      }
+      std::sort(found.begin(), found.end());
+      std::move(found.begin(), found.end(), std::back_inserter(spec_filenames));
+    }
+    spdlog::debug("Parameters:");
+    spdlog::debug("\tscale: {}", config.scale);
+    for (const auto &spec_filename: spec_filenames) {
+      spdlog::debug("\tspec_filename: {}", spec_filename);
+    }
+    spdlog::debug("\toutputDir: {}", outputDir);
+    spdlog::debug("\tbkey_filename: {}", bkey_filename);
+    spdlog::debug("\trelinKeysPath: {}", relinKeysPath);
+    if (boot_interval) {
+      spdlog::debug("\tboot_interval: {}", *boot_interval);
+    } else {
+      spdlog::debug("\tblockSize: {}", *blockSize);
+    }
+    if (spec_filenames.empty()) {
+      spdlog::error("No specification is given");
+      exit(1);
+    }
+
+    // The result of each specification is written to <outputDir>/<stem of the specification>.tlwe
+    std::vector<Graph> graphs;
+    std::vector<std::ofstream> ostreams;
+    std::unordered_set<std::string> outputNames;
+    for (const auto &spec_filename: spec_filenames) {
+      graphs.push_back(Graph::from_file(spec_filename));
+      const auto outputName = std::filesystem::path(spec_filename).stem().string() + ".tlwe";
+      if (!outputNames.insert(outputName).second) {
+        spdlog::error("Duplicated output file name: {}", outputName);
+        exit(1);
+      }
+      ostreams.emplace_back(std::filesystem::path(outputDir) / outputName, std::ios::binary);
+      if (!ostreams.back()) {
+        spdlog::error("Failed to open the output file: {}", outputName);
+        exit(1);
+      }
+    }
+
+    auto bkey = ArithHomFA::loadBootstrappingKey(bkey_filename);
+    assert(bkey.ekey && bkey.tlwel1_trlwel1_ikskey && bkey.bkfft && bkey.kskh2m && bkey.kskm2l);
+    seal::RelinKeys relinKeys;
+    {
+      std::ifstream relinKeysStream(relinKeysPath);
+      if (!relinKeysStream) {
+        spdlog::error("Failed to open the relinearization key", strerror(errno));
+        exit(1);
+      }
+      relinKeys.load(context, relinKeysStream);
+    }
+
+    if (boot_interval && product) {
+      auto runner = ArithHomFA::makeProductReverseRunner<mode>(context, config.scale, graphs, *boot_interval, bkey,
+                                                               ArithHomFA::CKKSPredicate::getReferences(), reversed);
+      spdlog::debug("Constructed the product reverse runner");
+      runner.setRelinKeys(relinKeys);
+      run_multi(context, runner, istream, trgswInput, ostreams);
+    } else if (boot_interval) {
+      auto runner = ArithHomFA::makeMultiSpecReverseRunner<mode>(context, config.scale, graphs, *boot_interval, bkey,
+                                                                 ArithHomFA::CKKSPredicate::getReferences(), reversed);
+      spdlog::debug("Constructed the multi-specification reverse runner");
+      runner.setRelinKeys(relinKeys);
+      run_multi(context, runner, istream, trgswInput, ostreams);
+    } else if (product) {
+      auto runner = ArithHomFA::makeProductBlockRunner<mode>(context, config.scale, graphs, *blockSize, bkey,
+                                                             ArithHomFA::CKKSPredicate::getReferences());
+      spdlog::debug("Constructed the product block runner");
+      runner.setRelinKeys(relinKeys);
+      run_multi(context, runner, istream, trgswInput, ostreams);
+    } else {
+      auto runner = ArithHomFA::makeMultiSpecBlockRunner<mode>(context, config.scale, graphs, *blockSize, bkey,
+                                                               ArithHomFA::CKKSPredicate::getReferences());
+      spdlog::debug("Constructed the multi-specification block runner");
+      runner.setRelinKeys(relinKeys);
+      run_multi(context, runner, istream, trgswInput, ostreams);
+    }
+  }
+
+  template<ArithHomFA::RunnerMode mode>
+  void do_server(const ArithHomFA::SealConfig &config, const std::string &spec_filename,
+                 const std::string &bkey_filename, const std::string &relinKeysPath, const std::string &socketPath,
+                 std::size_t numThreads, std::optional<std::size_t> boot_interval,
+                 std::optional<std::size_t> blockSize, bool reversed) {
+    const seal::SEALContext context = config.makeContext();
+    spdlog::debug("Parameters:");
+    spdlog::debug("\tscale: {}", config.scale);
+    spdlog::debug("\tspec_filename: {}", spec_filename);
+    spdlog::debug("\tbkey_filename: {}", bkey_filename);
+    spdlog::debug("\trelinKeysPath: {}", relinKeysPath);
+    spdlog::debug("\tsocketPath: {}", socketPath);
+    spdlog::debug("\tnumThreads: {}", numThreads);
+    if (boot_interval) {
+      spdlog::debug("\tboot_interval: {}", *boot_interval);
+    } else {
+      spdlog::debug("\tblockSize: {}", *blockSize);
+    }
+    // The keys and the specification are loaded only once and shared by all the sessions
+    const auto bkey = ArithHomFA::loadBootstrappingKey(bkey_filename);
+    assert(bkey.ekey && bkey.tlwel1_trlwel1_ikskey && bkey.bkfft && bkey.kskh2m && bkey.kskm2l);
+    seal::RelinKeys relinKeys;
+    {
+      std::ifstream relinKeysStream(relinKeysPath);
+      if (!relinKeysStream) {
+        spdlog::error("Failed to open the relinearization key", strerror(errno));
+        exit(1);
+      }
+      relinKeys.load(context, relinKeysStream);
+    }
+    const Graph graph = Graph::from_file(spec_filename);
+
+    auto factory = [&]() -> std::unique_ptr<ArithHomFA::AbstractRunner<mode>> {
+      if (boot_interval) {
+        auto runner = std::make_unique<ArithHomFA::ReverseRunner<mode>>(
+            context, config.scale, graph, *boot_interval, bkey, ArithHomFA::CKKSPredicate::getReferences(), reversed);
+        runner->setRelinKeys(relinKeys);
+        return runner;
+      } else {
+        auto runner = std::make_unique<ArithHomFA::BlockRunner<mode>>(context, config.scale, graph, *blockSize, bkey,
+                                                                      ArithHomFA::CKKSPredicate::getReferences());
+        runner->setRelinKeys(relinKeys);
+        return runner;
+      }
+    };
+    ArithHomFA::MonitoringServer<mode> server(context, socketPath, numThreads, factory);
+    server.serve();
   }
 
   template<ArithHomFA::RunnerMode mode>
   void do_block(const ArithHomFA::SealConfig &config, const std::string &spec_filename,
                 const std::string &bkey_filename, const std::string &relinKeysPath, std::istream &istream,
-                std::ostream &ostream, int blockSize, const std::optional<std::string> &debug_skey) {
+                std::ostream &ostream, int blockSize, bool numa, const std::optional<std::string> &trgswInput,
+                const std::optional<std::string> &debug_skey, std::optional<std::size_t> pack, bool rawOutput) {
     const seal::SEALContext context = config.makeContext();
     spdlog::debug("Parameters:");
     spdlog::debug("\tscale: {}", config.scale);
@@ -379,7 +1071,11 @@ namespace {
     spdlog::debug("\tbkey_filename: {}", bkey_filename);
     spdlog::debug("\trelinKeysPath: {}", relinKeysPath);
     spdlog::debug("\tblockSize: {}", blockSize);
-    auto bkey = read_from_archive<ArithHomFA::BootstrappingKey>(bkey_filename);
+    spdlog::debug("\tnuma: {}", numa);
+    if (pack) {
+      spdlog::debug("\tpack: {}", *pack);
+    }
+    auto bkey = ArithHomFA::loadBootstrappingKey(bkey_filename);
     assert(bkey.ekey && bkey.tlwel1_trlwel1_ikskey && bkey.bkfft && bkey.kskh2m && bkey.kskm2l);
     seal::RelinKeys relinKeys;
     {
@@ -391,11 +1087,29 @@ namespace {
       relinKeys.load(context, relinKeysStream);
     }
 
+    if (trgswInput) {
+      TRGSWLvl1InputStreamFromCtxtFile trgswStream(*trgswInput);
+      ArithHomFA::BlockRunner<mode> runner(context, config.scale, spec_filename, blockSize, bkey,
+                                           ArithHomFA::CKKSPredicate::getReferences());
+      if (numa) {
+        use_numa(runner);
+      }
+      run_raw(runner, trgswStream, ostream, rawOutput);
+      return;
+    }
+
     ArithHomFA::BlockRunner<mode> runner(context, config.scale, spec_filename, blockSize, bkey,
                                          ArithHomFA::CKKSPredicate::getReferences());
     spdlog::debug("Constructed the block runner");
     runner.setRelinKeys(relinKeys);
-    run_online(context, &runner, istream, ostream, debug_skey);
+    if (numa) {
+      use_numa(runner);
+    }
+    if (pack) {
+      run_packed(context, runner, istream, ostream, *pack, rawOutput);
+      return;
+    }
+    run_online(context, &runner, istream, ostream, debug_skey, rawOutput);
   }
 
   void dumpBasicInfo(int argc, char **argv) {
@@ -427,6 +1141,11 @@ namespace {
 #else
     spdlog::info("\tProfiling: disabled");
 #endif
+#if defined(HOMFA_RUNTIME_DISPATCH)
+    spdlog::info("\tRuntime CPU dispatch: enabled");
+#else
+    spdlog::info("\tRuntime CPU dispatch: disabled");
+#endif
 
     // Show execution setting
     spdlog::info("Executed with:");
@@ -442,9 +1161,13 @@ namespace {
         ss << "CPUPROFILE=" << envvar << " ";
       if (char *envvar = std::getenv("HEAPPROFILE"); envvar != nullptr)
         ss << "HEAPPROFILE=" << envvar << " ";
+      if (char *envvar = std::getenv("AHOMFA_CPU_LEVEL"); envvar != nullptr)
+        ss << "AHOMFA_CPU_LEVEL=" << envvar << " ";
       spdlog::info("\tEnv var: {}", ss.str());
     }
     spdlog::info("\tConcurrency:\t{}", std::thread::hardware_concurrency());
+    spdlog::info("\tCPU kernels:\t{} (detected: {})", cpu_level_name(cpu_level()),
+                 cpu_level_name(detect_cpu_level()));
 
     spdlog::info(R"(============================================================)");
   }
@@ -462,6 +1185,9 @@ int main(int argc, char **argv) {
   register_offline(app, args);
   register_reverse(app, args);
   register_block(app, args);
+  register_server(app, args);
+  register_convert(app, args);
+  register_multi(app, args);
 
   CLI11_PARSE(app, argc, argv);
 
@@ -498,31 +1224,62 @@ int main(int argc, char **argv) {
     }
     case TYPE::OFFLINE: {
       if (args.runnerMode == ArithHomFA::RunnerMode::normal) {
-        do_offline<ArithHomFA::RunnerMode::normal>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, *args.bootstrapping_freq);
+        do_offline<ArithHomFA::RunnerMode::normal>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, args.bootstrapping_freq, args.failure_probability, args.max_cmux_depth, args.batch_size.value_or(1), args.inputPath, args.streaming, args.trgswInput, args.pack, args.raw_output);
       } else if (args.runnerMode == ArithHomFA::RunnerMode::fast) {
-        do_offline<ArithHomFA::RunnerMode::fast>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, *args.bootstrapping_freq);
+        do_offline<ArithHomFA::RunnerMode::fast>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, args.bootstrapping_freq, args.failure_probability, args.max_cmux_depth, args.batch_size.value_or(1), args.inputPath, args.streaming, args.trgswInput, args.pack, args.raw_output);
       } else if (args.runnerMode == ArithHomFA::RunnerMode::slow) {
-        do_offline<ArithHomFA::RunnerMode::slow>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, *args.bootstrapping_freq);
+        do_offline<ArithHomFA::RunnerMode::slow>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, args.bootstrapping_freq, args.failure_probability, args.max_cmux_depth, args.batch_size.value_or(1), args.inputPath, args.streaming, args.trgswInput, args.pack, args.raw_output);
       }
       break;
     }
     case TYPE::REVERSE: {
       if (args.runnerMode == ArithHomFA::RunnerMode::normal) {
-        do_reverse<ArithHomFA::RunnerMode::normal>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, *args.bootstrapping_freq, args.reversed, args.debug_skey);
+        do_reverse<ArithHomFA::RunnerMode::normal>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, args.bootstrapping_freq, args.failure_probability, args.max_cmux_depth, args.reversed, args.pipeline_depth, args.numa, args.trgswInput, args.debug_skey, args.raw_output);
       } else if (args.runnerMode == ArithHomFA::RunnerMode::fast) {
-        do_reverse<ArithHomFA::RunnerMode::fast>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, *args.bootstrapping_freq, args.reversed, args.debug_skey);
+        do_reverse<ArithHomFA::RunnerMode::fast>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, args.bootstrapping_freq, args.failure_probability, args.max_cmux_depth, args.reversed, args.pipeline_depth, args.numa, args.trgswInput, args.debug_skey, args.raw_output);
       } else if (args.runnerMode == ArithHomFA::RunnerMode::slow) {
-        do_reverse<ArithHomFA::RunnerMode::slow>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, *args.bootstrapping_freq, args.reversed, args.debug_skey);
+        do_reverse<ArithHomFA::RunnerMode::slow>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, args.bootstrapping_freq, args.failure_probability, args.max_cmux_depth, args.reversed, args.pipeline_depth, args.numa, args.trgswInput, args.debug_skey, args.raw_output);
       }
       break;
     }
     case TYPE::BLOCK: {
       if (args.runnerMode == ArithHomFA::RunnerMode::normal) {
-        do_block<ArithHomFA::RunnerMode::normal>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, *args.output_freq, args.debug_skey);
+        do_block<ArithHomFA::RunnerMode::normal>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, *args.output_freq, args.numa, args.trgswInput, args.debug_skey, args.pack, args.raw_output);
+      } else if (args.runnerMode == ArithHomFA::RunnerMode::fast) {
+        do_block<ArithHomFA::RunnerMode::fast>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, *args.output_freq, args.numa, args.trgswInput, args.debug_skey, args.pack, args.raw_output);
+      } else if (args.runnerMode == ArithHomFA::RunnerMode::slow) {
+        do_block<ArithHomFA::RunnerMode::slow>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, *args.output_freq, args.numa, args.trgswInput, args.debug_skey, args.pack, args.raw_output);
+      }
+      break;
+    }
+    case TYPE::SERVER: {
+      const std::size_t numThreads = args.threads.value_or(std::thread::hardware_concurrency());
+      if (args.runnerMode == ArithHomFA::RunnerMode::normal) {
+        do_server<ArithHomFA::RunnerMode::normal>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.socket, numThreads, args.bootstrapping_freq, args.output_freq, args.reversed);
+      } else if (args.runnerMode == ArithHomFA::RunnerMode::fast) {
+        do_server<ArithHomFA::RunnerMode::fast>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.socket, numThreads, args.bootstrapping_freq, args.output_freq, args.reversed);
+      } else if (args.runnerMode == ArithHomFA::RunnerMode::slow) {
+        do_server<ArithHomFA::RunnerMode::slow>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.socket, numThreads, args.bootstrapping_freq, args.output_freq, args.reversed);
+      }
+      break;
+    }
+    case TYPE::CONVERT: {
+      if (args.runnerMode == ArithHomFA::RunnerMode::normal) {
+        do_convert<ArithHomFA::RunnerMode::normal>(*args.sealConfig, *args.bkey, *args.relKey, *args.input, *args.output);
+      } else if (args.runnerMode == ArithHomFA::RunnerMode::fast) {
+        do_convert<ArithHomFA::RunnerMode::fast>(*args.sealConfig, *args.bkey, *args.relKey, *args.input, *args.output);
+      } else if (args.runnerMode == ArithHomFA::RunnerMode::slow) {
+        do_convert<ArithHomFA::RunnerMode::slow>(*args.sealConfig, *args.bkey, *args.relKey, *args.input, *args.output);
+      }
+      break;
+    }
+    case TYPE::MULTI: {
+      if (args.runnerMode == ArithHomFA::RunnerMode::normal) {
+        do_multi<ArithHomFA::RunnerMode::normal>(*args.sealConfig, args.specs, args.specDir, *args.outputDir, *args.bkey, *args.relKey, *args.input, args.bootstrapping_freq, args.output_freq, args.reversed, args.product, args.trgswInput);
       } else if (args.runnerMode == ArithHomFA::RunnerMode::fast) {
-        do_block<ArithHomFA::RunnerMode::fast>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, *args.output_freq, args.debug_skey);
+        do_multi<ArithHomFA::RunnerMode::fast>(*args.sealConfig, args.specs, args.specDir, *args.outputDir, *args.bkey, *args.relKey, *args.input, args.bootstrapping_freq, args.output_freq, args.reversed, args.product, args.trgswInput);
       } else if (args.runnerMode == ArithHomFA::RunnerMode::slow) {
-        do_block<ArithHomFA::RunnerMode::slow>(*args.sealConfig, *args.spec, *args.bkey, *args.relKey, *args.input, *args.output, *args.output_freq, args.debug_skey);
+        do_multi<ArithHomFA::RunnerMode::slow>(*args.sealConfig, args.specs, args.specDir, *args.outputDir, *args.bkey, *args.relKey, *args.input, args.bootstrapping_freq, args.output_freq, args.reversed, args.product, args.trgswInput);
       }
       break;
     }
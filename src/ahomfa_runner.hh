@@ -18,6 +18,7 @@
 #include "ckks_predicate.hh"
 #include "ckks_to_tfhe.hh"
 #include "key_loader.hh"
+#include "mapped_bootstrapping_key.hh"
 #include "seal_config.hh"
 #include "sized_cipher_reader.hh"
 #include "sized_cipher_writer.hh"
@@ -37,7 +38,7 @@ namespace ArithHomFA {
     PointwiseRunner(const ArithHomFA::SealConfig &config, const std::string &bkey_filename,
                     const std::string &relinKeysPath, std::istream &istream, std::ostream &ostream)
         : context(config.makeContext()), predicate(context, config.scale),
-          bkey(read_from_archive<ArithHomFA::BootstrappingKey>(bkey_filename)),
+          bkey(ArithHomFA::loadBootstrappingKey(bkey_filename)),
           relinKeys(KeyLoader::loadRelinKeys(context, relinKeysPath)), reader(istream), ckksWriter(ostream),
           tlweWriter(ostream) {
       predicate.setRelinKeys(this->relinKeys);
@@ -5,15 +5,29 @@
 
 #include <spdlog/spdlog.h>
 
-BackstreamDFARunner::BackstreamDFARunner(Graph graph, size_t boot_interval,
-                                         std::optional<size_t> input_size,
-                                         std::shared_ptr<EvalKey> eval_key,
-                                         bool sanitize_result)
-    : graph_(std::move(graph)),
+BackstreamDFARunner::BackstreamDFARunner(
+    Graph graph, size_t boot_interval, std::optional<size_t> input_size,
+    std::shared_ptr<EvalKey> eval_key, bool sanitize_result,
+    std::shared_ptr<TFHEpp::TLWE2TRLWEIKSKey<TFHEpp::lvl11param>> iks_key)
+    : BackstreamDFARunner(
+          std::move(graph),
+          std::make_unique<IntervalBootstrappingPolicy>(boot_interval),
+          std::move(input_size), std::move(eval_key), sanitize_result,
+          std::move(iks_key))
+{
+}
+
+BackstreamDFARunner::BackstreamDFARunner(
+    Graph graph, std::unique_ptr<BootstrappingPolicy> policy,
+    std::optional<size_t> input_size, std::shared_ptr<EvalKey> eval_key,
+    bool sanitize_result,
+    std::shared_ptr<TFHEpp::TLWE2TRLWEIKSKey<TFHEpp::lvl11param>> iks_key)
+    : graph_(graph.bfs_ordered()),
       weight_(graph_.size()),
       eval_key_(std::move(eval_key)),
+      iks_key_(std::move(iks_key)),
       input_size_(std::move(input_size)),
-      boot_interval_(boot_interval),
+      policy_(std::move(policy)),
       num_processed_inputs_(0),
       trlwelvl1_trivial_0_(trivial_TRLWELvl1_zero()),
       trlwelvl1_trivial_1_(trivial_TRLWELvl1_1over2()),
@@ -21,6 +35,7 @@ BackstreamDFARunner::BackstreamDFARunner(Graph graph, size_t boot_interval,
       workspace_(graph_.size())
 {
     assert(eval_key_);
+    assert(policy_);
 
     if (sanitize_result_)
         error_die("Sanitization of results is not implemented");
@@ -28,43 +43,83 @@ BackstreamDFARunner::BackstreamDFARunner(Graph graph, size_t boot_interval,
     if (input_size_)
         graph_.reserve_states_at_depth(*input_size_);
 
-    for (Graph::State st = 0; st < graph_.size(); st++)
-        weight_.at(st) = graph_.is_final_state(st) ? trlwelvl1_trivial_1_
-                                                   : trlwelvl1_trivial_0_;
+    if (graph_.num_outputs() > 1 && !iks_key_)
+        error_die("The key for TLWE-to-TRLWE key switching is necessary "
+                  "for an automaton with several outputs");
+
+    // The i-th coefficient of the weight is 1/2 iff the state is final for
+    // the i-th output. Thus, each CMUX propagates all the outputs at once.
+    for (Graph::State st = 0; st < graph_.size(); st++) {
+        weight_.at(st) = trlwelvl1_trivial_0_;
+        for (size_t i = 0; i < graph_.num_outputs(); i++)
+            if (graph_.is_final_state(st, i))
+                weight_.at(st)[1][i] = trlwelvl1_trivial_1_[1][0];
+    }
+    // The weights of inactive states are never written, so both of the
+    // buffers must hold them
+    workspace_ = weight_;
+
+    const std::vector<bool> reachable = graph_.reachable_states(),
+                            constant = graph_.constant_states();
+    active_.resize(graph_.size());
+    for (Graph::State st = 0; st < graph_.size(); st++) {
+        active_.at(st) = reachable.at(st) && !constant.at(st);
+        if (active_.at(st))
+            active_states_.push_back(st);
+    }
+    spdlog::debug("{} of {} states are skipped as constant or unreachable",
+                  graph_.size() - active_states_.size(), graph_.size());
+    active_batch_ = plan_cmux(active_states_);
+    spdlog::debug("{} CMUXes are computed for {} states",
+                  active_batch_.cmux_states.size(), active_states_.size());
 }
 
-TLWELvl1 BackstreamDFARunner::result() const
+TLWELvl1 BackstreamDFARunner::result(size_t output) const
 {
+    assert(output < graph_.num_outputs());
     TLWELvl1 ret;
     TFHEpp::SampleExtractIndex<Lvl1>(ret, weight_.at(graph_.initial_state()),
-                                     0);
+                                     output);
     return ret;
 }
 
 void BackstreamDFARunner::eval(const TRGSWLvl1FFT& input)
 {
-    std::vector<TRLWELvl1>& out = workspace_;
+    TRLWELvl1Vector& out = workspace_;
     out.resize(graph_.size());
 
-    std::optional<std::vector<Graph::State>> states;
+    const std::vector<Graph::State>* states = &active_states_;
+    const CMUXBatch* batch = &active_batch_;
     if (input_size_) {
         int j = *input_size_ - num_processed_inputs_;
         assert(j > 0);
-        states.emplace(graph_.states_at_depth(j - 1));
-    }
-    else {
-        states.emplace(graph_.all_states());
+        states_workspace_.clear();
+        for (Graph::State q : graph_.states_at_depth(j - 1))
+            if (active_.at(q))
+                states_workspace_.push_back(q);
+        states = &states_workspace_;
+        batch_workspace_ = plan_cmux(states_workspace_);
+        batch = &batch_workspace_;
     }
 
-    timer_.timeit(TimeRecorder::TARGET::CMUX, states->size(), [&] {
-        std::for_each(std::execution::par, states->begin(), states->end(),
-                      [&](Graph::State q) {
-                          Graph::State q0 = graph_.next_state(q, false),
-                                       q1 = graph_.next_state(q, true);
-                          const TRLWELvl1 &w0 = weight_.at(q0),
-                                          &w1 = weight_.at(q1);
-                          TFHEpp::CMUXFFT<Lvl1>(out.at(q), input, w1, w0);
-                      });
+    timer_.timeit(TimeRecorder::TARGET::CMUX, batch->cmux_states.size(), [&] {
+        if (executor_) {
+            // Each node reads its own replica of the input
+            executor_->on_each_node(
+                [&](size_t node) { *input_replicas_.at(node) = input; });
+            executor_->parallel_for(
+                executor_->shards_of(batch->cmux_states, graph_.size()),
+                [&](size_t node, size_t i) {
+                    auto [q0, q1] = batch->cmux_children.at(i);
+                    CMUXFFTLvl1(out.at(batch->cmux_states.at(i)),
+                                *input_replicas_.at(node), weight_.at(q1),
+                                weight_.at(q0));
+                });
+            batch->copy(out, weight_);
+        }
+        else {
+            batch_CMUXFFT(out, input, weight_, *batch);
+        }
     });
     {
         using std::swap;
@@ -72,21 +127,64 @@ void BackstreamDFARunner::eval(const TRGSWLvl1FFT& input)
     }
 
     num_processed_inputs_++;
-    if (eval_key_ && num_processed_inputs_ % boot_interval_ == 0) {
-        spdlog::debug("Bootstrapping occurred");
-        bootstrap_weight(*states);
+    std::vector<Graph::State> targets = policy_->after_cmux(graph_, *states);
+    if (eval_key_ && !targets.empty()) {
+        spdlog::debug("Bootstrapping occurred for {} states", targets.size());
+        bootstrap_weight(targets);
     }
 }
 
+CMUXBatch BackstreamDFARunner::plan_cmux(
+    const std::vector<Graph::State>& states) const
+{
+    return CMUXBatch::plan(states, [&](Graph::State q) {
+        return std::make_pair(graph_.next_state(q, false),
+                              graph_.next_state(q, true));
+    });
+}
+
 void BackstreamDFARunner::bootstrap_weight(
     const std::vector<Graph::State>& targets)
 {
     assert(eval_key_);
+    auto bootstrap = [&](Graph::State q) {
+        TRLWELvl1& w = weight_.at(q);
+        if (graph_.num_outputs() == 1)
+            do_SEI_IKS_GBTLWE2TRLWE_2(w, *eval_key_);
+        else
+            do_SEI_IKS_GBTLWE2TRLWE_multi(w, graph_.num_outputs(), *eval_key_,
+                                          *iks_key_);
+    };
     timer_.timeit(TimeRecorder::TARGET::BOOTSTRAPPING, targets.size(), [&] {
-        std::for_each(std::execution::par, targets.begin(), targets.end(),
-                      [&](Graph::State q) {
-                          TRLWELvl1& w = weight_.at(q);
-                          do_SEI_IKS_GBTLWE2TRLWE_2(w, *eval_key_);
-                      });
+        if (executor_)
+            executor_->parallel_for(
+                executor_->shards_of(targets, graph_.size()),
+                [&](size_t, size_t i) { bootstrap(targets.at(i)); });
+        else
+            std::for_each(std::execution::par, targets.begin(), targets.end(),
+                          bootstrap);
+    });
+}
+
+void BackstreamDFARunner::set_executor(std::shared_ptr<NumaExecutor> executor)
+{
+    executor_ = std::move(executor);
+
+    // Move the weights to the nodes processing them. The new arrays are not
+    // touched until they are written by the workers of the nodes.
+    TRLWELvl1Vector weight, workspace;
+    weight.resize(graph_.size());
+    workspace.resize(graph_.size());
+    executor_->parallel_for(executor_->shards(graph_.size()),
+                            [&](size_t, size_t q) {
+                                weight.at(q) = weight_.at(q);
+                                workspace.at(q) = workspace_.at(q);
+                            });
+    weight_ = std::move(weight);
+    workspace_ = std::move(workspace);
+
+    input_replicas_.resize(executor_->num_nodes());
+    executor_->on_each_node([&](size_t node) {
+        input_replicas_.at(node) = std::make_unique<TRGSWLvl1FFT>();
     });
 }
@@ -1,25 +1,42 @@
 #ifndef HOMFA_BACKSTREAM_DFA_RUNNER_HPP
 #define HOMFA_BACKSTREAM_DFA_RUNNER_HPP
 
+#include "bootstrapping_policy.hpp"
 #include "graph.hpp"
+#include "numa_executor.hpp"
 #include "tfhepp_util.hpp"
 #include "timeit.hpp"
 
+#include <memory>
 #include <optional>
 
 class BackstreamDFARunner {
 private:
     Graph graph_;
-    std::vector<TRLWELvl1> weight_;
+    TRLWELvl1Vector weight_;
     std::shared_ptr<EvalKey> eval_key_;
+    // Used to bootstrap the weights of an automaton with several outputs
+    std::shared_ptr<TFHEpp::TLWE2TRLWEIKSKey<TFHEpp::lvl11param>> iks_key_;
     std::optional<size_t> input_size_;
-    const size_t boot_interval_;
+    std::unique_ptr<BootstrappingPolicy> policy_;
     size_t num_processed_inputs_;
     const TRLWELvl1 trlwelvl1_trivial_0_, trlwelvl1_trivial_1_;
     bool sanitize_result_;
+    // active_[q] is false iff the weight of q never changes or never affects
+    // the result, i.e., q is constant or unreachable from the initial state.
+    // The weights of such states are neither CMUXed nor bootstrapped.
+    std::vector<bool> active_;
+    std::vector<Graph::State> active_states_;
+    CMUXBatch active_batch_;
+    // If set, the CMUXes and the bootstrapping of the weights in a shard are
+    // run on the NUMA node owning the shard
+    std::shared_ptr<NumaExecutor> executor_;
+    std::vector<std::unique_ptr<TRGSWLvl1FFT>> input_replicas_;
 
     // Workspace for eval
-    std::vector<TRLWELvl1> workspace_;
+    TRLWELvl1Vector workspace_;
+    std::vector<Graph::State> states_workspace_;
+    CMUXBatch batch_workspace_;
 
     TimeRecorder timer_;
 
@@ -27,7 +44,18 @@ public:
     BackstreamDFARunner(Graph graph, size_t boot_interval,
                         std::optional<size_t> input_size,
                         std::shared_ptr<EvalKey> eval_key,
-                        bool sanitize_result);
+                        bool sanitize_result,
+                        std::shared_ptr<
+                            TFHEpp::TLWE2TRLWEIKSKey<TFHEpp::lvl11param>>
+                            iks_key = nullptr);
+    BackstreamDFARunner(Graph graph,
+                        std::unique_ptr<BootstrappingPolicy> policy,
+                        std::optional<size_t> input_size,
+                        std::shared_ptr<EvalKey> eval_key,
+                        bool sanitize_result,
+                        std::shared_ptr<
+                            TFHEpp::TLWE2TRLWEIKSKey<TFHEpp::lvl11param>>
+                            iks_key = nullptr);
 
     const Graph& graph() const
     {
@@ -39,10 +67,12 @@ public:
         return timer_;
     }
 
-    TLWELvl1 result() const;
+    TLWELvl1 result(size_t output = 0) const;
     void eval(const TRGSWLvl1FFT& input);
+    void set_executor(std::shared_ptr<NumaExecutor> executor);
 
 private:
+    CMUXBatch plan_cmux(const std::vector<Graph::State>& states) const;
     void bootstrap_weight(const std::vector<Graph::State>& targets);
 };
 
@@ -38,6 +38,7 @@ namespace ArithHomFA {
         : runner(graph, std::numeric_limits<std::size_t>::max(), *bkey.ekey, false), predicate(context, scale),
           bkey(bkey), converter(context), references(references), blockSize(blockSize) {
       converter.initializeConverter(this->bkey);
+      converter.prepareAmplifiers(this->references, scale);
       queued_inputs_.reserve(predicate.getPredicateSize() * blockSize);
       // The trivial TLWE representing true
       latestResult[TFHEpp::lvl1param::n] = (1u << 31); // 1/2
@@ -57,11 +58,96 @@ namespace ArithHomFA {
       this->timer.predicate.tic();
       predicate.eval(valuations, ckksCiphers);
       this->timer.predicate.toc();
+      feedPredicates(std::move(ckksCiphers));
+      this->timer.total.toc();
+
+      return latestResult;
+    }
+
+    /*!
+     * @brief Feeds the valuations of several time steps packed by CKKSPackedEncoder
+     *
+     * The predicates are evaluated once for all the time steps, and the slots of the results are extracted for each
+     * time step. The modulus chain needs one more level than in feed() for the extraction.
+     *
+     * @param [in] valuations The packed valuations, where the i-th slot of valuations.at(j) is the j-th signal at the
+     * i-th time step
+     * @param [in] numSteps The number of the time steps in the slots
+     * @returns The results after feeding each time step, which change only block-wise as in feed()
+     *
+     * @pre The predicate does not depend on the previous valuations
+     */
+    std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>> feedPacked(const std::vector<seal::Ciphertext> &valuations,
+                                                            std::size_t numSteps) {
+      this->timer.total.tic();
+      assert(valuations.size() == predicate.getSignalSize());
+      const std::size_t predicateSize = ArithHomFA::CKKSPredicate::getPredicateSize();
+      std::vector<seal::Ciphertext> results(predicateSize);
+      this->timer.predicate.tic();
+      predicate.evalPacked(valuations, results);
+      std::vector<std::vector<seal::Ciphertext>> ckksCiphers(numSteps, std::vector<seal::Ciphertext>(predicateSize));
+#pragma omp parallel for collapse(2) default(none) shared(numSteps, predicateSize, results, ckksCiphers, converter)
+      for (std::size_t step = 0; step < numSteps; ++step) {
+        for (std::size_t i = 0; i < predicateSize; ++i) {
+          converter.extractSlot(results.at(i), step, ckksCiphers.at(step).at(i));
+        }
+      }
+      this->timer.predicate.toc();
+
+      std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>> monitoringResults;
+      monitoringResults.reserve(numSteps);
+      for (auto &ciphers: ckksCiphers) {
+        feedPredicates(std::move(ciphers));
+        monitoringResults.push_back(latestResult);
+      }
+      this->timer.total.toc();
+
+      return monitoringResults;
+    }
+
+    /*!
+     * @brief Directly feeds the TRGSW ciphertexts of the predicates at a time step to the DFA
+     *
+     * As in feed(), the DFA is evaluated only when a block is filled.
+     */
+    TFHEpp::TLWE<TFHEpp::lvl1param> feedRaw(const std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>> &ciphers) {
+      this->timer.total.tic();
+      std::copy(ciphers.begin(), ciphers.end(), std::back_inserter(queued_trgsws_));
+      if (queued_trgsws_.size() >= predicate.getPredicateSize() * blockSize) {
+        this->timer.dfa.tic();
+        for (const auto &trgsw: queued_trgsws_) {
+          runner.eval_one(trgsw);
+        }
+        latestResult = runner.result();
+        this->timer.dfa.toc();
+        queued_trgsws_.clear();
+      }
+      this->timer.total.toc();
+
+      return latestResult;
+    }
+
+    void setRelinKeys(const seal::RelinKeys &keys) {
+      this->predicate.setRelinKeys(keys);
+    }
+
+    /*!
+     * @brief Runs the DFA evaluation on the workers pinned to the NUMA nodes
+     */
+    void setExecutor(std::shared_ptr<NumaExecutor> executor) {
+      runner.set_executor(std::move(executor));
+    }
+
+  private:
+    /*!
+     * @brief Queues the CKKS ciphertexts of the predicates at a time step and evaluates the DFA if a block is filled
+     */
+    void feedPredicates(std::vector<seal::Ciphertext> &&ckksCiphers) {
       std::move(ckksCiphers.begin(), ckksCiphers.end(), std::back_inserter(queued_inputs_));
 
       // We do not construct TRGSW until the queue is filled
       if (queued_inputs_.size() < predicate.getPredicateSize() * blockSize) {
-        return latestResult;
+        return;
       }
 
       // Construct TRGSW
@@ -100,16 +186,8 @@ namespace ArithHomFA {
       this->timer.dfa.tic();
       latestResult = runner.result();
       this->timer.dfa.toc();
-      this->timer.total.toc();
-
-      return latestResult;
-    }
-
-    void setRelinKeys(const seal::RelinKeys &keys) {
-      this->predicate.setRelinKeys(keys);
     }
 
-  private:
     OnlineDFARunner4 runner;
     CKKSPredicate predicate;
     const BootstrappingKey &bkey;
@@ -117,6 +195,7 @@ namespace ArithHomFA {
     const std::vector<double> references;
     const std::size_t blockSize;
     std::vector<seal::Ciphertext> queued_inputs_;
+    std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>> queued_trgsws_;
     TFHEpp::TLWE<TFHEpp::lvl1param> latestResult{};
     // temporary variables
     std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>> tlwes;
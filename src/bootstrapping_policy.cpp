@@ -0,0 +1,248 @@
+#include "bootstrapping_policy.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include <tfhe++.hpp>
+
+/* IntervalBootstrappingPolicy */
+IntervalBootstrappingPolicy::IntervalBootstrappingPolicy(size_t interval)
+    : interval_(interval), num_processed_inputs_(0)
+{
+    assert(interval_ > 0);
+}
+
+std::vector<Graph::State> IntervalBootstrappingPolicy::after_cmux(
+    const Graph&, const std::vector<Graph::State>& states)
+{
+    if (++num_processed_inputs_ % interval_ == 0)
+        return states;
+    return {};
+}
+
+/* DepthBootstrappingPolicy */
+DepthBootstrappingPolicy::DepthBootstrappingPolicy(size_t max_depth)
+    : max_depth_(max_depth)
+{
+    assert(max_depth_ > 0);
+}
+
+size_t DepthBootstrappingPolicy::depth(Graph::State state) const
+{
+    return depth_.at(state);
+}
+
+std::vector<Graph::State> DepthBootstrappingPolicy::after_cmux(
+    const Graph& graph, const std::vector<Graph::State>& states)
+{
+    // The initial weights are trivial, i.e., not yet processed by CMUX
+    if (depth_.size() != graph.size()) {
+        depth_.assign(graph.size(), 0);
+        next_depth_.assign(graph.size(), 0);
+    }
+
+    // Only the weights reaching the limit are bootstrapped
+    std::vector<Graph::State> targets;
+    for (Graph::State q : states) {
+        size_t d = std::max(depth_.at(graph.next_state(q, false)),
+                            depth_.at(graph.next_state(q, true))) +
+                   1;
+        if (d >= max_depth_) {
+            targets.push_back(q);
+            d = 0;
+        }
+        next_depth_.at(q) = d;
+    }
+    {
+        using std::swap;
+        swap(depth_, next_depth_);
+    }
+
+    return targets;
+}
+
+/* NoiseModel */
+namespace {
+// Key coefficients of Lvl0 are binary, and those of Lvl1 and Lvl2 are ternary
+struct KeyStatistics {
+    double variance, expectation;
+};
+constexpr KeyStatistics binary_key{1. / 4, 1. / 2}, ternary_key{2. / 3, 0.};
+
+template <class P>
+double modulus()
+{
+    return std::pow(2., std::numeric_limits<typename P::T>::digits);
+}
+
+// extpnoisecalc in scripts/noise-estimation.py
+template <class P>
+double extp_noise(double alpha, KeyStatistics key)
+{
+    const double q = modulus<P>(), n = P::n, k = P::k, l = P::l,
+                 Bg = std::pow(2., P::Bgbit), Bgl2 = std::pow(Bg, 2 * l);
+    const double res1 = l * (k + 1.) * n * (Bg * Bg + 2.) / 12. * alpha * alpha;
+    const double res2 = Bg * Bg / 2;
+    const double res3 = (q * q - Bgl2) / (24 * Bgl2) *
+                        (1. + k * n * (key.variance + key.expectation *
+                                                          key.expectation));
+    const double res4 = k * n / 8 * key.variance;
+    const double res5 = 1 / 16. * std::pow(1. - k * n * key.expectation, 2);
+    return res1 + res2 + res3 + res4 + res5;
+}
+
+// brnoisecalc in scripts/noise-estimation.py
+template <class LowP, class HighP>
+double br_noise(KeyStatistics high_key)
+{
+    return LowP::k * LowP::n *
+           extp_noise<HighP>(HighP::α * modulus<HighP>(), high_key);
+}
+
+// Variance of the rounding in key switching
+template <class LowP, class FuncP>
+double ks_round_noise(double roundwidth, KeyStatistics high_key)
+{
+    const double round_variance = roundwidth * roundwidth / 12 - 1. / 12,
+                 round_expectation = -1. / 2;
+    return round_variance * high_key.variance +
+           round_variance * high_key.expectation * high_key.expectation +
+           round_expectation * round_expectation * high_key.variance +
+           FuncP::t * std::pow(LowP::α * modulus<LowP>(), 2);
+}
+
+// iksnoisecalc in scripts/noise-estimation.py
+template <class LowP, class HighP, class FuncP>
+double iks_noise(KeyStatistics high_key)
+{
+    const double roundwidth =
+        std::pow(2., -static_cast<double>(FuncP::basebit * FuncP::t) - 1) *
+        modulus<LowP>();
+    return HighP::k * HighP::n *
+           ks_round_noise<LowP, FuncP>(2 * roundwidth, high_key);
+}
+
+// privksnoisecalc in scripts/noise-estimation.py
+template <class LowP, class HighP, class FuncP>
+double privks_noise(KeyStatistics high_key)
+{
+    const double roundwidth =
+        std::pow(2., -static_cast<double>(FuncP::basebit * FuncP::t) - 1) *
+        modulus<LowP>();
+    return (HighP::k * HighP::n + 1) *
+           ks_round_noise<LowP, FuncP>(roundwidth, high_key);
+}
+
+// brroundnoise in scripts/noise-estimation.py
+template <class DomainP, class TargetP>
+double br_round_noise(KeyStatistics domain_key)
+{
+    const double roundwidth = modulus<DomainP>() / (4 * TargetP::n);
+    const double round_variance =
+                     (2 * roundwidth) * (2 * roundwidth) / 12 - 1. / 12,
+                 round_expectation = -1. / 2;
+    return DomainP::k * DomainP::n *
+           (round_variance * domain_key.variance +
+            round_variance * domain_key.expectation * domain_key.expectation +
+            round_expectation * round_expectation * domain_key.variance);
+}
+}  // namespace
+
+NoiseModel NoiseModel::from_tfhepp_params(double trgsw_stddev)
+{
+    using namespace TFHEpp;
+
+    if (trgsw_stddev < 0) {
+        // cbnoisecalc in scripts/noise-estimation.py
+        const double ratio = modulus<lvl1param>() / modulus<lvl2param>();
+        const double cb_variance =
+            br_noise<lvl0param, lvl2param>(ternary_key) * ratio * ratio +
+            privks_noise<lvl1param, lvl2param, lvl21param>(ternary_key);
+        trgsw_stddev = std::sqrt(cb_variance);
+    }
+
+    NoiseModel model;
+    model.bootstrapped_variance = br_noise<lvl0param, lvl1param>(ternary_key);
+    model.packing_variance =
+        privks_noise<lvl1param, lvl1param, lvl11param>(ternary_key);
+    model.cmux_variance = extp_noise<lvl1param>(trgsw_stddev, ternary_key);
+    // The noises after the identity key switching are in the scale of Lvl0
+    const double ratio = modulus<lvl0param>() / modulus<lvl1param>();
+    model.decision_variance =
+        (iks_noise<lvl0param, lvl1param, lvl10param>(ternary_key) +
+         br_round_noise<lvl0param, lvl1param>(binary_key)) /
+        (ratio * ratio);
+    return model;
+}
+
+double NoiseModel::max_variance(double failure_probability) const
+{
+    assert(0 < failure_probability && failure_probability < 1);
+
+    // Find x such that erfc(x) = failure_probability by bisection
+    double lo = 0, hi = 40;
+    for (int i = 0; i < 200; i++) {
+        double mid = (lo + hi) / 2;
+        if (std::erfc(mid) > failure_probability)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    // The bootstrapping decides {0, 1/2} with the margin of 1/4
+    const double margin = modulus<TFHEpp::lvl1param>() / 4;
+    return margin * margin / (2 * hi * hi) - decision_variance;
+}
+
+/* NoiseBootstrappingPolicy */
+NoiseBootstrappingPolicy::NoiseBootstrappingPolicy(const NoiseModel& model,
+                                                   double failure_probability)
+    : model_(model), threshold_(model.max_variance(failure_probability))
+{
+    if (threshold_ < model_.bootstrapped_variance + model_.packing_variance +
+                         model_.cmux_variance)
+        error_die(
+            "The failure probability {} cannot be achieved even if the weights "
+            "are bootstrapped at every input",
+            failure_probability);
+}
+
+double NoiseBootstrappingPolicy::variance(Graph::State state) const
+{
+    return variance_.at(state);
+}
+
+std::vector<Graph::State> NoiseBootstrappingPolicy::after_cmux(
+    const Graph& graph, const std::vector<Graph::State>& states)
+{
+    // The initial weights are trivial, i.e., noiseless
+    if (variance_.size() != graph.size()) {
+        variance_.assign(graph.size(), 0);
+        next_variance_.assign(graph.size(), 0);
+    }
+
+    const double bootstrapped =
+        model_.bootstrapped_variance +
+        (graph.num_outputs() > 1 ? model_.packing_variance : 0);
+    std::vector<Graph::State> targets;
+    for (Graph::State q : states) {
+        double v = std::max(variance_.at(graph.next_state(q, false)),
+                            variance_.at(graph.next_state(q, true))) +
+                   model_.cmux_variance;
+        // Bootstrap now if one more CMUX makes the weight too noisy to be
+        // bootstrapped correctly
+        if (v + model_.cmux_variance > threshold_) {
+            targets.push_back(q);
+            v = bootstrapped;
+        }
+        next_variance_.at(q) = v;
+    }
+    {
+        using std::swap;
+        swap(variance_, next_variance_);
+    }
+
+    return targets;
+}
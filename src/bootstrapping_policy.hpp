@@ -0,0 +1,105 @@
+#ifndef HOMFA_BOOTSTRAPPING_POLICY_HPP
+#define HOMFA_BOOTSTRAPPING_POLICY_HPP
+
+#include "graph.hpp"
+
+#include <vector>
+
+// Policy to decide which weights of BackstreamDFARunner are bootstrapped
+class BootstrappingPolicy {
+public:
+    virtual ~BootstrappingPolicy() = default;
+
+    // Called after the weights of `states` are updated by CMUX. Returns the
+    // states whose weights are bootstrapped right after the call.
+    virtual std::vector<Graph::State> after_cmux(
+        const Graph& graph, const std::vector<Graph::State>& states) = 0;
+};
+
+// Bootstrap all the updated weights once every `interval` inputs
+class IntervalBootstrappingPolicy : public BootstrappingPolicy {
+private:
+    const size_t interval_;
+    size_t num_processed_inputs_;
+
+public:
+    IntervalBootstrappingPolicy(size_t interval);
+
+    std::vector<Graph::State> after_cmux(
+        const Graph& graph, const std::vector<Graph::State>& states) override;
+};
+
+// Track the number of CMUXes applied to each weight since its last
+// bootstrapping, i.e., max(depth of the children) + 1, and bootstrap only the
+// weights whose depth reached max_depth. Unlike IntervalBootstrappingPolicy,
+// the weights not updated at an input, e.g., those of the states unreachable
+// at the depth in the offline algorithm, keep their depth, so bootstrapping is
+// spread across the inputs rather than done for all the states at once.
+class DepthBootstrappingPolicy : public BootstrappingPolicy {
+private:
+    const size_t max_depth_;
+    // The depth of each weight. They are double-buffered in the same way as
+    // the weights.
+    std::vector<size_t> depth_, next_depth_;
+
+public:
+    DepthBootstrappingPolicy(size_t max_depth);
+
+    size_t depth(Graph::State state) const;
+
+    std::vector<Graph::State> after_cmux(
+        const Graph& graph, const std::vector<Graph::State>& states) override;
+};
+
+// Variances of the noise in the weights of BackstreamDFARunner, following
+// scripts/noise-estimation.py. All the variances are in the scale of the
+// discretized torus, i.e., 2^32 for Lvl1.
+struct NoiseModel {
+    // Variance of a weight right after bootstrapping
+    double bootstrapped_variance;
+    // Variance additionally introduced when the outputs are packed back to a
+    // TRLWE by TLWE-to-TRLWE key switching (for several outputs)
+    double packing_variance;
+    // Variance added by a CMUX, i.e., an external product
+    double cmux_variance;
+    // Variance added between SampleExtract and the decision in the
+    // bootstrapping, i.e., by the identity key switching and the rounding
+    // before the blind rotation
+    double decision_variance;
+
+    // The model for the parameters of TFHEpp. The input TRGSW ciphertexts
+    // are assumed to have the noise of circuit bootstrapping unless the
+    // standard deviation is given.
+    static NoiseModel from_tfhepp_params(double trgsw_stddev = -1);
+
+    // The maximum variance of a weight such that the probability of a wrong
+    // bootstrapping is at most failure_probability
+    double max_variance(double failure_probability) const;
+};
+
+// Track the estimated variance of each weight and bootstrap the weights whose
+// variance would exceed the threshold with one more CMUX
+class NoiseBootstrappingPolicy : public BootstrappingPolicy {
+private:
+    const NoiseModel model_;
+    const double threshold_;
+    // The variance of each weight. They are double-buffered in the same way
+    // as the weights.
+    std::vector<double> variance_, next_variance_;
+
+public:
+    NoiseBootstrappingPolicy(const NoiseModel& model,
+                             double failure_probability);
+
+    double threshold() const
+    {
+        return threshold_;
+    }
+
+    double variance(Graph::State state) const;
+
+    std::vector<Graph::State> after_cmux(
+        const Graph& graph, const std::vector<Graph::State>& states) override;
+};
+
+#endif
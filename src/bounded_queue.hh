@@ -0,0 +1,81 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <queue>
+
+namespace ArithHomFA {
+  /*!
+   * @brief Blocking FIFO queue with a bounded capacity to connect pipeline stages
+   *
+   * A producer blocks while the queue is full, and a consumer blocks while the queue is empty. After close() is called,
+   * push() fails immediately, and pop() returns the remaining elements and then std::nullopt.
+   */
+  template<class T>
+  class BoundedQueue {
+  public:
+    explicit BoundedQueue(std::size_t capacity) : capacity(capacity) {
+      assert(capacity > 0);
+    }
+
+    /*!
+     * @brief Pushes a value to the queue, blocking while the queue is full
+     *
+     * @returns false if the queue is closed and the value is discarded
+     */
+    bool push(T value) {
+      std::unique_lock lock(mutex);
+      notFull.wait(lock, [this] { return closed || queue.size() < capacity; });
+      if (closed) {
+        return false;
+      }
+      queue.push(std::move(value));
+      notEmpty.notify_one();
+      return true;
+    }
+
+    /*!
+     * @brief Pops a value from the queue, blocking while the queue is empty
+     *
+     * @returns std::nullopt if the queue is closed and there is no remaining value
+     */
+    std::optional<T> pop() {
+      std::unique_lock lock(mutex);
+      notEmpty.wait(lock, [this] { return closed || !queue.empty(); });
+      if (queue.empty()) {
+        return std::nullopt;
+      }
+      std::optional<T> value = std::move(queue.front());
+      queue.pop();
+      notFull.notify_one();
+      return value;
+    }
+
+    /*!
+     * @brief Closes the queue and wakes up all the blocked producers and consumers
+     */
+    void close() {
+      {
+        std::lock_guard lock(mutex);
+        closed = true;
+      }
+      notFull.notify_all();
+      notEmpty.notify_all();
+    }
+
+  private:
+    const std::size_t capacity;
+    std::queue<T> queue;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable notFull, notEmpty;
+  };
+} // namespace ArithHomFA
@@ -22,6 +22,10 @@ namespace ArithHomFA {
             encoder.encode(value, scale, plain);
         }
 
+        void encode(const double value, seal::parms_id_type parms_id, const double scale, seal::Plaintext &plain) const {
+            encoder.encode(value, parms_id, scale, plain);
+        }
+
         void decode(const seal::Plaintext &plain, double &value) const {
             value = this->decode(plain);
         }
@@ -0,0 +1,111 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <seal/seal.h>
+
+namespace ArithHomFA {
+  /*!
+   * @brief The header of a batch of the ciphertexts encrypted by `ahomfa_util ckks enc --pack`
+   *
+   * Each batch, i.e., the ciphertexts of the signals at up to pack time steps, is preceded by this header written as a
+   * record of its own. The last batch of a trace may have fewer time steps than pack, and its other slots must not be
+   * monitored.
+   */
+  struct PackedBatchHeader {
+    static constexpr std::array<char, 4> expectedMagic = {'A', 'H', 'P', 'B'};
+
+    std::array<char, 4> magic;
+    //! The number of the time steps in the batch, which are in the first slots
+    uint32_t numSteps;
+
+    static PackedBatchHeader make(std::size_t numSteps) {
+      return {expectedMagic, static_cast<uint32_t>(numSteps)};
+    }
+
+    /*!
+     * @brief Throws if the header is broken or has more time steps than pack
+     */
+    void validate(std::size_t pack) const {
+      if (magic != expectedMagic) {
+        throw std::runtime_error("The ciphertexts are not encrypted by `ahomfa_util ckks enc --pack`");
+      }
+      if (numSteps == 0 || numSteps > pack) {
+        throw std::runtime_error("Invalid number of the time steps in a packed batch: " + std::to_string(numSteps));
+      }
+    }
+  };
+
+  /*!
+   * @brief Encoding of the values of a signal at consecutive time steps to the slots of a CKKS plaintext
+   *
+   * Unlike CKKSNoEmbedEncoder, a ciphertext holds up to slotCount() time steps. Since the constant plaintexts of
+   * CKKSNoEmbedEncoder have the same value in all the slots, the predicates are evaluated for all the time steps at
+   * once. The slot of each time step is moved to the constant coefficient by CKKSToTFHE::extractSlot.
+   */
+  class CKKSPackedEncoder {
+  public:
+    explicit CKKSPackedEncoder(const seal::SEALContext &context) : encoder(context) {}
+
+    /*!
+     * @brief The maximum number of the time steps in a plaintext
+     */
+    [[nodiscard]] std::size_t slotCount() const {
+      return encoder.slot_count();
+    }
+
+    /*!
+     * @brief Encode the values to the first values.size() slots. The other slots are zero.
+     *
+     * @pre values.size() <= slotCount()
+     */
+    void encode(const std::vector<double> &values, double scale, seal::Plaintext &plain) const {
+      encoder.encode(values, scale, plain);
+    }
+
+    /*!
+     * @brief Encode the values to the first values.size() slots at the given level. The other slots are zero.
+     *
+     * @pre values.size() <= slotCount()
+     */
+    void encode(const std::vector<double> &values, seal::parms_id_type parms_id, double scale,
+                seal::Plaintext &plain) const {
+      encoder.encode(values, parms_id, scale, plain);
+    }
+
+    /*!
+     * @brief Encode the vector whose index-th slot is one and the other slots are zero
+     *
+     * The i-th coefficient of the resulting plaintext is 2 * scale * cos(i * theta) / N, where exp(I * theta) is the
+     * root of the index-th slot. Therefore, the constant coefficient of the product of a polynomial m and this
+     * plaintext is 2 * scale / N times the real part of the index-th slot of m.
+     */
+    void encodeUnit(std::size_t index, seal::parms_id_type parms_id, double scale, seal::Plaintext &plain) const {
+      std::vector<double> values(slotCount(), 0.0);
+      values.at(index) = 1.0;
+      encoder.encode(values, parms_id, scale, plain);
+    }
+
+    /*!
+     * @brief Decode the first count slots
+     */
+    [[nodiscard]] std::vector<double> decode(const seal::Plaintext &plain, std::size_t count) const {
+      std::vector<double> values;
+      encoder.decode(plain, values);
+      values.resize(count);
+      return values;
+    }
+
+  private:
+    seal::CKKSEncoder encoder;
+  };
+} // namespace ArithHomFA
@@ -5,9 +5,13 @@
 
 #pragma once
 
+#include <cmath>
 #include <vector>
+#include <map>
 #include <memory>
+#include <utility>
 #include <cassert>
+#include <initializer_list>
 
 #include <seal/seal.h>
 
@@ -15,13 +19,62 @@
 #include "../src/ckks_no_embed.hh"
 
 namespace ArithHomFA {
+    /*!
+     * @brief The constants used in CKKSPredicate::evalPredicateInternal, which are encoded by CKKSPredicate::prepare()
+     *
+     * A user may define a namespace-scope instance of this class in the implementation of CKKSPredicate, e.g.,
+     * `const PredicateConstants predicateConstants = {70};`. This is optional: the constants not listed are encoded at
+     * their first use.
+     */
+    class PredicateConstants {
+    public:
+        PredicateConstants(std::initializer_list<double> values) {
+            registered().insert(registered().end(), values);
+        }
+
+        //! The constants listed by all the instances
+        static const std::vector<double> &values() {
+            return registered();
+        }
+
+    private:
+        // A function-local static so that it is initialized before the instances in the other translation units
+        static std::vector<double> &registered() {
+            static std::vector<double> constants;
+            return constants;
+        }
+    };
+
     /*!
      * @brief Class defining the predicate in the given specification
      */
     class CKKSPredicate {
     public:
         explicit CKKSPredicate(const seal::SEALContext &context, double scale) : context(context), scale(scale),
-                                                                                 encoder(context), evaluator(context) {}
+                                                                                 encoder(context), evaluator(context),
+                                                                                 inputParmsId(context.first_parms_id()) {
+            prepare();
+        }
+
+        /*!
+         * @brief Encode the constants of the predicate for every level of the modulus chain
+         *
+         * This is called by the constructor, so that evalPredicateInternal does not encode the constants.
+         */
+        void prepare() {
+            for (auto contextData = context.first_context_data(); contextData;
+                 contextData = contextData->next_context_data()) {
+                const int bitCount = contextData->total_coeff_modulus_bit_count();
+                for (const double value: getConstants()) {
+                    // Skip the levels where the encoded constant does not fit in the modulus, as SEAL does
+                    if (static_cast<int>(std::log2(scale)) >= bitCount ||
+                        (value != 0 && static_cast<int>(std::log2(std::abs(value) * scale)) + 2 >= bitCount)) {
+                        continue;
+                    }
+                    constant(value, contextData->parms_id());
+                }
+            }
+        }
 
         /*!
          * @brief Evaluate the predicates with the given valuation
@@ -31,6 +84,7 @@ namespace ArithHomFA {
          *
          * @pre valuation.size() == this->signalSize
          * @pre result.size() == this->predicateSize
+         * @pre All the ciphertexts in valuation are at the same level
          */
         void eval(const std::vector<seal::Ciphertext> &valuation, std::vector<seal::Ciphertext> &result) {
             // Assert the preconditions
@@ -38,6 +92,8 @@ namespace ArithHomFA {
                 result.size() != ArithHomFA::CKKSPredicate::predicateSize) {
                 throw std::runtime_error("Invalid size of valuation or result is given");
             }
+            // The valuation may be encrypted below the first level to reduce its size (ahomfa_util ckks enc --level)
+            inputParmsId = valuation.front().parms_id();
             // Call the actual evaluation
             evalPredicateInternal(valuation, result);
         }
@@ -61,6 +117,30 @@ namespace ArithHomFA {
             evalPredicateInternal(valuation, result);
         }
 
+        /*!
+         * @brief Evaluate the predicates with the valuations packed by CKKSPackedEncoder
+         *
+         * The predicates are evaluated for all the slots at once. The results are left one level above the last level
+         * so that the slots can be extracted by CKKSToTFHE::extractSlot. This cannot be used if the predicate depends
+         * on the previous valuations.
+         *
+         * @pre valuation.size() == this->signalSize
+         * @pre result.size() == this->predicateSize
+         */
+        void evalPacked(const std::vector<seal::Ciphertext> &valuation, std::vector<seal::Ciphertext> &result) {
+            if (context.first_parms_id() == context.last_parms_id()) {
+                throw std::runtime_error("Packed evaluation requires at least two levels");
+            }
+            packed = true;
+            try {
+                eval(valuation, result);
+            } catch (...) {
+                packed = false;
+                throw;
+            }
+            packed = false;
+        }
+
         static size_t getSignalSize() {
             return signalSize;
         }
@@ -73,6 +153,10 @@ namespace ArithHomFA {
             return references;
         }
 
+        static const std::vector<double> &getConstants() {
+            return PredicateConstants::values();
+        }
+
         void setRelinKeys(const seal::RelinKeys &keys) {
             this->relinKeys = keys;
         }
@@ -83,6 +167,44 @@ namespace ArithHomFA {
         CKKSNoEmbedEncoder encoder;
         seal::Evaluator evaluator;
         seal::RelinKeys relinKeys;
+        //! The encoded constants for each pair of the value and the level
+        std::map<std::pair<double, seal::parms_id_type>, seal::Plaintext> plainConstants;
+        //! If the valuations are packed by CKKSPackedEncoder
+        bool packed = false;
+        //! The level of the valuation given to eval
+        seal::parms_id_type inputParmsId;
+
+        /*!
+         * @brief The plaintext of the constant encoded with this->scale at the given level
+         *
+         * The constants not in PredicateConstants are encoded at the first use.
+         */
+        const seal::Plaintext &constant(double value, seal::parms_id_type parmsId) {
+            auto it = plainConstants.find({value, parmsId});
+            if (it == plainConstants.end()) {
+                seal::Plaintext plain;
+                encoder.encode(value, parmsId, scale, plain);
+                it = plainConstants.emplace(std::make_pair(value, parmsId), std::move(plain)).first;
+            }
+            return it->second;
+        }
+
+        //! The plaintext of the constant encoded with this->scale at the level of the valuation given to eval
+        const seal::Plaintext &constant(double value) {
+            return constant(value, inputParmsId);
+        }
+
+        /*!
+         * @brief The level of the results of the predicates
+         *
+         * This is the last level except in evalPacked, where one level is left for the extraction of the slots.
+         */
+        seal::parms_id_type lastParmsId() const {
+            if (packed) {
+                return context.get_context_data(context.last_parms_id())->prev_context_data()->parms_id();
+            }
+            return context.last_parms_id();
+        }
 
         // The following variables and functions must be defined by a user
         //! The dimension of the input signal
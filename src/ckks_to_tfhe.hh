@@ -5,13 +5,21 @@
 
 #pragma once
 
+#include <array>
+#include <map>
+#include <memory>
+#include <numeric>
 #include <optional>
+#include <shared_mutex>
+#include <tuple>
+#include <vector>
 
 #include <spdlog/spdlog.h>
 #include "tfhe++.hpp"
 #include <seal/seal.h>
 
 #include "ckks_no_embed.hh"
+#include "ckks_packed_encoder.hh"
 #include "lvl3_to_lvl1.hh"
 #include "rescaling.hh"
 
@@ -27,7 +35,7 @@ namespace ArithHomFA {
      * @param context The SEALContext for the class
      */
     explicit CKKSToTFHE(const seal::SEALContext &context)
-        : context(context), evaluator(context), encoder(context) {
+        : context(context), evaluator(context), encoder(context), packedEncoder(context) {
     }
 
     /*!
@@ -87,7 +95,8 @@ namespace ArithHomFA {
     /*!
      * @brief Convert a CKKS ciphertext of SEAL to a TRLWE of TFHEpp
      *
-     * The resulting TRLWE is true if cipher is positive
+     * The resulting TRLWE is true if cipher is positive. The coefficients are rescaled directly from the RNS
+     * representation, which gives the same TRLWE as toLv3TRLWEComposed.
      *
      * @param [in] cipher The CKKS ciphertext to convert
      * @param [out] trlwe The resulting TRLWE ciphertext
@@ -96,26 +105,30 @@ namespace ArithHomFA {
      */
     void toLv3TRLWE(seal::Ciphertext cipher,
                     TFHEpp::TRLWE<TFHEpp::lvl3param> &trlwe) const {
-      // Assert the precondition
-      const auto poly_modulus_degree = cipher.poly_modulus_degree();
-      assert(poly_modulus_degree == TFHEpp::lvl3param::n);
-      if (context.last_parms_id() != cipher.parms_id()) {
-        spdlog::warn("CKKS ciphertext is not the last level. Switching such a ciphertext may cause an accuracy issue.");
-      }
+      const auto &context_data = inverseNTT(cipher);
 
-      const auto &context_data = *context.get_context_data(cipher.parms_id());
-
-      assert(cipher.is_ntt_form());
-      seal::util::PolyIter cipherIter = seal::util::iter(cipher);
-      // We conduct inverse NTT transformation
-      const auto tables = context_data.small_ntt_tables();
+      // Rescale the coefficients to 2^64
+      RNSRescaling rescale(context_data);
       for (std::size_t i = 0; i <= TFHEpp::lvl3param::k; ++i) {
-        for (std::size_t j = 0; j < context_data.parms().coeff_modulus().size();
-             ++j) {
-          seal::util::inverse_ntt_negacyclic_harvey(cipherIter[i][j],
-                                                    tables[j]);
-        }
+        // The indices of polynomials is the opposite between SEAL and TFHEpp, and the sign of the first polynomial in a
+        // ciphertext (in TFHEpp) must be negated
+        rescale.rescale(cipher.data(i), cipher.poly_modulus_degree(), trlwe.at(1 - i).data(), i != 0);
       }
+    }
+
+    /*!
+     * @brief Convert a CKKS ciphertext of SEAL to a TRLWE of TFHEpp by CRT composition
+     *
+     * This is slower than toLv3TRLWE and kept as its reference.
+     *
+     * @param [in] cipher The CKKS ciphertext to convert
+     * @param [out] trlwe The resulting TRLWE ciphertext
+     *
+     * @pre The degree of the given ciphertexts are the same
+     */
+    void toLv3TRLWEComposed(seal::Ciphertext cipher, TFHEpp::TRLWE<TFHEpp::lvl3param> &trlwe) const {
+      const auto &context_data = inverseNTT(cipher);
+      seal::util::PolyIter cipherIter = seal::util::iter(cipher);
 
       // CRT-compose the polynomial
       for (std::size_t i = 0; i <= TFHEpp::lvl3param::k; ++i) {
@@ -127,26 +140,9 @@ namespace ArithHomFA {
       // Rescale the coefficients to 2^64
       Rescaling rescale(context_data);
       for (std::size_t i = 0; i <= TFHEpp::lvl3param::k; ++i) {
-#ifndef NDEBUG
-        const auto decryption_modulus = context_data.total_coeff_modulus();
-#endif
-        const std::size_t decryption_modulus_size =
-            context_data.parms().coeff_modulus().size();
-        SEAL_ITERATE(
-            seal::util::iter(seal::util::StrideIter<std::uint64_t *>(
-                                 cipher.data(i), decryption_modulus_size),
-                             // The indices of polynomials is the opposite
-                             // between SEAL and TFHEpp
-                             seal::util::PtrIter<TFHEpp::lvl3param::T *>(
-                                 trlwe.at(1 - i).data())),
-            poly_modulus_degree, [&](auto I) {
-              assert(seal::util::is_less_than_uint(
-                  std::get<0>(I), decryption_modulus, decryption_modulus_size));
-              // The sign of the first polynomial in a ciphertext (in TFHEpp) is
-              // must be negated
-              std::get<1>(I) = i ? -rescale.rescale(std::get<0>(I))
-                                 : rescale.rescale(std::get<0>(I));
-            });
+        // The indices of polynomials is the opposite between SEAL and TFHEpp, and the sign of the first polynomial in a
+        // ciphertext (in TFHEpp) must be negated
+        rescale.rescale(cipher.data(i), cipher.poly_modulus_degree(), trlwe.at(1 - i).data(), i != 0);
       }
     }
 
@@ -181,30 +177,94 @@ namespace ArithHomFA {
      *
      * @pre The degree of the given ciphertexts are the same
      */
-    void toLv3TLWE(const seal::Ciphertext &cipher, TFHEpp::TLWE<TFHEpp::lvl3param> &tlwe,
-                   double reference) const {
-      // Convert CKKS ciphertext to TRLWE lvl3 first
-      TFHEpp::TRLWE<TFHEpp::lvl3param> trlwe;
-      toLv3TRLWE(cipher, trlwe, reference);
-      TFHEpp::SampleExtractIndex<TFHEpp::lvl3param>(tlwe, trlwe, 0);
+    void toLv3TLWE(seal::Ciphertext cipher, TFHEpp::TLWE<TFHEpp::lvl3param> &tlwe, double reference) const {
+      this->amplify(cipher, reference);
+      toLv3TLWE(cipher, tlwe);
     }
 
     /*!
      * @brief Convert a CKKS ciphertext of SEAL to a TLWE of TFHEpp
      *
-     * The resulting TLWE is true if cipher is positive
+     * The resulting TLWE is true if cipher is positive. This is the same as the sample extraction of the constant
+     * coefficient of toLv3TRLWE, but only the coefficients used by the TLWE are computed.
      *
      * @param [in] cipher The CKKS ciphertext to convert
      * @param [out] tlwe The resulting TLWE ciphertext
-     * amplification
      *
      * @pre The degree of the given ciphertexts are the same
      */
     void toLv3TLWE(const seal::Ciphertext &cipher, TFHEpp::TLWE<TFHEpp::lvl3param> &tlwe) const {
-      // Convert CKKS ciphertext to TRLWE lvl3 first
-      TFHEpp::TRLWE<TFHEpp::lvl3param> trlwe;
-      toLv3TRLWE(cipher, trlwe);
-      TFHEpp::SampleExtractIndex<TFHEpp::lvl3param>(tlwe, trlwe, 0);
+      static_assert(TFHEpp::lvl3param::k == 1);
+      constexpr std::size_t n = TFHEpp::lvl3param::n;
+      const auto &context_data = contextDataOf(cipher);
+      const auto &coeff_modulus = context_data.parms().coeff_modulus();
+      const std::size_t coeff_modulus_size = coeff_modulus.size();
+      const auto tables = context_data.small_ntt_tables();
+      RNSRescaling rescale(context_data);
+
+      // The body is the constant coefficient of the first polynomial, which is N^-1 times the sum of the NTT values.
+      // Thus, the first polynomial is not transformed from NTT.
+      std::array<std::uint64_t, SEAL_COEFF_MOD_COUNT_MAX> constant;
+      for (std::size_t j = 0; j < coeff_modulus_size; ++j) {
+        const std::uint64_t *values = cipher.data(0) + j * n;
+        const auto sum = std::accumulate(values, values + n, static_cast<unsigned __int128>(0));
+        constant[j] = seal::util::multiply_uint_mod(static_cast<std::uint64_t>(sum % coeff_modulus[j].value()),
+                                                    tables[j].inv_degree_modulo(), coeff_modulus[j]);
+      }
+      tlwe[n] = rescale.rescale(constant.data(), 1);
+
+      // The mask is the second polynomial, whose sign is negated in TFHEpp, reversed and negated except for the
+      // constant coefficient as in SampleExtractIndex
+      std::vector<std::uint64_t> mask(cipher.data(1), cipher.data(1) + coeff_modulus_size * n);
+      for (std::size_t j = 0; j < coeff_modulus_size; ++j) {
+        seal::util::inverse_ntt_negacyclic_harvey(seal::util::CoeffIter(mask.data() + j * n), tables[j]);
+      }
+      tlwe[0] = -rescale.rescale(mask.data(), n);
+      for (std::size_t i = 1; i < n; ++i) {
+        tlwe[i] = rescale.rescale(mask.data() + n - i, n);
+      }
+    }
+
+    /*!
+     * @brief Move a slot of a packed CKKS ciphertext to the constant coefficient of a ciphertext
+     *
+     * We multiply the unit vector of the slot encoded with scale N * q / 2, where q is the prime removed by the
+     * following rescaling. The constant coefficient of the product is q * packed.scale() times the slot value, and the
+     * other slots are zero. Thus, after the rescaling, the resulting ciphertext can be converted like the ciphertexts of
+     * CKKSNoEmbedEncoder.
+     *
+     * @param [in] packed The ciphertext encoded by CKKSPackedEncoder
+     * @param [in] index The index of the extracted slot
+     * @param [out] cipher The ciphertext at the level next to packed whose constant coefficient is the slot value
+     *
+     * @pre packed is not at the last level
+     */
+    void extractSlot(const seal::Ciphertext &packed, std::size_t index, seal::Ciphertext &cipher) const {
+      const auto context_data = context.get_context_data(packed.parms_id());
+      if (!context_data->next_context_data()) {
+        throw std::invalid_argument("The packed ciphertext must not be at the last level");
+      }
+      const auto &parms = context_data->parms();
+      const double scale = static_cast<double>(parms.poly_modulus_degree()) * parms.coeff_modulus().back().value() / 2;
+      seal::Plaintext unit;
+      packedEncoder.encodeUnit(index, packed.parms_id(), scale, unit);
+      evaluator.multiply_plain(packed, unit, cipher);
+      evaluator.rescale_to_next_inplace(cipher);
+      // SEAL tracks the scale of the slots, which is N / 2 times larger than that of the constant coefficient
+      cipher.scale() = packed.scale();
+    }
+
+    /*!
+     * @brief Move the first count slots of a packed CKKS ciphertext to the constant coefficients of ciphertexts
+     *
+     * @post ciphers.size() == count
+     */
+    void extractSlots(const seal::Ciphertext &packed, std::size_t count, std::vector<seal::Ciphertext> &ciphers) const {
+      ciphers.resize(count);
+#pragma omp parallel for
+      for (std::size_t i = 0; i < count; ++i) {
+        extractSlot(packed, i, ciphers.at(i));
+      }
     }
 
     void initializeConverter(const BootstrappingKey &bKey) {
@@ -341,33 +401,123 @@ namespace ArithHomFA {
      * @invariant The signature of the cipher does not change
      */
     void amplify(seal::Ciphertext &cipher, double reference = std::pow(2, 32) * 0.001) const {
-      auto const &context_data = context.get_context_data(cipher.parms_id());
+      evaluator.multiply_plain_inplace(cipher, amplifier(reference, cipher.scale(), cipher.parms_id()));
+
+      // while (context_data->next_context_data()){
+      //   evaluator.mod_switch_to_next_inplace(cipher);
+      //   context_data = context_data->next_context_data();
+      // }
+    }
+
+    /*!
+     * @brief Encode the plaintexts used by amplify in advance
+     *
+     * The plaintexts are encoded for each reference at the last level, where the ciphertexts are converted, assuming
+     * that the amplified ciphertexts have the given scale. The plaintexts for the other ciphertexts, e.g., the ones
+     * rescaled in the predicate, whose scale slightly differs, are encoded at their first use and cached by their
+     * level and their actual scale.
+     *
+     * @param [in] references The reference values of the amplified ciphertexts
+     * @param [in] scale The scale of the amplified ciphertexts
+     */
+    void prepareAmplifiers(const std::vector<double> &references, double scale) const {
+      for (const double reference: references) {
+        amplifier(reference, scale, context.last_parms_id());
+      }
+    }
+
+    /*!
+     * @brief The number of the plaintexts of amplify encoded so far
+     */
+    [[nodiscard]] std::size_t numAmplifiers() const {
+      std::shared_lock lock(amplifiers->mutex);
+      return amplifiers->plaintexts.size();
+    }
+
+  private:
+    //! @brief The key of the plaintexts of amplify, i.e., the reference, the scale, and the parms_id
+    using AmplifierKey = std::tuple<double, double, seal::parms_id_type>;
+    /*!
+     * @brief The plaintexts of amplify shared by the copies of the converter
+     *
+     * The plaintexts are never removed, so a reference to a plaintext stays valid after unlocking.
+     */
+    struct AmplifierCache {
+      std::shared_mutex mutex;
+      std::map<AmplifierKey, seal::Plaintext> plaintexts;
+    };
+
+    /*!
+     * @brief The plaintext multiplied to a ciphertext in amplify
+     */
+    const seal::Plaintext &amplifier(double reference, double scale, const seal::parms_id_type &parms_id) const {
+      const AmplifierKey key{reference, scale, parms_id};
+      {
+        std::shared_lock lock(amplifiers->mutex);
+        auto it = amplifiers->plaintexts.find(key);
+        if (it != amplifiers->plaintexts.end()) {
+          return it->second;
+        }
+      }
+
+      auto const &context_data = context.get_context_data(parms_id);
 
       assert(reference > 0);
 
       const double amplifiedRatio = 0.9;
       const double scaledModulus = std::pow(2.0, context_data->total_coeff_modulus_bit_count()) * amplifiedRatio;
-      const double factor = scaledModulus / (2.0 * reference * cipher.scale());
+      const double factor = scaledModulus / (2.0 * reference * scale);
 
       seal::Plaintext plain;
       encoder.encode(factor, 1.0, plain);
-      if (cipher.parms_id() != plain.parms_id()) {
-        evaluator.mod_switch_to_inplace(plain, cipher.parms_id());
+      if (parms_id != plain.parms_id()) {
+        evaluator.mod_switch_to_inplace(plain, parms_id);
       }
 
-      evaluator.multiply_plain_inplace(cipher, plain);
+      std::unique_lock lock(amplifiers->mutex);
+      return amplifiers->plaintexts.try_emplace(key, std::move(plain)).first->second;
+    }
+
+    /*!
+     * @brief Check the preconditions of the conversion of cipher
+     *
+     * @return The context data of cipher
+     */
+    const seal::SEALContext::ContextData &contextDataOf(const seal::Ciphertext &cipher) const {
+      assert(cipher.poly_modulus_degree() == TFHEpp::lvl3param::n);
+      assert(cipher.is_ntt_form());
+      if (context.last_parms_id() != cipher.parms_id()) {
+        spdlog::warn("CKKS ciphertext is not the last level. Switching such a ciphertext may cause an accuracy issue.");
+      }
+      return *context.get_context_data(cipher.parms_id());
+    }
 
-      // while (context_data->next_context_data()){
-      //   evaluator.mod_switch_to_next_inplace(cipher);
-      //   context_data = context_data->next_context_data();
-      // }
+    /*!
+     * @brief Transform the polynomials of cipher from the NTT representation
+     *
+     * @return The context data of cipher
+     */
+    const seal::SEALContext::ContextData &inverseNTT(seal::Ciphertext &cipher) const {
+      const auto &context_data = contextDataOf(cipher);
+      seal::util::PolyIter cipherIter = seal::util::iter(cipher);
+      // We conduct inverse NTT transformation
+      const auto tables = context_data.small_ntt_tables();
+      for (std::size_t i = 0; i <= TFHEpp::lvl3param::k; ++i) {
+        for (std::size_t j = 0; j < context_data.parms().coeff_modulus().size();
+             ++j) {
+          seal::util::inverse_ntt_negacyclic_harvey(cipherIter[i][j],
+                                                    tables[j]);
+        }
+      }
+      return context_data;
     }
 
-  private:
     const seal::SEALContext &context;
     const seal::Evaluator evaluator;
     const ArithHomFA::CKKSNoEmbedEncoder encoder;
+    const ArithHomFA::CKKSPackedEncoder packedEncoder;
     std::optional<ArithHomFA::Lvl3ToLvl1> converter;
+    std::shared_ptr<AmplifierCache> amplifiers = std::make_shared<AmplifierCache>();
   };
 
 } // namespace ArithHomFA
@@ -0,0 +1,60 @@
+#include "cpu_dispatch.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <spdlog/spdlog.h>
+
+CpuLevel detect_cpu_level()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return CpuLevel::AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return CpuLevel::AVX2;
+#endif
+    return CpuLevel::SCALAR;
+}
+
+CpuLevel cpu_level()
+{
+    static const CpuLevel level = [] {
+        CpuLevel detected = detect_cpu_level();
+        const char* envvar = std::getenv("AHOMFA_CPU_LEVEL");
+        if (envvar == nullptr)
+            return detected;
+        std::optional<CpuLevel> requested = parse_cpu_level(envvar);
+        if (!requested) {
+            spdlog::warn("Ignoring invalid AHOMFA_CPU_LEVEL: {}", envvar);
+            return detected;
+        }
+        if (*requested > detected)
+            spdlog::warn("AHOMFA_CPU_LEVEL={} is not supported by the CPU",
+                         envvar);
+        return std::min(*requested, detected);
+    }();
+    return level;
+}
+
+const char* cpu_level_name(CpuLevel level)
+{
+    switch (level) {
+    case CpuLevel::SCALAR:
+        return "scalar";
+    case CpuLevel::AVX2:
+        return "avx2";
+    case CpuLevel::AVX512:
+        return "avx512";
+    }
+    return "unknown";
+}
+
+std::optional<CpuLevel> parse_cpu_level(std::string_view name)
+{
+    for (CpuLevel level :
+         {CpuLevel::SCALAR, CpuLevel::AVX2, CpuLevel::AVX512})
+        if (name == cpu_level_name(level))
+            return level;
+    return std::nullopt;
+}
@@ -0,0 +1,50 @@
+#ifndef HOMFA_CPU_DISPATCH_HPP
+#define HOMFA_CPU_DISPATCH_HPP
+
+#include <optional>
+#include <string_view>
+
+// Instruction sets of the hot kernels, in the ascending order of the width
+enum class CpuLevel {
+    SCALAR,
+    AVX2,
+    AVX512,
+};
+
+// The best level supported by the CPU running the program
+CpuLevel detect_cpu_level();
+// The level used by the kernels. It is detect_cpu_level() unless it is
+// lowered by the environment variable AHOMFA_CPU_LEVEL, e.g., to compare the
+// paths on the same machine.
+CpuLevel cpu_level();
+
+const char* cpu_level_name(CpuLevel level);
+// "scalar", "avx2", or "avx512"
+std::optional<CpuLevel> parse_cpu_level(std::string_view name);
+
+// Compile a function for several instruction sets and choose one when the
+// program is loaded. This is for the kernels written in plain C++ relying on
+// the auto-vectorization, so that a binary built for the portable baseline
+// still uses AVX-512 where available. The kernels with intrinsics dispatch by
+// cpu_level() instead.
+//
+// HOMFA_MULTIVERSION_FLATTEN is for the entry points of the kernels of
+// TFHEpp, e.g., CMUX, whose loops are in the templates of TFHEpp. A template
+// called from a clone is otherwise compiled once for the baseline, so all the
+// calls in each clone are inlined by the flatten attribute. The FFT of
+// spqlios is an external routine and is not cloned.
+#if defined(HOMFA_RUNTIME_DISPATCH) && defined(__x86_64__) && \
+    defined(__has_attribute)
+#if __has_attribute(target_clones) && __has_attribute(flatten)
+#define HOMFA_MULTIVERSION \
+    __attribute__((target_clones("default", "arch=x86-64-v4")))
+#define HOMFA_MULTIVERSION_FLATTEN \
+    __attribute__((target_clones("default", "arch=x86-64-v4"), flatten))
+#endif
+#endif
+#ifndef HOMFA_MULTIVERSION
+#define HOMFA_MULTIVERSION
+#define HOMFA_MULTIVERSION_FLATTEN
+#endif
+
+#endif
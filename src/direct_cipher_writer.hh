@@ -0,0 +1,190 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <seal/seal.h>
+
+namespace ArithHomFA {
+  /*!
+   * @brief Write the ciphertexts with their sizes to a file through a large aligned buffer
+   *
+   * The file is in the format written by SizedCipherWriter. The ciphertexts are serialized directly into the buffer,
+   * and only the full blocks of the buffer are written to the file. With O_DIRECT, the blocks bypass the page cache,
+   * which avoids evicting the keys of the monitor when a long trace is written. If the file system does not support
+   * O_DIRECT, the file is written as usual.
+   */
+  class DirectSizedCipherWriter {
+  public:
+    //! The alignment of the buffer and of the blocks written to the file, required by O_DIRECT
+    static constexpr std::size_t alignment = 4096;
+
+    /*!
+     * @param path The file to write
+     * @param direct If the file is opened with O_DIRECT
+     * @param bufferSize The initial size of the buffer. It grows if a ciphertext does not fit in it.
+     */
+    explicit DirectSizedCipherWriter(const std::string &path, bool direct = true, std::size_t bufferSize = 16 << 20)
+        : buffer(allocate(alignUp(std::max(bufferSize, alignment)))), capacity(alignUp(std::max(bufferSize, alignment))) {
+      constexpr int flags = O_WRONLY | O_CREAT | O_TRUNC;
+      fd = direct ? open(path.c_str(), flags | O_DIRECT, 0644) : -1;
+      if (fd < 0) {
+        // e.g., tmpfs does not support O_DIRECT
+        fd = open(path.c_str(), flags, 0644);
+      }
+      if (fd < 0) {
+        throw std::runtime_error("Failed to open the output file: " + path);
+      }
+    }
+
+    DirectSizedCipherWriter(const DirectSizedCipherWriter &) = delete;
+    DirectSizedCipherWriter &operator=(const DirectSizedCipherWriter &) = delete;
+
+    ~DirectSizedCipherWriter() {
+      try {
+        close();
+      } catch (...) {
+        // A destructor must not throw. Call close() explicitly to handle the error.
+      }
+    }
+
+    void write(const seal::Ciphertext &cipher) {
+      writeInternal(cipher);
+    }
+
+    /*!
+     * @brief Write a seeded cipher text returned by seal::Encryptor::encrypt_symmetric
+     */
+    void write(const seal::Serializable<seal::Ciphertext> &cipher) {
+      writeInternal(cipher);
+    }
+
+    /*!
+     * @brief Write the raw image of a header, e.g., PackedBatchHeader, as a record as SizedCipherWriter::writeHeader
+     */
+    template<class Header>
+    void writeHeader(const Header &header) {
+      static_assert(std::is_trivially_copyable_v<Header>);
+      reserve(sizeof(uint32_t) + sizeof(Header));
+      const auto length = static_cast<uint32_t>(sizeof(Header));
+      std::memcpy(buffer.get() + used, &length, sizeof(uint32_t));
+      std::memcpy(buffer.get() + used + sizeof(uint32_t), &header, sizeof(Header));
+      used += sizeof(uint32_t) + sizeof(Header);
+    }
+
+    /*!
+     * @brief Write the rest of the buffer and close the file
+     *
+     * The last block is padded to the alignment and the padding is truncated afterwards.
+     */
+    void close() {
+      if (fd < 0) {
+        return;
+      }
+      if (used > 0) {
+        const std::size_t padded = alignUp(used);
+        std::memset(buffer.get() + used, 0, padded - used);
+        writeAll(padded);
+        written -= padded - used;
+        used = 0;
+        if (ftruncate(fd, static_cast<off_t>(written)) < 0) {
+          ::close(fd);
+          fd = -1;
+          throw std::runtime_error("Failed to truncate the output file");
+        }
+      }
+      ::close(fd);
+      fd = -1;
+    }
+
+  private:
+    struct Free {
+      void operator()(char *ptr) const {
+        std::free(ptr);
+      }
+    };
+
+    std::unique_ptr<char[], Free> buffer;
+    std::size_t capacity;
+    //! The number of the bytes in the buffer not written to the file
+    std::size_t used = 0;
+    //! The number of the bytes written to the file
+    std::size_t written = 0;
+    int fd = -1;
+
+    static constexpr std::size_t alignUp(std::size_t size) {
+      return (size + alignment - 1) / alignment * alignment;
+    }
+
+    static std::unique_ptr<char[], Free> allocate(std::size_t size) {
+      auto *ptr = static_cast<char *>(std::aligned_alloc(alignment, size));
+      if (!ptr) {
+        throw std::bad_alloc();
+      }
+      return std::unique_ptr<char[], Free>(ptr);
+    }
+
+    template<class Cipher>
+    void writeInternal(const Cipher &cipher) {
+      // save_size is an upper bound of the actual size
+      const std::size_t maxLength = cipher.save_size();
+      reserve(sizeof(uint32_t) + maxLength);
+      char *data = buffer.get() + used;
+      const auto length = static_cast<uint32_t>(
+              cipher.save(reinterpret_cast<seal::seal_byte *>(data + sizeof(uint32_t)), maxLength));
+      std::memcpy(data, &length, sizeof(uint32_t));
+      used += sizeof(uint32_t) + length;
+    }
+
+    //! Make room for size bytes at the end of the buffer
+    void reserve(std::size_t size) {
+      if (used + size <= capacity) {
+        return;
+      }
+      // Write the full blocks and move the rest to the front
+      const std::size_t flushed = used / alignment * alignment;
+      writeAll(flushed);
+      std::memmove(buffer.get(), buffer.get() + flushed, used - flushed);
+      used -= flushed;
+      if (used + size > capacity) {
+        // The padding of the last block in close() also needs the aligned capacity
+        const std::size_t newCapacity = alignUp(used + size);
+        auto newBuffer = allocate(newCapacity);
+        std::memcpy(newBuffer.get(), buffer.get(), used);
+        buffer = std::move(newBuffer);
+        capacity = newCapacity;
+      }
+    }
+
+    void writeAll(std::size_t size) {
+      std::size_t done = 0;
+      while (done < size) {
+        const ssize_t result = ::write(fd, buffer.get() + done, size - done);
+        if (result < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          throw std::runtime_error(std::string("Failed to write the ciphertexts: ") + std::strerror(errno));
+        }
+        done += result;
+      }
+      written += size;
+    }
+  };
+} // namespace ArithHomFA
@@ -82,7 +82,7 @@ void nfa_dump_dot(std::ostream& os, const std::set<Graph::State>& init_sts,
     os << "}\n";
 }
 
-Graph::Graph()
+Graph::Graph() : num_outputs_(1)
 {
 }
 
@@ -94,14 +94,47 @@ Graph::Graph(State init_st, const std::set<State>& final_sts,
       states_at_depth_(),
       final_state_(final_sts),
       final_state_vec_(delta.size(), false),
+      outputs_(delta.size(), 0),
+      num_outputs_(1),
       init_state_(init_st)
 {
     for (auto&& [q, q0, q1] : delta) {
         parents0_.at(q0).push_back(q);
         parents1_.at(q1).push_back(q);
     }
-    for (State q : final_sts)
+    for (State q : final_sts) {
         final_state_vec_.at(q) = true;
+        outputs_.at(q) = 1;
+    }
+}
+
+Graph::Graph(State init_st, const std::vector<uint64_t>& outputs,
+             size_t num_outputs, const DFADelta& delta)
+    : delta_(delta),
+      parents0_(delta.size()),
+      parents1_(delta.size()),
+      states_at_depth_(),
+      final_state_(),
+      final_state_vec_(delta.size(), false),
+      outputs_(outputs),
+      num_outputs_(num_outputs),
+      init_state_(init_st)
+{
+    assert(outputs.size() == delta.size());
+    if (num_outputs_ == 0 || num_outputs_ > 64)
+        error_die("The number of outputs must be in [1, 64]: {}",
+                  num_outputs_);
+
+    for (auto&& [q, q0, q1] : delta) {
+        parents0_.at(q0).push_back(q);
+        parents1_.at(q1).push_back(q);
+    }
+    for (State q = 0; q < outputs.size(); q++) {
+        if (outputs.at(q) & 1u) {
+            final_state_.insert(q);
+            final_state_vec_.at(q) = true;
+        }
+    }
 }
 
 Graph Graph::from_istream(std::istream& is)
@@ -328,17 +361,93 @@ Graph Graph::from_ltl_formula_reversed(const std::string& formula,
     return Graph::from_nfa(final_sts, init_sts, delta_rev);
 }
 
+// Input  DFAs M1, ..., Mk over {0, 1}
+// Output DFA M on the reachable part of Q1 x ... x Qk, whose outputs are the
+//        concatenation of the outputs of M1, ..., Mk
+Graph Graph::product(const std::vector<Graph>& graphs)
+{
+    if (graphs.empty())
+        error_die("No automaton is given to the product construction");
+
+    std::vector<size_t> offsets;
+    size_t num_outputs = 0;
+    for (const Graph& g : graphs) {
+        offsets.push_back(num_outputs);
+        num_outputs += g.num_outputs();
+    }
+    if (num_outputs > 64)
+        error_die("Too many outputs for the product construction: {}",
+                  num_outputs);
+
+    using StateTuple = std::vector<State>;
+    std::map<StateTuple, State> st_map;
+    std::queue<StateTuple> que;
+    DFADelta delta;
+    std::vector<uint64_t> outputs;
+
+    // Only the reachable tuples are created
+    auto get_or_create_state = [&](const StateTuple& qs) {
+        auto it = st_map.find(qs);
+        if (it != st_map.end())
+            return it->second;
+        State q = delta.size();
+        delta.emplace_back(q, -1, -1);
+        uint64_t out = 0;
+        for (size_t i = 0; i < graphs.size(); i++)
+            out |= graphs.at(i).outputs(qs.at(i)) << offsets.at(i);
+        outputs.push_back(out);
+        st_map.emplace(qs, q);
+        que.push(qs);
+        return q;
+    };
+
+    StateTuple init_sts;
+    for (const Graph& g : graphs)
+        init_sts.push_back(g.initial_state());
+    State init_st = get_or_create_state(init_sts);
+    StateTuple qs0(graphs.size()), qs1(graphs.size());
+    while (!que.empty()) {
+        StateTuple qs = que.front();
+        que.pop();
+        for (size_t i = 0; i < graphs.size(); i++) {
+            qs0.at(i) = graphs.at(i).next_state(qs.at(i), false);
+            qs1.at(i) = graphs.at(i).next_state(qs.at(i), true);
+        }
+        State q = st_map.at(qs), q0 = get_or_create_state(qs0),
+              q1 = get_or_create_state(qs1);
+        delta.at(q) = std::make_tuple(q, q0, q1);
+    }
+
+    return Graph{init_st, outputs, num_outputs, delta};
+}
+
 size_t Graph::size() const
 {
     return delta_.size();
 }
 
+size_t Graph::num_outputs() const
+{
+    return num_outputs_;
+}
+
 bool Graph::is_final_state(State state) const
 {
     // return final_state_.contains(state);
     return final_state_vec_.at(state);
 }
 
+bool Graph::is_final_state(State state, size_t output) const
+{
+    assert(output < num_outputs_);
+    return (outputs_.at(state) >> output) & 1u;
+}
+
+uint64_t Graph::outputs(State state) const
+{
+    return outputs_.at(state);
+}
+
 Graph::State Graph::next_state(State state, bool input) const
 {
     auto& t = delta_.at(state);
@@ -406,6 +515,58 @@ std::vector<Graph::State> Graph::all_states() const
     return ret;
 }
 
+// The i-th element is true iff the state i is reachable from the initial
+// state
+std::vector<bool> Graph::reachable_states() const
+{
+    std::vector<bool> reachable(size(), false);
+    std::queue<State> que;
+    que.push(initial_state());
+    reachable.at(initial_state()) = true;
+    while (!que.empty()) {
+        State q = que.front();
+        que.pop();
+        for (State child : {next_state(q, false), next_state(q, true)}) {
+            if (reachable.at(child))
+                continue;
+            reachable.at(child) = true;
+            que.push(child);
+        }
+    }
+    return reachable;
+}
+
+// The i-th element is true iff all the states reachable from the state i have
+// the same outputs as i, e.g., the sink states accepting everything or
+// nothing. The weights of such states in BackstreamDFARunner never change.
+std::vector<bool> Graph::constant_states() const
+{
+    // A state is not constant iff it reaches a state having a child with
+    // different outputs. We propagate it backwards.
+    std::vector<bool> constant(size(), true);
+    std::queue<State> que;
+    for (State q = 0; q < size(); q++) {
+        if (outputs(next_state(q, false)) != outputs(q) ||
+            outputs(next_state(q, true)) != outputs(q)) {
+            constant.at(q) = false;
+            que.push(q);
+        }
+    }
+    while (!que.empty()) {
+        State q = que.front();
+        que.pop();
+        for (bool input : {false, true}) {
+            for (State parent : prev_states(q, input)) {
+                if (!constant.at(parent))
+                    continue;
+                constant.at(parent) = false;
+                que.push(parent);
+            }
+        }
+    }
+    return constant;
+}
+
 std::vector<std::vector<Graph::State>> Graph::track_live_states(
     const std::vector<Graph::State>& init_live_states, size_t max_depth)
 {
@@ -433,6 +594,10 @@ std::vector<std::vector<Graph::State>> Graph::track_live_states(
 
 Graph Graph::reversed() const
 {
+    // The reversed automaton of each output has its own initial states
+    if (num_outputs_ != 1)
+        error_die("Cannot reverse an automaton with {} outputs", num_outputs_);
+
     NFADelta delta(size());
     for (State q : all_states()) {
         delta.at(q) =
@@ -466,10 +631,7 @@ Graph Graph::removed_unreachable() const
         old2new.emplace(old, old2new.size());
 
     State init_st = old2new.at(initial_state());
-    std::set<State> final_sts;
-    for (State q : final_state_)
-        if (reachable.contains(q))
-            final_sts.insert(old2new.at(q));
+    std::vector<uint64_t> outputs(reachable.size());
     DFADelta delta(reachable.size());
     for (auto&& [index, child0, child1] : delta_) {
         if (!reachable.contains(index))
@@ -477,9 +639,10 @@ Graph Graph::removed_unreachable() const
         State q = old2new.at(index), q0 = old2new.at(child0),
               q1 = old2new.at(child1);
         delta.at(q) = std::make_tuple(q, q0, q1);
+        outputs.at(q) = outputs_.at(index);
     }
 
-    return Graph{init_st, final_sts, delta};
+    return Graph{init_st, outputs, num_outputs_, delta};
 }
 
 Graph Graph::grouped_nondistinguishable() const
@@ -490,8 +653,7 @@ Graph Graph::grouped_nondistinguishable() const
     std::queue<std::pair<State, State>> que;
     for (State qa = 0; qa < siz; qa++) {
         for (State qb = qa + 1; qb < siz; qb++) {
-            bool qa_final = is_final_state(qa), qb_final = is_final_state(qb);
-            if ((qa_final && !qb_final) || (!qa_final && qb_final)) {
+            if (outputs(qa) != outputs(qb)) {
                 que.emplace(qa, qb);
                 table.at(qa + qb * siz) = true;
             }
@@ -542,7 +704,7 @@ Graph Graph::grouped_nondistinguishable() const
     }
 
     std::optional<State> init_st;
-    std::set<State> final_sts;
+    std::vector<uint64_t> outputs;
     DFADelta delta;
     for (size_t q = 0; q < st.size(); q++) {
         std::set<State>& s = st.at(q);
@@ -551,27 +713,63 @@ Graph Graph::grouped_nondistinguishable() const
         bool initial = std::any_of(s.begin(), s.end(), [this](State q) {
             return initial_state() == q;
         });
-        bool final = is_final_state(repr);
         if (initial)
             init_st.emplace(q);
-        if (final)
-            final_sts.insert(q);
+        outputs.push_back(this->outputs(repr));
 
         State q0 = uf2st.at(uf.find(next_state(repr, false))),
               q1 = uf2st.at(uf.find(next_state(repr, true)));
         delta.emplace_back(q, q0, q1);
     }
 
-    return Graph{init_st.value(), final_sts, delta};
+    return Graph{init_st.value(), outputs, num_outputs_, delta};
 }
 
 Graph Graph::negated() const
 {
-    std::set<State> new_final;
+    const uint64_t mask =
+        num_outputs_ == 64 ? ~uint64_t{0} : (uint64_t{1} << num_outputs_) - 1;
+    std::vector<uint64_t> new_outputs(size());
     for (Graph::State q : all_states())
-        if (!is_final_state(q))
-            new_final.insert(q);
-    return Graph{init_state_, new_final, delta_};
+        new_outputs.at(q) = ~outputs(q) & mask;
+    return Graph{init_state_, new_outputs, num_outputs_, delta_};
+}
+
+// Renumber the states in the BFS order from the initial state so that the
+// weights of a state and its children are close in memory. The unreachable
+// states follow in the original order.
+Graph Graph::bfs_ordered() const
+{
+    const State unassigned = size();
+    std::vector<State> old2new(size(), unassigned);
+    State next_index = 0;
+    std::queue<State> que;
+    que.push(initial_state());
+    old2new.at(initial_state()) = next_index++;
+    while (!que.empty()) {
+        State q = que.front();
+        que.pop();
+        for (State child : {next_state(q, false), next_state(q, true)}) {
+            if (old2new.at(child) != unassigned)
+                continue;
+            old2new.at(child) = next_index++;
+            que.push(child);
+        }
+    }
+    for (State q = 0; q < size(); q++)
+        if (old2new.at(q) == unassigned)
+            old2new.at(q) = next_index++;
+
+    std::vector<uint64_t> outputs(size());
+    DFADelta delta(size());
+    for (auto&& [index, child0, child1] : delta_) {
+        State q = old2new.at(index);
+        delta.at(q) =
+            std::make_tuple(q, old2new.at(child0), old2new.at(child1));
+        outputs.at(q) = outputs_.at(index);
+    }
+
+    return Graph{old2new.at(initial_state()), outputs, num_outputs_, delta};
 }
 
 void Graph::dump(std::ostream& os) const
@@ -22,12 +22,18 @@ private:
     std::vector<std::vector<State>> states_at_depth_;
     std::set<State> final_state_;
     std::vector<bool> final_state_vec_;
+    // Bit i of outputs_[q] is true iff q is accepting for the i-th output.
+    // The 0-th output coincides with final_state_.
+    std::vector<uint64_t> outputs_;
+    size_t num_outputs_;
     State init_state_;
 
 public:
     Graph();
     Graph(State init_st, const std::set<State>& final_sts,
           const DFADelta& delta);
+    Graph(State init_st, const std::vector<uint64_t>& outputs,
+          size_t num_outputs, const DFADelta& delta);
 
     static Graph from_istream(std::istream& is);
     static Graph from_file(const std::string& filename);
@@ -41,9 +47,13 @@ public:
     static Graph from_ltl_formula_reversed(const std::string& formula,
                                            size_t var_size,
                                            bool make_all_live_states_final);
+    static Graph product(const std::vector<Graph>& graphs);
 
     size_t size() const;
+    size_t num_outputs() const;
     bool is_final_state(State state) const;
+    bool is_final_state(State state, size_t output) const;
+    uint64_t outputs(State state) const;
     State next_state(State state, bool input) const;
     const std::vector<State>& prev_states(State state, bool input) const;
     State transition64(State src, uint64_t input, int length) const;
@@ -51,6 +61,8 @@ public:
     void reserve_states_at_depth(size_t depth);
     std::vector<State> states_at_depth(size_t depth) const;
     std::vector<State> all_states() const;
+    std::vector<bool> reachable_states() const;
+    std::vector<bool> constant_states() const;
     std::vector<std::vector<State>> track_live_states(
         const std::vector<State>& init_live_states, size_t max_depth);
     Graph reversed() const;
@@ -58,6 +70,7 @@ public:
     Graph removed_unreachable() const;
     Graph grouped_nondistinguishable() const;
     Graph negated() const;
+    Graph bfs_ordered() const;
     void dump(std::ostream& os) const;
     void dump_dot(std::ostream& os) const;
     void dump_att(std::ostream& os) const;
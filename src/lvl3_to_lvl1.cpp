@@ -0,0 +1,72 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#include "lvl3_to_lvl1.hh"
+
+#include <cstdint>
+#include <limits>
+
+#include "cpu_dispatch.hpp"
+
+namespace ArithHomFA {
+  // HomDecomp is a template of TFHEpp. Its key switching and bootstrapping are inlined into each clone by the flatten
+  // attribute of HOMFA_MULTIVERSION_FLATTEN.
+  HOMFA_MULTIVERSION_FLATTEN void Lvl3ToLvl1::homDecomp(std::array<TFHEpp::TLWE<TFHEpp::lvl1param>, numdigitsShort> &output,
+                                                        const TFHEpp::TLWE<TFHEpp::lvl3param> &input,
+                                                        const BootstrappingKey &bk) {
+    TFHEpp::HomDecomp<BootstrappingKey::high2midP, BootstrappingKey::mid2lowP, BootstrappingKey::brP, basebit,
+                      numdigitsShort>(output, input, *bk.kskh2m, *bk.kskm2l, *bk.bkfft);
+  }
+
+  HOMFA_MULTIVERSION_FLATTEN void Lvl3ToLvl1::homDecomp(std::array<TFHEpp::TLWE<TFHEpp::lvl1param>, numdigits> &output,
+                                                        const TFHEpp::TLWE<TFHEpp::lvl3param> &input,
+                                                        const BootstrappingKey &bk) {
+    TFHEpp::HomDecomp<BootstrappingKey::high2midP, BootstrappingKey::mid2lowP, BootstrappingKey::brP, basebit,
+                      numdigits>(output, input, *bk.kskh2m, *bk.kskm2l, *bk.bkfft);
+  }
+
+  HOMFA_MULTIVERSION_FLATTEN void Lvl3ToLvl1::homDecomp(std::array<TFHEpp::TLWE<TFHEpp::lvl1param>, numdigitsLong> &output,
+                                                        const TFHEpp::TLWE<TFHEpp::lvl3param> &input,
+                                                        const BootstrappingKey &bk) {
+    TFHEpp::HomDecomp<BootstrappingKey::high2midP, BootstrappingKey::mid2lowP, BootstrappingKey::brP, basebit,
+                      numdigitsLong>(output, input, *bk.kskh2m, *bk.kskm2l, *bk.bkfft);
+  }
+
+  HOMFA_MULTIVERSION void
+  Lvl3ToLvl1::identityKeySwitchMid2Low(TFHEpp::TLWE<BootstrappingKey::mid2lowP::targetP> &output,
+                                       const TFHEpp::TLWE<BootstrappingKey::mid2lowP::domainP> &input,
+                                       const TFHEpp::KeySwitchingKey<BootstrappingKey::mid2lowP> &ksk) {
+    using P = BootstrappingKey::mid2lowP;
+    using DomainT = typename P::domainP::T;
+    constexpr std::size_t domainDigits = std::numeric_limits<DomainT>::digits;
+    constexpr std::size_t targetDigits = std::numeric_limits<typename P::targetP::T>::digits;
+    static_assert(domainDigits >= targetDigits);
+    // Round each coefficient to the precision of the key
+    constexpr DomainT precOffset = DomainT{1} << (domainDigits - (1 + P::basebit * P::t));
+    constexpr uint32_t mask = (1U << P::basebit) - 1;
+    constexpr std::size_t domainLength = P::domainP::k * P::domainP::n;
+    constexpr std::size_t targetLength = P::targetP::k * P::targetP::n;
+
+    output = {};
+    if constexpr (domainDigits == targetDigits) {
+      output[targetLength] = input[domainLength];
+    } else {
+      output[targetLength] =
+          (input[domainLength] + (DomainT{1} << (domainDigits - targetDigits - 1))) >> (domainDigits - targetDigits);
+    }
+    for (std::size_t i = 0; i < domainLength; ++i) {
+      const DomainT aibar = input[i] + precOffset;
+      for (std::size_t j = 0; j < P::t; ++j) {
+        const uint32_t aij = (aibar >> (domainDigits - (j + 1) * P::basebit)) & mask;
+        if (aij != 0) {
+          const auto &key = ksk[i][j][aij - 1];
+          for (std::size_t k = 0; k <= targetLength; ++k) {
+            output[k] -= key[k];
+          }
+        }
+      }
+    }
+  }
+} // namespace ArithHomFA
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <array>
 #include <cstddef>
 #include <ostream>
 #include <utility>
@@ -14,7 +15,6 @@
 #include "bootstrapping_key.hh"
 
 namespace ArithHomFA {
-
   /*!
    * @class Lvl3ToLvl1
    * @brief Convert TLWE ciphertexts from level 3 to level 1
@@ -44,9 +44,8 @@ namespace ArithHomFA {
     template<std::size_t size>
     void toLv1TLWE(const TFHEpp::TLWE<TFHEpp::lvl3param> &input,
                    std::array<TFHEpp::TLWE<TFHEpp::lvl1param>, size> &output) const {
-      TFHEpp::HomDecomp<typename BootstrappingKey::high2midP, typename BootstrappingKey::mid2lowP,
-                        typename BootstrappingKey::brP, basebit, size>(output, input, *bk.kskh2m, *bk.kskm2l,
-                                                                            *bk.bkfft);
+      static_assert(size == numdigitsShort || size == numdigits || size == numdigitsLong);
+      homDecomp(output, input, bk);
     }
 
     /*!
@@ -92,7 +91,7 @@ namespace ArithHomFA {
       toLv1TLWE(input, output);
       output[TFHEpp::lvl1param::k * TFHEpp::lvl1param::n] += 1ULL << (std::numeric_limits<typename TFHEpp::lvl1param::T>::digits - basebit - 1);
       TFHEpp::TLWE<TFHEpp::lvlhalfparam> tlwelvlhalf;
-      TFHEpp::IdentityKeySwitch<typename BootstrappingKey::mid2lowP>(tlwelvlhalf, output, *bk.kskm2l);
+      identityKeySwitchMid2Low(tlwelvlhalf, output, *bk.kskm2l);
       TFHEpp::GateBootstrappingTLWE2TLWEFFT<typename BootstrappingKey::brP>(output, tlwelvlhalf, *bk.bkfft, TFHEpp::μpolygen<typename BootstrappingKey::brP::targetP, BootstrappingKey::brP::targetP::μ>());
     }
 
@@ -106,7 +105,7 @@ namespace ArithHomFA {
       toLv1TLWEGood(input, output);
       output[TFHEpp::lvl1param::k * TFHEpp::lvl1param::n] += 1ULL << (std::numeric_limits<typename TFHEpp::lvl1param::T>::digits - basebit - 1);
       TFHEpp::TLWE<TFHEpp::lvlhalfparam> tlwelvlhalf;
-      TFHEpp::IdentityKeySwitch<typename BootstrappingKey::mid2lowP>(tlwelvlhalf, output, *bk.kskm2l);
+      identityKeySwitchMid2Low(tlwelvlhalf, output, *bk.kskm2l);
       TFHEpp::GateBootstrappingTLWE2TLWEFFT<typename BootstrappingKey::brP>(output, tlwelvlhalf, *bk.bkfft, TFHEpp::μpolygen<typename BootstrappingKey::brP::targetP, BootstrappingKey::brP::targetP::μ>());
     }
 
@@ -120,13 +119,37 @@ namespace ArithHomFA {
       toLv1TLWEPoor(input, output);
       output[TFHEpp::lvl1param::k * TFHEpp::lvl1param::n] += 1ULL << (std::numeric_limits<typename TFHEpp::lvl1param::T>::digits - basebit - 1);
       TFHEpp::TLWE<TFHEpp::lvlhalfparam> tlwelvlhalf;
-      TFHEpp::IdentityKeySwitch<typename BootstrappingKey::mid2lowP>(tlwelvlhalf, output, *bk.kskm2l);
+      identityKeySwitchMid2Low(tlwelvlhalf, output, *bk.kskm2l);
       TFHEpp::GateBootstrappingTLWE2TLWEFFT<typename BootstrappingKey::brP>(output, tlwelvlhalf, *bk.bkfft, TFHEpp::μpolygen<typename BootstrappingKey::brP::targetP, BootstrappingKey::brP::targetP::μ>());
     }
 
     const BootstrappingKey getBKey() const {
       return bk;
     }
+
+    /*!
+     * @brief The identity key switching with BootstrappingKey::kskm2l, which is the same as IdentityKeySwitch of TFHEpp
+     *
+     * The loop is written here rather than in TFHEpp so that it is compiled for each instruction set with
+     * HOMFA_RUNTIME_DISPATCH.
+     */
+    static void identityKeySwitchMid2Low(TFHEpp::TLWE<BootstrappingKey::mid2lowP::targetP> &output,
+                                         const TFHEpp::TLWE<BootstrappingKey::mid2lowP::domainP> &input,
+                                         const TFHEpp::KeySwitchingKey<BootstrappingKey::mid2lowP> &ksk);
+
+  private:
+    /*!
+     * @brief HomDecomp of TFHEpp for each number of the digits
+     *
+     * They are defined in lvl3_to_lvl1.cpp so that they are compiled for each instruction set with
+     * HOMFA_RUNTIME_DISPATCH.
+     */
+    static void homDecomp(std::array<TFHEpp::TLWE<TFHEpp::lvl1param>, numdigitsShort> &output,
+                          const TFHEpp::TLWE<TFHEpp::lvl3param> &input, const BootstrappingKey &bk);
+    static void homDecomp(std::array<TFHEpp::TLWE<TFHEpp::lvl1param>, numdigits> &output,
+                          const TFHEpp::TLWE<TFHEpp::lvl3param> &input, const BootstrappingKey &bk);
+    static void homDecomp(std::array<TFHEpp::TLWE<TFHEpp::lvl1param>, numdigitsLong> &output,
+                          const TFHEpp::TLWE<TFHEpp::lvl3param> &input, const BootstrappingKey &bk);
   };
 
 } // namespace ArithHomFA
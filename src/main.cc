@@ -3,6 +3,7 @@
  * @date 2023/04/20
  */
 
+#include <filesystem>
 #include <iostream>
 #include <optional>
 #include <unordered_map>
@@ -13,19 +14,24 @@
 #include <cereal/cereal.hpp>
 
 #include "archive.hpp"
+#include "cpu_dispatch.hpp"
 #include "graph.hpp"
 #include "tfhepp_util.hpp"
 #include "utility.hpp"
 
 #include "key_loader.hh"
 #include "bootstrapping_key.hh"
+#include "mapped_bootstrapping_key.hh"
 #include "ckks_no_embed.hh"
+#include "ckks_packed_encoder.hh"
 #include "ckks_to_tfhe.hh"
+#include "direct_cipher_writer.hh"
 #include "seal_config.hh"
 #include "sized_cipher_reader.hh"
 #include "sized_cipher_writer.hh"
 #include "sized_tlwe_reader.hh"
 #include "sized_tlwe_writer.hh"
+#include "tlwe_reader.hh"
 
 namespace {
   enum class VERBOSITY { VERBOSE, NORMAL, QUIET };
@@ -38,6 +44,7 @@ namespace {
     GENKEY_TFHEPP,
     GENRELINKEY_SEAL,
     GENBKEY_TFHEPP,
+    CONVERT_BKEY_TFHEPP,
 
     ENC_CKKS,
     DEC_CKKS,
@@ -52,12 +59,17 @@ namespace {
     VERBOSITY verbosity = VERBOSITY::NORMAL;
     TYPE type = TYPE::UNSPECIFIED;
 
-    bool make_all_live_states_final = false, minimized = false, reversed = false, negated = false, vertical = false;
+    bool make_all_live_states_final = false, minimized = false, reversed = false, negated = false, vertical = false,
+         compact = false;
     std::optional<ArithHomFA::SealConfig> sealConfig;
     std::optional<std::string> spec, skey, sealSecretKey, sealPublicKey, bkey, output_dir, debug_skey, formula, online_method;
     std::istream *input = &std::cin;
     std::ostream *output = &std::cout;
-    std::optional<size_t> num_vars, queue_size, bootstrapping_freq, max_second_lut_depth, num_ap, output_freq;
+    //! The path given by -o, if any
+    std::optional<std::string> outputPath;
+    std::optional<size_t> num_vars, queue_size, bootstrapping_freq, max_second_lut_depth, num_ap, output_freq, pack,
+        level;
+    size_t signal_size = 1;
   };
 
   void register_general_options(CLI::App &app, Args &args) {
@@ -105,6 +117,7 @@ namespace {
 
       std::function<void(const std::string &)> output_callback = [&args](const std::string &path) {
         args.output = new std::ofstream(path);
+        args.outputPath = path;
       };
       subcommand->add_option_function("-o,--output", output_callback, "The file to write the result");
     }
@@ -146,6 +159,17 @@ namespace {
     // genrelinkey
     genrelinkey->parse_complete_callback([&args] { args.type = TYPE::GENRELINKEY_SEAL; });
     // enc
+    auto *pack = enc->add_option("--pack", args.pack,
+                                 "Encrypt the values of each signal at this number of time steps to a ciphertext")
+                     ->check(CLI::PositiveNumber);
+    enc->add_option("--signal-size", args.signal_size, "The number of the signals in a time step (used with --pack)")
+        ->check(CLI::PositiveNumber)
+        ->needs(pack);
+    enc->add_flag("--compact", args.compact,
+                  "Write the seeded ciphertexts of encrypt_symmetric, which are about half in size (requires -K)");
+    enc->add_option("--level", args.level,
+                    "Encrypt at this level of the modulus chain, where 0 is the last level. This must be enough for the "
+                    "predicate (plus one with --pack)");
     enc->parse_complete_callback([&args] { args.type = TYPE::ENC_CKKS; });
     // dec
     dec->parse_complete_callback([&args] { args.type = TYPE::DEC_CKKS; });
@@ -163,6 +187,10 @@ namespace {
     subcommands.push_back(genbkey);
     requiresKey.push_back(genbkey);
     withSeal.push_back(genbkey);
+    CLI::App *convertBkey =
+        tfhe->add_subcommand("convert-bkey", "Convert bootstrap key to the memory-mappable format");
+    subcommands.push_back(convertBkey);
+    withInput.push_back(convertBkey);
     CLI::App *enc = tfhe->add_subcommand("enc", "Encrypt input file");
     subcommands.push_back(enc);
     requiresKey.push_back(enc);
@@ -177,6 +205,7 @@ namespace {
     for (auto subcommand: subcommands) {
       std::function<void(const std::string &)> output_callback = [&args](const std::string &path) {
         args.output = new std::ofstream(path);
+        args.outputPath = path;
       };
       subcommand->add_option_function("-o,--output", output_callback, "The file to write the result");
     }
@@ -224,6 +253,8 @@ namespace {
     genkey->parse_complete_callback([&args] { args.type = TYPE::GENKEY_TFHEPP; });
     // genbkey
     genbkey->parse_complete_callback([&args] { args.type = TYPE::GENBKEY_TFHEPP; });
+    // convert-bkey
+    convertBkey->parse_complete_callback([&args] { args.type = TYPE::CONVERT_BKEY_TFHEPP; });
     // enc
     enc->parse_complete_callback([&args] { args.type = TYPE::ENC_TFHEPP; });
     // dec
@@ -313,72 +344,172 @@ namespace {
     write_to_archive(ostream, bkey);
   }
 
-  void do_enc_SEAL_with_secret_key(const ArithHomFA::SealConfig &config, const std::string &secretKeyPath,
-                                   std::istream &istream, std::ostream &ostream) {
-    const seal::SEALContext context = config.makeContext();
-    const double scale = config.scale;
-    const seal::SecretKey secretKey = ArithHomFA::KeyLoader::loadSecretKey(context, secretKeyPath);
-    seal::Encryptor encryptor(context, secretKey);
+  void do_convert_bkey_TFHEpp(std::istream &istream, std::ostream &ostream) {
+    spdlog::info("Convert bootstrapping key of TFHEpp to the memory-mappable format");
+    const auto bkey = read_from_archive<ArithHomFA::BootstrappingKey>(istream);
+    ArithHomFA::writeMappedBootstrappingKey(ostream, bkey);
+  }
 
-    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+  /*
+   * The parms_id at the given level of the modulus chain, where 0 is the last level, or the first level if not given.
+   */
+  seal::parms_id_type parms_id_at_level(const seal::SEALContext &context, std::optional<std::size_t> level) {
+    if (!level) {
+      return context.first_parms_id();
+    }
+    for (auto contextData = context.first_context_data(); contextData;
+         contextData = contextData->next_context_data()) {
+      if (contextData->chain_index() == *level) {
+        return contextData->parms_id();
+      }
+    }
+    throw std::invalid_argument("--level must be at most " +
+                                std::to_string(context.first_context_data()->chain_index()));
+  }
+
+  /*
+   * Encrypt each value to the constant coefficient of a ciphertext, or the values of each signal at pack consecutive
+   * time steps to the slots of a ciphertext if pack is given, with a PackedBatchHeader before the ciphertexts of each
+   * batch of the time steps. The plaintexts are encoded at the given level so that the ciphertexts are no larger than
+   * what the predicate needs.
+   */
+  template<class Writer, class Encryptor>
+  void do_enc_SEAL_with_encryptor(const seal::SEALContext &context, double scale, std::optional<std::size_t> pack,
+                                  std::size_t signalSize, std::optional<std::size_t> level, std::istream &istream,
+                                  Writer &writer, Encryptor encrypt) {
+    const seal::parms_id_type parmsId = parms_id_at_level(context, level);
+    if (!pack) {
+      ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+      double content;
+      while (istream.good()) {
+        // get the content from stdin
+        istream >> content;
+        if (!istream.good()) {
+          break;
+        }
+        seal::Plaintext plain;
+        encoder.encode(content, parmsId, scale, plain);
+        // dump the cipher text to stdout
+        encrypt(plain, writer);
+      }
+      spdlog::info("Given contents are encrypted with the CKKS scheme");
+      return;
+    }
 
+    ArithHomFA::CKKSPackedEncoder encoder(context);
+    if (*pack > encoder.slotCount()) {
+      throw std::invalid_argument("--pack must be at most the number of the slots (" +
+                                  std::to_string(encoder.slotCount()) + ")");
+    }
+    // signals.at(j).at(i) is the j-th signal at the i-th time step in the current batch
+    std::vector<std::vector<double>> signals(signalSize);
+    for (auto &signal: signals) {
+      signal.reserve(*pack);
+    }
+    auto writeBatch = [&] {
+      writer.writeHeader(ArithHomFA::PackedBatchHeader::make(signals.front().size()));
+      for (auto &signal: signals) {
+        seal::Plaintext plain;
+        encoder.encode(signal, parmsId, scale, plain);
+        encrypt(plain, writer);
+        signal.clear();
+      }
+    };
+    std::size_t numValues = 0;
     double content;
-    ArithHomFA::SizedCipherWriter writer(ostream);
-    while (istream.good()) {
-      // get the content from stdin
-      istream >> content;
-      if (!istream.good()) {
-        break;
+    while (istream >> content) {
+      signals.at(numValues++ % signalSize).push_back(content);
+      if (numValues % (signalSize * *pack) == 0) {
+        writeBatch();
       }
-      seal::Plaintext plain;
-      seal::Ciphertext cipher;
-      encoder.encode(content, scale, plain);
-      encryptor.encrypt_symmetric(plain, cipher);
-      // dump the cipher text to stdout
-      writer.write(cipher);
     }
-    spdlog::info("Given contents are encrypted with the CKKS scheme");
+    if (numValues % signalSize != 0) {
+      throw std::runtime_error("The number of the given values is not a multiple of the signal size");
+    }
+    if (!signals.front().empty()) {
+      // The last batch has fewer time steps, which is recorded in its header
+      writeBatch();
+    }
+    spdlog::info("Given contents are encrypted with the CKKS scheme, {} time steps per ciphertext", *pack);
+  }
+
+  template<class Writer>
+  void do_enc_SEAL_with_secret_key(const ArithHomFA::SealConfig &config, const std::string &secretKeyPath,
+                                   std::optional<std::size_t> pack, std::size_t signalSize, bool compact,
+                                   std::optional<std::size_t> level, std::istream &istream, Writer &writer) {
+    const seal::SEALContext context = config.makeContext();
+    const seal::SecretKey secretKey = ArithHomFA::KeyLoader::loadSecretKey(context, secretKeyPath);
+    seal::Encryptor encryptor(context, secretKey);
+    if (compact) {
+#ifndef SEAL_USE_ZSTD
+      spdlog::warn("SEAL is built without zstd. The ciphertexts are less compressed.");
+#endif
+      // The seeded ciphertext can only be serialized. This is fine because we do nothing but write it.
+      do_enc_SEAL_with_encryptor(context, config.scale, pack, signalSize, level, istream, writer,
+                                 [&](const seal::Plaintext &plain, Writer &output) {
+                                   output.write(encryptor.encrypt_symmetric(plain));
+                                 });
+      return;
+    }
+    do_enc_SEAL_with_encryptor(context, config.scale, pack, signalSize, level, istream, writer,
+                               [&](const seal::Plaintext &plain, Writer &output) {
+                                 seal::Ciphertext cipher;
+                                 encryptor.encrypt_symmetric(plain, cipher);
+                                 output.write(cipher);
+                               });
   }
 
+  template<class Writer>
   void do_enc_SEAL_with_public_key(const ArithHomFA::SealConfig &config, const std::string &publicKeyPath,
-                                   std::istream &istream, std::ostream &ostream) {
+                                   std::optional<std::size_t> pack, std::size_t signalSize,
+                                   std::optional<std::size_t> level, std::istream &istream, Writer &writer) {
     const seal::SEALContext context = config.makeContext();
-    const double scale = config.scale;
     const seal::PublicKey publicKey = ArithHomFA::KeyLoader::loadPublicKey(context, publicKeyPath);
     seal::Encryptor encryptor(context, publicKey);
-
-    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
-
-    double content;
-    ArithHomFA::SizedCipherWriter writer(ostream);
-    while (istream.good()) {
-      // get the content from stdin
-      istream >> content;
-      if (!istream.good()) {
-        break;
-      }
-      seal::Plaintext plain;
-      seal::Ciphertext cipher;
-      encoder.encode(content, scale, plain);
-      encryptor.encrypt(plain, cipher);
-      // dump the cipher text to stdout
-      writer.write(cipher);
-    }
-    spdlog::info("Given contents are encrypted with the CKKS scheme");
+    do_enc_SEAL_with_encryptor(context, config.scale, pack, signalSize, level, istream, writer,
+                               [&](const seal::Plaintext &plain, Writer &output) {
+                                 seal::Ciphertext cipher;
+                                 encryptor.encrypt(plain, cipher);
+                                 output.write(cipher);
+                               });
   }
 
 
-  void do_enc_SEAL(const ArithHomFA::SealConfig &config, const std::optional<std::string> &secretKeyPath,
-                   const std::optional<std::string> &publicKeyPath, std::istream &istream, std::ostream &ostream) {
+  template<class Writer>
+  void do_enc_SEAL_with_writer(const ArithHomFA::SealConfig &config, const std::optional<std::string> &secretKeyPath,
+                               const std::optional<std::string> &publicKeyPath, std::optional<std::size_t> pack,
+                               std::size_t signalSize, bool compact, std::optional<std::size_t> level,
+                               std::istream &istream, Writer &writer) {
     if (secretKeyPath) {
-      do_enc_SEAL_with_secret_key(config, *secretKeyPath, istream, ostream);
+      do_enc_SEAL_with_secret_key(config, *secretKeyPath, pack, signalSize, compact, level, istream, writer);
+    } else if (compact) {
+      // A ciphertext encrypted with a public key has no seed
+      throw std::invalid_argument("--compact requires the secret key");
     } else if (publicKeyPath) {
-      do_enc_SEAL_with_public_key(config, *publicKeyPath, istream, ostream);
+      do_enc_SEAL_with_public_key(config, *publicKeyPath, pack, signalSize, level, istream, writer);
     } else {
       throw std::runtime_error("No key is given");
     }
   }
 
+  /*
+   * A regular output file is written through a large aligned buffer bypassing the page cache, and the other outputs,
+   * e.g., stdout or a pipe, are written through the stream.
+   */
+  void do_enc_SEAL(const ArithHomFA::SealConfig &config, const std::optional<std::string> &secretKeyPath,
+                   const std::optional<std::string> &publicKeyPath, std::optional<std::size_t> pack,
+                   std::size_t signalSize, bool compact, std::optional<std::size_t> level, std::istream &istream,
+                   std::ostream &ostream, const std::optional<std::string> &outputPath) {
+    if (outputPath && std::filesystem::is_regular_file(*outputPath)) {
+      ArithHomFA::DirectSizedCipherWriter writer(*outputPath);
+      do_enc_SEAL_with_writer(config, secretKeyPath, publicKeyPath, pack, signalSize, compact, level, istream, writer);
+      writer.close();
+    } else {
+      ArithHomFA::SizedCipherWriter writer(ostream);
+      do_enc_SEAL_with_writer(config, secretKeyPath, publicKeyPath, pack, signalSize, compact, level, istream, writer);
+    }
+  }
+
   void do_dec_SEAL(const ArithHomFA::SealConfig &config, const std::string &secretKeyPath, std::istream &istream,
                    std::ostream &ostream) {
     const seal::SEALContext context = config.makeContext();
@@ -425,7 +556,8 @@ namespace {
                      const bool vertical) {
     auto skey = read_from_archive<TFHEpp::SecretKey>(skey_filename);
 
-    ArithHomFA::SizedTLWEReader<TFHEpp::lvl1param> reader{istream};
+    // Both the sized and the raw formats are accepted
+    ArithHomFA::TLWEReader<TFHEpp::lvl1param> reader{istream};
     while (istream.good()) {
       // get the cipher text from stdin
       TFHEpp::TLWE<TFHEpp::lvl1param> cipher;
@@ -469,6 +601,11 @@ namespace {
 #else
     spdlog::info("\tProfiling: disabled");
 #endif
+#if defined(HOMFA_RUNTIME_DISPATCH)
+    spdlog::info("\tRuntime CPU dispatch: enabled");
+#else
+    spdlog::info("\tRuntime CPU dispatch: disabled");
+#endif
 
     // Show execution setting
     spdlog::info("Executed with:");
@@ -484,9 +621,13 @@ namespace {
         ss << "CPUPROFILE=" << envvar << " ";
       if (char *envvar = std::getenv("HEAPPROFILE"); envvar != nullptr)
         ss << "HEAPPROFILE=" << envvar << " ";
+      if (char *envvar = std::getenv("AHOMFA_CPU_LEVEL"); envvar != nullptr)
+        ss << "AHOMFA_CPU_LEVEL=" << envvar << " ";
       spdlog::info("\tEnv var: {}", ss.str());
     }
     spdlog::info("\tConcurrency:\t{}", std::thread::hardware_concurrency());
+    spdlog::info("\tCPU kernels:\t{} (detected: {})", cpu_level_name(cpu_level()),
+                 cpu_level_name(detect_cpu_level()));
 
     spdlog::info(R"(============================================================)");
   }
@@ -547,7 +688,8 @@ int main(int argc, char **argv) {
       break;
     }
     case TYPE::ENC_CKKS: {
-      do_enc_SEAL(*args.sealConfig, args.sealSecretKey, args.sealPublicKey, *args.input, *args.output);
+      do_enc_SEAL(*args.sealConfig, args.sealSecretKey, args.sealPublicKey, args.pack, args.signal_size, args.compact,
+                  args.level, *args.input, *args.output, args.outputPath);
       break;
     }
     case TYPE::DEC_CKKS: {
@@ -562,6 +704,10 @@ int main(int argc, char **argv) {
       do_genbkey_TFHEpp(*args.sealConfig, *args.sealSecretKey, std::ifstream(*args.skey), *args.output);
       break;
     }
+    case TYPE::CONVERT_BKEY_TFHEPP: {
+      do_convert_bkey_TFHEpp(*args.input, *args.output);
+      break;
+    }
     case TYPE::ENC_TFHEPP: {
       do_enc_TFHEpp(*args.skey, *args.input, *args.output);
       break;
@@ -0,0 +1,293 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "archive.hpp"
+
+#include "bootstrapping_key.hh"
+
+namespace ArithHomFA {
+  /*!
+   * @brief The native on-disk format of BootstrappingKey that can be memory-mapped and used in place
+   *
+   * The file starts with MappedBootstrappingKeyHeader, followed by the raw little-endian images of kskh2m, kskm2l,
+   * bkfft, and tlwel1_trlwel1_ikskey, each aligned to a page. EvalKey of TFHEpp is not a flat object, but the keys in
+   * it used by the runners, i.e., the keys made by the constructor of BKey, are flat. They are stored in the same way.
+   */
+  struct MappedBootstrappingKeyHeader {
+    static constexpr std::array<char, 8> expectedMagic = {'A', 'H', 'F', 'A', 'B', 'K', 'E', 'Y'};
+    static constexpr uint32_t currentVersion = 2;
+    static constexpr std::size_t alignment = 4096;
+    //! The number of the private key-switching keys for the circuit bootstrapping
+    static constexpr std::size_t numPrivksk4cb = TFHEpp::lvl21param::targetP::k + 1;
+
+    struct Section {
+      uint64_t offset;
+      uint64_t size;
+    };
+
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t headerSize;
+    Section kskh2m, kskm2l, bkfft, ikskey;
+    //! The keys in EvalKey
+    Section iksklvl10, bkfftlvl01, bkfftlvl02;
+    std::array<Section, numPrivksk4cb> privksk4cb;
+
+    //! The name of the i-th private key-switching key for the circuit bootstrapping in EvalKey
+    static std::string privksk4cbName(std::size_t i) {
+      return "privksk4cb_" + std::to_string(i);
+    }
+  };
+
+  namespace detail {
+    constexpr uint64_t alignUp(uint64_t offset) {
+      constexpr auto alignment = MappedBootstrappingKeyHeader::alignment;
+      return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    //! Owner of a memory mapping, which is shared by the keys mapped in it
+    class MappedFile {
+    public:
+      explicit MappedFile(const std::string &path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+          throw std::runtime_error("Failed to open the bootstrapping key: " + path);
+        }
+        struct stat status{};
+        if (fstat(fd, &status) < 0) {
+          close(fd);
+          throw std::runtime_error("Failed to stat the bootstrapping key: " + path);
+        }
+        size = status.st_size;
+        // The pages are private and copy-on-write, so the file is never modified even if a key is written
+        addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) {
+          throw std::runtime_error("Failed to map the bootstrapping key: " + path);
+        }
+      }
+
+      MappedFile(const MappedFile &) = delete;
+      MappedFile &operator=(const MappedFile &) = delete;
+
+      ~MappedFile() {
+        munmap(addr, size);
+      }
+
+      [[nodiscard]] char *data() const {
+        return static_cast<char *>(addr);
+      }
+
+      [[nodiscard]] std::size_t getSize() const {
+        return size;
+      }
+
+    private:
+      void *addr;
+      std::size_t size;
+    };
+
+    template<class T>
+    T *sectionData(const MappedFile &file, const MappedBootstrappingKeyHeader::Section &section) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      if (section.size != sizeof(T) || section.offset % MappedBootstrappingKeyHeader::alignment != 0 ||
+          section.offset + section.size > file.getSize()) {
+        throw std::runtime_error("Broken section in the mapped bootstrapping key");
+      }
+      return reinterpret_cast<T *>(file.data() + section.offset);
+    }
+
+    template<class T>
+    std::shared_ptr<T> mapSection(const std::shared_ptr<MappedFile> &file,
+                                  const MappedBootstrappingKeyHeader::Section &section) {
+      // Aliasing constructor: the key keeps the whole mapping alive
+      return std::shared_ptr<T>(file, sectionData<T>(*file, section));
+    }
+
+    //! Makes the owner of a key in EvalKey point to a key in the mapping, which must not be deleted by the owner
+    template<class Owner, class T>
+    void attachSection(Owner &owner, T *key) {
+      if constexpr (requires { owner.release(); }) {
+        // unique_ptr: released by detachSection before the EvalKey is deleted
+        owner.reset(key);
+      } else {
+        // shared_ptr: the key is never deleted
+        owner = Owner(key, [](T *) {});
+      }
+    }
+
+    template<class Owner>
+    void detachSection(Owner &owner) {
+      if constexpr (requires { owner.release(); }) {
+        static_cast<void>(owner.release());
+      }
+    }
+
+    /*!
+     * @brief Makes an EvalKey whose keys are in the mapping
+     *
+     * The keys in the mapping are detached before the EvalKey is deleted, and the deleter keeps the whole mapping alive.
+     */
+    inline std::shared_ptr<TFHEpp::EvalKey> mapEvalKey(const std::shared_ptr<MappedFile> &file,
+                                                       const MappedBootstrappingKeyHeader &header) {
+      std::shared_ptr<TFHEpp::EvalKey> ekey(new TFHEpp::EvalKey(), [file](TFHEpp::EvalKey *ekey) {
+        detachSection(ekey->iksklvl10);
+        detachSection(ekey->bkfftlvl01);
+        detachSection(ekey->bkfftlvl02);
+        for (auto &[name, privksk]: ekey->privksklvl21) {
+          detachSection(privksk);
+        }
+        delete ekey;
+      });
+      attachSection(ekey->iksklvl10,
+                    sectionData<TFHEpp::KeySwitchingKey<TFHEpp::lvl10param>>(*file, header.iksklvl10));
+      attachSection(ekey->bkfftlvl01,
+                    sectionData<TFHEpp::BootstrappingKeyFFT<TFHEpp::lvl01param>>(*file, header.bkfftlvl01));
+      attachSection(ekey->bkfftlvl02,
+                    sectionData<TFHEpp::BootstrappingKeyFFT<TFHEpp::lvl02param>>(*file, header.bkfftlvl02));
+      for (std::size_t i = 0; i < header.privksk4cb.size(); ++i) {
+        attachSection(ekey->privksklvl21[MappedBootstrappingKeyHeader::privksk4cbName(i)],
+                      sectionData<TFHEpp::PrivateKeySwitchingKey<TFHEpp::lvl21param>>(*file, header.privksk4cb.at(i)));
+      }
+
+      return ekey;
+    }
+
+    template<class T>
+    void writeSection(std::ostream &ostream, uint64_t &position, const MappedBootstrappingKeyHeader::Section &section,
+                      const T &value) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      static constexpr std::array<char, MappedBootstrappingKeyHeader::alignment> zeros{};
+      ostream.write(zeros.data(), section.offset - position);
+      ostream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+      position = section.offset + sizeof(T);
+    }
+  } // namespace detail
+
+  /*!
+   * @brief Writes the bootstrapping key in the memory-mappable format
+   *
+   * Only the keys in EvalKey made by the constructor of BKey are written.
+   */
+  inline void writeMappedBootstrappingKey(std::ostream &ostream, const BootstrappingKey &key) {
+    if constexpr (std::endian::native != std::endian::little) {
+      throw std::runtime_error("The mapped bootstrapping key is supported only on little-endian machines");
+    }
+    const auto &ekey = *key.ekey;
+    std::array<const TFHEpp::PrivateKeySwitchingKey<TFHEpp::lvl21param> *, MappedBootstrappingKeyHeader::numPrivksk4cb>
+        privksk4cb{};
+    for (std::size_t i = 0; i < privksk4cb.size(); ++i) {
+      privksk4cb.at(i) = ekey.privksklvl21.at(MappedBootstrappingKeyHeader::privksk4cbName(i)).get();
+    }
+
+    MappedBootstrappingKeyHeader header{};
+    header.magic = MappedBootstrappingKeyHeader::expectedMagic;
+    header.version = MappedBootstrappingKeyHeader::currentVersion;
+    header.headerSize = sizeof(MappedBootstrappingKeyHeader);
+    // The sections are placed one after another, each aligned to a page
+    uint64_t end = sizeof(header);
+    auto place = [&end](uint64_t size) {
+      const MappedBootstrappingKeyHeader::Section section{detail::alignUp(end), size};
+      end = section.offset + section.size;
+      return section;
+    };
+    header.kskh2m = place(sizeof(*key.kskh2m));
+    header.kskm2l = place(sizeof(*key.kskm2l));
+    header.bkfft = place(sizeof(*key.bkfft));
+    header.ikskey = place(sizeof(*key.tlwel1_trlwel1_ikskey));
+    header.iksklvl10 = place(sizeof(*ekey.iksklvl10));
+    header.bkfftlvl01 = place(sizeof(*ekey.bkfftlvl01));
+    header.bkfftlvl02 = place(sizeof(*ekey.bkfftlvl02));
+    for (std::size_t i = 0; i < privksk4cb.size(); ++i) {
+      header.privksk4cb.at(i) = place(sizeof(*privksk4cb.at(i)));
+    }
+
+    ostream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    uint64_t position = sizeof(header);
+    detail::writeSection(ostream, position, header.kskh2m, *key.kskh2m);
+    detail::writeSection(ostream, position, header.kskm2l, *key.kskm2l);
+    detail::writeSection(ostream, position, header.bkfft, *key.bkfft);
+    detail::writeSection(ostream, position, header.ikskey, *key.tlwel1_trlwel1_ikskey);
+    detail::writeSection(ostream, position, header.iksklvl10, *ekey.iksklvl10);
+    detail::writeSection(ostream, position, header.bkfftlvl01, *ekey.bkfftlvl01);
+    detail::writeSection(ostream, position, header.bkfftlvl02, *ekey.bkfftlvl02);
+    for (std::size_t i = 0; i < privksk4cb.size(); ++i) {
+      detail::writeSection(ostream, position, header.privksk4cb.at(i), *privksk4cb.at(i));
+    }
+    if (!ostream) {
+      throw std::runtime_error("Failed to write the mapped bootstrapping key");
+    }
+  }
+
+  /*!
+   * @brief Returns if the file is a bootstrapping key in the memory-mappable format
+   */
+  inline bool isMappedBootstrappingKey(const std::string &path) {
+    std::ifstream stream{path, std::ios::binary};
+    std::array<char, 8> magic{};
+    stream.read(magic.data(), magic.size());
+    return stream.good() && magic == MappedBootstrappingKeyHeader::expectedMagic;
+  }
+
+  /*!
+   * @brief Loads a bootstrapping key in the memory-mappable format
+   *
+   * The key-switching and bootstrapping keys, including those in EvalKey, are used in place from the mapping, so they
+   * are paged in lazily and shared with the page cache. The mapping is released when all the keys referring to it are destructed.
+   */
+  inline BootstrappingKey mapBootstrappingKey(const std::string &path) {
+    if constexpr (std::endian::native != std::endian::little) {
+      throw std::runtime_error("The mapped bootstrapping key is supported only on little-endian machines");
+    }
+    auto file = std::make_shared<detail::MappedFile>(path);
+    MappedBootstrappingKeyHeader header{};
+    if (file->getSize() < sizeof(header)) {
+      throw std::runtime_error("Too short mapped bootstrapping key: " + path);
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.magic != MappedBootstrappingKeyHeader::expectedMagic ||
+        header.version != MappedBootstrappingKeyHeader::currentVersion ||
+        header.headerSize != sizeof(MappedBootstrappingKeyHeader)) {
+      throw std::runtime_error("Unsupported mapped bootstrapping key: " + path);
+    }
+    BootstrappingKey key;
+    key.kskh2m = detail::mapSection<TFHEpp::KeySwitchingKey<BootstrappingKey::high2midP>>(file, header.kskh2m);
+    key.kskm2l = detail::mapSection<TFHEpp::KeySwitchingKey<BootstrappingKey::mid2lowP>>(file, header.kskm2l);
+    key.bkfft = detail::mapSection<TFHEpp::BootstrappingKeyFFT<BootstrappingKey::brP>>(file, header.bkfft);
+    key.tlwel1_trlwel1_ikskey =
+        detail::mapSection<TFHEpp::TLWE2TRLWEIKSKey<TFHEpp::lvl11param>>(file, header.ikskey);
+    key.ekey = detail::mapEvalKey(file, header);
+
+    return key;
+  }
+
+  /*!
+   * @brief Loads a bootstrapping key either in the memory-mappable format or in the cereal archive
+   */
+  inline BootstrappingKey loadBootstrappingKey(const std::string &path) {
+    if (isMappedBootstrappingKey(path)) {
+      return mapBootstrappingKey(path);
+    } else {
+      return read_from_archive<BootstrappingKey>(path);
+    }
+  }
+} // namespace ArithHomFA
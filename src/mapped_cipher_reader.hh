@@ -0,0 +1,120 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <seal/seal.h>
+
+namespace ArithHomFA {
+  /*!
+   * @brief Read the ciphertexts with their sizes from a memory-mapped file
+   *
+   * The file is in the format written by SizedCipherWriter. Unlike SizedCipherReader, the records are not copied to an
+   * intermediate buffer: each ciphertext is deserialized directly from the mapping, and the kernel reads the file ahead
+   * since it is accessed sequentially.
+   */
+  class MappedSizedCipherReader {
+  public:
+    explicit MappedSizedCipherReader(const std::string &path) {
+      const int fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0) {
+        throw std::runtime_error("Failed to open the ciphertexts: " + path);
+      }
+      struct stat status{};
+      if (fstat(fd, &status) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to stat the ciphertexts: " + path);
+      }
+      size = status.st_size;
+      if (size == 0) {
+        // mmap fails for an empty file
+        close(fd);
+        return;
+      }
+      addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (addr == MAP_FAILED) {
+        addr = nullptr;
+        throw std::runtime_error("Failed to map the ciphertexts: " + path);
+      }
+      madvise(addr, size, MADV_SEQUENTIAL);
+    }
+
+    MappedSizedCipherReader(const MappedSizedCipherReader &) = delete;
+    MappedSizedCipherReader &operator=(const MappedSizedCipherReader &) = delete;
+
+    ~MappedSizedCipherReader() {
+      if (addr) {
+        munmap(addr, size);
+      }
+    }
+
+    [[nodiscard]] bool good() const {
+      return position + sizeof(uint32_t) <= size;
+    }
+
+    bool read(const seal::SEALContext &context, seal::Ciphertext &cipher) {
+      if (!good()) {
+        return false;
+      }
+      const auto *data = static_cast<const char *>(addr) + position;
+      uint32_t length;
+      std::memcpy(&length, data, sizeof(uint32_t));
+      if (position + sizeof(uint32_t) + length > size) {
+        // The last record is truncated
+        position = size;
+        return false;
+      }
+      cipher.load(context, reinterpret_cast<const seal::seal_byte *>(data + sizeof(uint32_t)), length);
+      position += sizeof(uint32_t) + length;
+
+      return true;
+    }
+
+    /*!
+     * @brief Read a header written by SizedCipherWriter::writeHeader
+     *
+     * @returns false if there is no more record
+     */
+    template<class Header>
+    bool readHeader(Header &header) {
+      static_assert(std::is_trivially_copyable_v<Header>);
+      if (!good()) {
+        return false;
+      }
+      const auto *data = static_cast<const char *>(addr) + position;
+      uint32_t length;
+      std::memcpy(&length, data, sizeof(uint32_t));
+      if (length != sizeof(Header)) {
+        throw std::runtime_error("Unexpected record in place of a header");
+      }
+      if (position + sizeof(uint32_t) + length > size) {
+        position = size;
+        return false;
+      }
+      std::memcpy(&header, data + sizeof(uint32_t), sizeof(Header));
+      position += sizeof(uint32_t) + length;
+
+      return true;
+    }
+
+  private:
+    void *addr = nullptr;
+    std::size_t size = 0;
+    //! The offset of the next record
+    std::size_t position = 0;
+  };
+} // namespace ArithHomFA
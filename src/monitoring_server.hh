@@ -0,0 +1,378 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <ThreadPool.h>
+#include <seal/seal.h>
+
+#include "abstract_runner.hh"
+#include "ckks_predicate.hh"
+#include "sized_tlwe_writer.hh"
+
+namespace ArithHomFA {
+  /*!
+   * @brief Long-lived monitoring server handling many independent streams over a Unix domain socket
+   *
+   * Each connection is a session with its own runner. A client writes the length-prefixed CKKS ciphertexts of the
+   * valuations, as in the input of ahomfa_runner, and receives the length-prefixed TLWE ciphertexts of the results on
+   * the same connection. The client closes its writing side to finish the session.
+   *
+   * The keys are loaded only once by the caller and shared by the runners made by the factory. The valuations of all
+   * the sessions are evaluated on a shared thread pool, where the valuations of each session are evaluated one by one
+   * in order. A session is not read while it has maxPendingValuations valuations waiting for the evaluation, and only
+   * one incomplete record of at most the size of a ciphertext is buffered, so that a client sending faster than the
+   * monitor does not make the server use unbounded memory. A session whose client does not read the results for
+   * sendTimeoutMs is finished so that it does not occupy a thread of the pool.
+   *
+   * @note The runners of different sessions run concurrently. Thus, the user-defined predicate must not have a mutable
+   * state shared among the instances of CKKSPredicate, e.g., static variables.
+   */
+  template<RunnerMode mode>
+  class MonitoringServer {
+  public:
+    using RunnerFactory = std::function<std::unique_ptr<AbstractRunner<mode>>()>;
+
+    /*!
+     * @param context The SEAL context of the ciphertexts sent by the clients
+     * @param socketPath The path of the Unix domain socket to listen to
+     * @param numThreads The number of the threads to evaluate the valuations
+     * @param factory The function to make the runner of a new session
+     */
+    MonitoringServer(const seal::SEALContext &context, std::string socketPath, std::size_t numThreads,
+                     RunnerFactory factory)
+        : context(context), maxRecordBytes(maxCipherBytes(context)), socketPath(std::move(socketPath)),
+          factory(std::move(factory)), pool(numThreads) {
+      sockaddr_un address{};
+      address.sun_family = AF_UNIX;
+      if (this->socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("The socket path is too long: " + this->socketPath);
+      }
+      std::strncpy(address.sun_path, this->socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+      listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+      if (listenFd < 0) {
+        throw std::runtime_error(std::string("Failed to create a socket: ") + strerror(errno));
+      }
+      removeSocket(this->socketPath);
+      if (bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(listenFd, SOMAXCONN) < 0) {
+        const std::string message = std::string("Failed to listen to ") + this->socketPath + ": " + strerror(errno);
+        close(listenFd);
+        throw std::runtime_error(message);
+      }
+      setNonBlocking(listenFd);
+    }
+
+    ~MonitoringServer() {
+      close(listenFd);
+      removeSocket(socketPath);
+    }
+
+    /*!
+     * @brief Accepts and serves the sessions until stop() is called
+     */
+    void serve() {
+      spdlog::info("Listening to {}", socketPath);
+      std::vector<pollfd> pollFds;
+      std::vector<std::shared_ptr<Session>> polledSessions;
+      while (!stopping) {
+        // Remove the finished sessions
+        std::erase_if(sessions, [](const auto &pair) {
+          std::lock_guard lock(pair.second->mutex);
+          return pair.second->finished;
+        });
+
+        pollFds.assign(1, {listenFd, POLLIN, 0});
+        polledSessions.clear();
+        for (const auto &[id, session]: sessions) {
+          std::lock_guard lock(session->mutex);
+          // A throttled session is polled again after its valuations are evaluated, at the latest after pollTimeoutMs
+          if (!session->eof && session->pending.size() < maxPendingValuations) {
+            pollFds.push_back({session->fd, POLLIN, 0});
+            polledSessions.push_back(session);
+          }
+        }
+        if (poll(pollFds.data(), pollFds.size(), pollTimeoutMs) < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          throw std::runtime_error(std::string("Failed to poll: ") + strerror(errno));
+        }
+
+        if (pollFds.front().revents & POLLIN) {
+          accept();
+        }
+        for (std::size_t i = 0; i < polledSessions.size(); ++i) {
+          if (pollFds.at(i + 1).revents & (POLLIN | POLLHUP | POLLERR)) {
+            receive(polledSessions.at(i));
+          }
+        }
+      }
+      spdlog::info("Stopped listening to {}", socketPath);
+    }
+
+    /*!
+     * @brief Stops serve(). The running evaluations are completed when the server is destructed.
+     */
+    void stop() {
+      stopping = true;
+    }
+
+  private:
+    struct Session {
+      const std::size_t id;
+      const int fd;
+      std::unique_ptr<AbstractRunner<mode>> runner;
+      // The following variables are used only by the main thread
+      std::vector<char> buffer;
+      std::vector<std::string> records;
+      // The following variables are guarded by mutex
+      std::mutex mutex;
+      std::deque<std::vector<std::string>> pending;
+      bool busy = false;
+      bool eof = false;
+      bool finished = false;
+
+      Session(std::size_t id, int fd) : id(id), fd(fd) {
+      }
+
+      ~Session() {
+        close(fd);
+      }
+    };
+
+    static constexpr int pollTimeoutMs = 100;
+    //! The time to wait for a client to read the results before the session is finished
+    static constexpr int sendTimeoutMs = 60000;
+    //! The number of the valuations of a session waiting for the evaluation above which the session is not read
+    static constexpr std::size_t maxPendingValuations = 64;
+    const seal::SEALContext &context;
+    //! The maximum size of a record, i.e., of a serialized ciphertext
+    const std::size_t maxRecordBytes;
+    const std::string socketPath;
+    const RunnerFactory factory;
+    int listenFd;
+    std::atomic<bool> stopping = false;
+    std::size_t nextSessionId = 0;
+    std::unordered_map<std::size_t, std::shared_ptr<Session>> sessions;
+    // The pool must be destructed before the sessions so that the running evaluations are completed
+    ThreadPool pool;
+
+    //! Removes the socket left by a previous server. A file of another type is not removed.
+    static void removeSocket(const std::string &path) {
+      struct stat status{};
+      if (lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+        unlink(path.c_str());
+      }
+    }
+
+    //! The upper bound of the size of a serialized ciphertext of the context
+    static std::size_t maxCipherBytes(const seal::SEALContext &context) {
+      seal::Ciphertext cipher(context);
+      cipher.resize(context, context.first_parms_id(), 2);
+      return static_cast<std::size_t>(std::max(cipher.save_size(seal::compr_mode_type::none),
+                                               cipher.save_size(seal::Serialization::compr_mode_default)));
+    }
+
+    static void setNonBlocking(int fd) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    void accept() {
+      while (true) {
+        const int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+          if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            spdlog::error("Failed to accept a connection: {}", strerror(errno));
+          }
+          return;
+        }
+        setNonBlocking(fd);
+        const std::size_t id = nextSessionId++;
+        sessions.emplace(id, std::make_shared<Session>(id, fd));
+        spdlog::debug("Session {}: started", id);
+      }
+    }
+
+    /*!
+     * @brief Reads the available bytes of the session and schedules the evaluation of the complete valuations
+     *
+     * The reading stops when the session has maxPendingValuations valuations including the ones read now.
+     */
+    void receive(const std::shared_ptr<Session> &session) {
+      std::size_t numPending;
+      {
+        std::lock_guard lock(session->mutex);
+        numPending = session->pending.size();
+      }
+      // The buffer holds at most one incomplete record after parse()
+      const std::size_t maxBufferedBytes = sizeof(uint32_t) + maxRecordBytes;
+      bool eof = false;
+      std::vector<std::vector<std::string>> valuations;
+      char chunk[1 << 16];
+      while (numPending + valuations.size() < maxPendingValuations) {
+        const std::size_t capacity = std::min(sizeof(chunk), maxBufferedBytes - session->buffer.size());
+        const ssize_t size = read(session->fd, chunk, capacity);
+        if (size > 0) {
+          session->buffer.insert(session->buffer.end(), chunk, chunk + size);
+          if (!parse(*session, valuations)) {
+            eof = true;
+            break;
+          }
+        } else if (size == 0) {
+          eof = true;
+          break;
+        } else if (errno == EINTR) {
+          continue;
+        } else {
+          if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            spdlog::error("Session {}: failed to read: {}", session->id, strerror(errno));
+            eof = true;
+          }
+          break;
+        }
+      }
+      if (eof && (!session->buffer.empty() || !session->records.empty())) {
+        spdlog::warn("Session {}: the incomplete valuation at the end is ignored", session->id);
+      }
+
+      std::lock_guard lock(session->mutex);
+      std::move(valuations.begin(), valuations.end(), std::back_inserter(session->pending));
+      session->eof = session->eof || eof;
+      if (session->busy) {
+        // The running task handles the new valuations
+        return;
+      }
+      if (!session->pending.empty()) {
+        session->busy = true;
+        pool.enqueue([this, session] { process(session); });
+      } else if (session->eof) {
+        finish(*session);
+      }
+    }
+
+    /*!
+     * @brief Moves the complete records in the buffer of the session to the valuations
+     *
+     * @returns false if the buffer has a record larger than maxRecordBytes
+     */
+    bool parse(Session &session, std::vector<std::vector<std::string>> &valuations) const {
+      std::size_t head = 0;
+      bool valid = true;
+      while (session.buffer.size() - head >= sizeof(uint32_t)) {
+        uint32_t length;
+        std::memcpy(&length, session.buffer.data() + head, sizeof(uint32_t));
+        if (length > maxRecordBytes) {
+          spdlog::error("Session {}: too large record of {} bytes", session.id, length);
+          valid = false;
+          break;
+        }
+        if (session.buffer.size() - head - sizeof(uint32_t) < length) {
+          break;
+        }
+        head += sizeof(uint32_t);
+        session.records.emplace_back(session.buffer.data() + head, length);
+        head += length;
+        if (session.records.size() == CKKSPredicate::getSignalSize()) {
+          valuations.push_back(std::move(session.records));
+          session.records.clear();
+        }
+      }
+      session.buffer.erase(session.buffer.begin(), session.buffer.begin() + head);
+
+      return valid;
+    }
+
+    /*!
+     * @brief Evaluates the pending valuations of the session one by one
+     */
+    void process(const std::shared_ptr<Session> &session) {
+      try {
+        if (!session->runner) {
+          session->runner = factory();
+        }
+        std::vector<seal::Ciphertext> valuations(CKKSPredicate::getSignalSize());
+        while (true) {
+          std::vector<std::string> records;
+          {
+            std::lock_guard lock(session->mutex);
+            if (session->pending.empty()) {
+              session->busy = false;
+              if (session->eof) {
+                finish(*session);
+              }
+              return;
+            }
+            records = std::move(session->pending.front());
+            session->pending.pop_front();
+          }
+          for (std::size_t i = 0; i < records.size(); ++i) {
+            valuations.at(i).load(context, reinterpret_cast<const seal::seal_byte *>(records.at(i).data()),
+                                  records.at(i).size());
+          }
+          std::stringstream stream;
+          SizedTLWEWriter<TFHEpp::lvl1param> writer{stream};
+          writer.write(session->runner->feed(valuations));
+          sendAll(session->fd, stream.str());
+        }
+      } catch (const std::exception &e) {
+        spdlog::error("Session {}: {}", session->id, e.what());
+        std::lock_guard lock(session->mutex);
+        session->pending.clear();
+        session->busy = false;
+        session->eof = true;
+        finish(*session);
+      }
+    }
+
+    /*!
+     * @pre session.mutex is locked
+     */
+    static void finish(Session &session) {
+      session.finished = true;
+      if (session.runner) {
+        spdlog::info("Session {}: finished", session.id);
+        session.runner->printTime();
+      }
+    }
+
+    static void sendAll(int fd, const std::string &data) {
+      std::size_t sent = 0;
+      while (sent < data.size()) {
+        const ssize_t size = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (size >= 0) {
+          sent += size;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          pollfd pollFd{fd, POLLOUT, 0};
+          if (poll(&pollFd, 1, sendTimeoutMs) == 0) {
+            throw std::runtime_error("Timed out to write the result: the client does not read it");
+          }
+        } else if (errno != EINTR) {
+          throw std::runtime_error(std::string("Failed to write the result: ") + strerror(errno));
+        }
+      }
+    }
+  };
+} // namespace ArithHomFA
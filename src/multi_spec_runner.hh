@@ -0,0 +1,218 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <execution>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "graph.hpp"
+
+#include "abstract_runner.hh"
+#include "ckks_predicate.hh"
+#include "ckks_to_tfhe.hh"
+#include "online_dfa.hpp"
+#include "seal_config.hh"
+#include "tic_toc.hh"
+
+namespace ArithHomFA {
+  /*!
+   * @brief Class for online monitoring of several specifications over the same signal
+   *
+   * The predicates are evaluated and converted to TRGSW only once for each valuation, and the resulting TRGSW
+   * ciphertexts are shared by the DFA runners of all the specifications. The DFA runners are evaluated in parallel.
+   * A DFA runner may monitor several specifications at once with the product automaton, in which case its verdicts
+   * occupy the consecutive entries of the results.
+   *
+   * @tparam DFARunner OnlineDFARunner2 for the reverse algorithm or OnlineDFARunner4 for the block algorithm
+   */
+  template<RunnerMode mode, class DFARunner>
+  class MultiSpecRunner {
+  public:
+    /*!
+     * @param runners The DFA runners of the specifications
+     * @param blockSize The number of the valuations fed to the DFA runners at once. The results change only after
+     * each block.
+     */
+    MultiSpecRunner(const seal::SEALContext &context, double scale, std::vector<std::unique_ptr<DFARunner>> runners,
+                    std::size_t blockSize, const BootstrappingKey &bkey, const std::vector<double> &references)
+        : runners(std::move(runners)), predicate(context, scale), bkey(bkey), converter(context),
+          references(references), blockSize(blockSize) {
+      converter.initializeConverter(this->bkey);
+      converter.prepareAmplifiers(this->references, scale);
+      // The offset of the verdicts of each runner in the results
+      std::size_t numOutputs = 0;
+      for (const auto &runner: this->runners) {
+        offsets.push_back(numOutputs);
+        numOutputs += runner->graph().num_outputs();
+      }
+      latestResults.resize(numOutputs);
+      // The trivial TLWE representing true
+      for (auto &result: latestResults) {
+        result[TFHEpp::lvl1param::n] = (1u << 31); // 1/2
+      }
+    }
+
+    /*!
+     * @brief The number of the monitored specifications
+     */
+    [[nodiscard]] std::size_t size() const {
+      return latestResults.size();
+    }
+
+    /*!
+     * @brief Feeds a valuation to the DFAs of all the specifications
+     *
+     * @returns The monitoring results of the specifications in the order of the runners and their outputs
+     */
+    std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>> feed(const std::vector<seal::Ciphertext> &valuations) {
+      this->timer.total.tic();
+      assert(valuations.size() == predicate.getSignalSize());
+      // Evaluate the predicates
+      ckksCiphers.resize(CKKSPredicate::getPredicateSize());
+      this->timer.predicate.tic();
+      predicate.eval(valuations, ckksCiphers);
+      this->timer.predicate.toc();
+
+      // Construct TRGSW only once for all the specifications
+      this->timer.ckks_to_tfhe.tic();
+      AbstractRunner<mode>::toLv1TRGSWFFTs(converter, ckksCiphers, trgsws, references);
+      this->timer.ckks_to_tfhe.toc();
+      this->timer.total.toc();
+
+      return feedRaw(trgsws);
+    }
+
+    /*!
+     * @brief Directly feeds the TRGSW ciphertexts of the predicates at a time step to the DFAs
+     */
+    std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>>
+    feedRaw(const std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>> &ciphers) {
+      this->timer.total.tic();
+      std::copy(ciphers.begin(), ciphers.end(), std::back_inserter(queuedTrgsws));
+      if (queuedTrgsws.size() >= CKKSPredicate::getPredicateSize() * blockSize) {
+        this->timer.dfa.tic();
+        std::vector<std::size_t> indices(runners.size());
+        std::iota(indices.begin(), indices.end(), 0);
+        std::for_each(std::execution::par, indices.begin(), indices.end(), [&](std::size_t i) {
+          for (const auto &trgsw: queuedTrgsws) {
+            runners.at(i)->eval_one(trgsw);
+          }
+          for (std::size_t j = 0; j < runners.at(i)->graph().num_outputs(); ++j) {
+            latestResults.at(offsets.at(i) + j) = runners.at(i)->result(j);
+          }
+        });
+        this->timer.dfa.toc();
+        queuedTrgsws.clear();
+      }
+      this->timer.total.toc();
+
+      return latestResults;
+    }
+
+    void setRelinKeys(const seal::RelinKeys &keys) {
+      this->predicate.setRelinKeys(keys);
+    }
+
+    /*!
+     * @brief Prints the time consumed by different stages of computations.
+     */
+    void printTime() const {
+      timer.print();
+    }
+
+  private:
+    std::vector<std::unique_ptr<DFARunner>> runners;
+    CKKSPredicate predicate;
+    const BootstrappingKey &bkey;
+    CKKSToTFHE converter;
+    const std::vector<double> references;
+    const std::size_t blockSize;
+    std::vector<std::size_t> offsets;
+    std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>> latestResults;
+    TicTocForRunner timer;
+    // temporary variables
+    std::vector<seal::Ciphertext> ckksCiphers;
+    std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>> trgsws;
+    std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>> queuedTrgsws;
+  };
+
+  /*!
+   * @brief Makes a runner monitoring the specifications with the reverse algorithm
+   */
+  template<RunnerMode mode>
+  MultiSpecRunner<mode, OnlineDFARunner2>
+  makeMultiSpecReverseRunner(const seal::SEALContext &context, double scale, const std::vector<Graph> &graphs,
+                             size_t boot_interval, const BootstrappingKey &bkey, const std::vector<double> &references,
+                             bool reversed = false) {
+    std::vector<std::unique_ptr<OnlineDFARunner2>> runners;
+    runners.reserve(graphs.size());
+    for (const auto &graph: graphs) {
+      runners.push_back(std::make_unique<OnlineDFARunner2>(graph, boot_interval, reversed, bkey.ekey, false));
+    }
+    return MultiSpecRunner<mode, OnlineDFARunner2>(context, scale, std::move(runners), 1, bkey, references);
+  }
+
+  /*!
+   * @brief Makes a runner monitoring the specifications with the block algorithm
+   */
+  template<RunnerMode mode>
+  MultiSpecRunner<mode, OnlineDFARunner4>
+  makeMultiSpecBlockRunner(const seal::SEALContext &context, double scale, const std::vector<Graph> &graphs,
+                           std::size_t blockSize, const BootstrappingKey &bkey, const std::vector<double> &references) {
+    std::vector<std::unique_ptr<OnlineDFARunner4>> runners;
+    runners.reserve(graphs.size());
+    for (const auto &graph: graphs) {
+      runners.push_back(
+          std::make_unique<OnlineDFARunner4>(graph, std::numeric_limits<std::size_t>::max(), *bkey.ekey, false));
+    }
+    return MultiSpecRunner<mode, OnlineDFARunner4>(context, scale, std::move(runners), blockSize, bkey, references);
+  }
+
+  /*!
+   * @brief Makes a runner monitoring the specifications with the reverse algorithm on their product automaton
+   *
+   * Unlike makeMultiSpecReverseRunner, each input is consumed by a single CMUX sweep over the product of the reversed
+   * DFAs, and the verdict of each specification is carried by its own coefficient of the weights.
+   */
+  template<RunnerMode mode>
+  MultiSpecRunner<mode, OnlineDFARunner2>
+  makeProductReverseRunner(const seal::SEALContext &context, double scale, const std::vector<Graph> &graphs,
+                           size_t boot_interval, const BootstrappingKey &bkey, const std::vector<double> &references,
+                           bool reversed = false) {
+    std::vector<Graph> reversedGraphs;
+    reversedGraphs.reserve(graphs.size());
+    for (const auto &graph: graphs) {
+      reversedGraphs.push_back(reversed ? graph : graph.reversed().minimized());
+    }
+    const Graph product = Graph::product(reversedGraphs).minimized();
+    spdlog::debug("The product automaton has {} states", product.size());
+    std::vector<std::unique_ptr<OnlineDFARunner2>> runners;
+    runners.push_back(std::make_unique<OnlineDFARunner2>(product, boot_interval, true, bkey.ekey, false,
+                                                         bkey.tlwel1_trlwel1_ikskey));
+    return MultiSpecRunner<mode, OnlineDFARunner2>(context, scale, std::move(runners), 1, bkey, references);
+  }
+
+  /*!
+   * @brief Makes a runner monitoring the specifications with the block algorithm on their product automaton
+   */
+  template<RunnerMode mode>
+  MultiSpecRunner<mode, OnlineDFARunner4>
+  makeProductBlockRunner(const seal::SEALContext &context, double scale, const std::vector<Graph> &graphs,
+                         std::size_t blockSize, const BootstrappingKey &bkey, const std::vector<double> &references) {
+    const Graph product = Graph::product(graphs).minimized();
+    spdlog::debug("The product automaton has {} states", product.size());
+    std::vector<std::unique_ptr<OnlineDFARunner4>> runners;
+    runners.push_back(
+        std::make_unique<OnlineDFARunner4>(product, std::numeric_limits<std::size_t>::max(), *bkey.ekey, false));
+    return MultiSpecRunner<mode, OnlineDFARunner4>(context, scale, std::move(runners), blockSize, bkey, references);
+  }
+} // namespace ArithHomFA
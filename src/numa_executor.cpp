@@ -0,0 +1,220 @@
+#include "numa_executor.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <regex>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+NumaExecutor::NumaExecutor(size_t max_nodes)
+    : num_workers_(0),
+      generation_(0),
+      num_running_(0),
+      stop_(false),
+      task_(nullptr)
+{
+    assert(max_nodes > 0);
+
+    std::vector<std::vector<int>> nodes = detect_nodes();
+    if (nodes.size() > max_nodes)
+        nodes.resize(max_nodes);
+    for (auto&& cpus : nodes) {
+        auto node = std::make_unique<Node>();
+        node->cpus = std::move(cpus);
+        node->next = 0;
+        node->end = 0;
+        nodes_.push_back(std::move(node));
+    }
+    if (nodes_.empty()) {
+        // The topology is unknown. Use all the CPUs without pinning.
+        auto node = std::make_unique<Node>();
+        node->next = 0;
+        node->end = 0;
+        nodes_.push_back(std::move(node));
+    }
+
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        Node& node = *nodes_.at(i);
+        size_t num_workers = node.cpus.size();
+        if (num_workers == 0)
+            num_workers = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t j = 0; j < num_workers; j++)
+            node.workers.emplace_back([this, i] { work(i); });
+        num_workers_ += num_workers;
+        spdlog::debug("NUMA node {}: {} workers", i, num_workers);
+    }
+}
+
+NumaExecutor::~NumaExecutor()
+{
+    {
+        std::lock_guard lock(mtx_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto&& node : nodes_)
+        for (auto&& worker : node->workers)
+            worker.join();
+}
+
+NumaExecutor::Ranges NumaExecutor::shards(size_t n) const
+{
+    Ranges ranges;
+    size_t acc = 0;
+    for (auto&& node : nodes_) {
+        size_t begin = n * acc / num_workers_;
+        acc += node->workers.size();
+        size_t end = n * acc / num_workers_;
+        ranges.emplace_back(begin, end);
+    }
+    return ranges;
+}
+
+NumaExecutor::Ranges NumaExecutor::shards_of(
+    const std::vector<size_t>& sorted_indices, size_t n) const
+{
+    assert(std::is_sorted(sorted_indices.begin(), sorted_indices.end()));
+    Ranges ranges;
+    auto it = sorted_indices.begin();
+    for (auto&& [begin, end] : shards(n)) {
+        auto first = it;
+        it = std::lower_bound(first, sorted_indices.end(), end);
+        ranges.emplace_back(first - sorted_indices.begin(),
+                            it - sorted_indices.begin());
+    }
+    return ranges;
+}
+
+void NumaExecutor::parallel_for(const Ranges& ranges, const Task& task)
+{
+    assert(ranges.size() == nodes_.size());
+
+    std::lock_guard call_lock(call_mtx_);
+    std::unique_lock lock(mtx_);
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        nodes_.at(i)->next = ranges.at(i).first;
+        nodes_.at(i)->end = ranges.at(i).second;
+    }
+    task_ = &task;
+    num_running_ = num_workers_;
+    generation_++;
+    start_cv_.notify_all();
+    done_cv_.wait(lock, [&] { return num_running_ == 0; });
+    task_ = nullptr;
+}
+
+void NumaExecutor::on_each_node(const std::function<void(size_t)>& task)
+{
+    Ranges ranges;
+    for (size_t i = 0; i < nodes_.size(); i++)
+        ranges.emplace_back(i, i + 1);
+    parallel_for(ranges, [&](size_t node, size_t) { task(node); });
+}
+
+void NumaExecutor::work(size_t node_index)
+{
+    Node& node = *nodes_.at(node_index);
+#ifdef __linux__
+    if (!node.cpus.empty()) {
+        // Pin to the node rather than to a CPU to let the OS balance the
+        // workers in the node
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : node.cpus)
+            CPU_SET(cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            spdlog::warn("Failed to pin a worker to NUMA node {}", node_index);
+    }
+#endif
+
+    size_t seen = 0;
+    while (true) {
+        const Task* task;
+        {
+            std::unique_lock lock(mtx_);
+            start_cv_.wait(lock,
+                           [&] { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+            seen = generation_;
+            task = task_;
+        }
+        for (size_t i = node.next++; i < node.end; i = node.next++)
+            (*task)(node_index, i);
+        {
+            std::lock_guard lock(mtx_);
+            if (--num_running_ == 0)
+                done_cv_.notify_one();
+        }
+    }
+}
+
+std::vector<int> NumaExecutor::parse_cpulist(const std::string& cpulist)
+{
+    static const std::regex range_re(R"(^\s*(\d+)(?:-(\d+))?\s*$)");
+    std::vector<int> cpus;
+    std::stringstream ss{cpulist};
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (std::all_of(item.begin(), item.end(), ::isspace))
+            continue;
+        std::smatch m;
+        if (!std::regex_match(item, m, range_re))
+            error_die("Invalid CPU list: {}", cpulist);
+        int first = std::stoi(m[1]),
+            last = m[2].matched ? std::stoi(m[2]) : first;
+        for (int cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+std::vector<std::vector<int>> NumaExecutor::detect_nodes()
+{
+    namespace fs = std::filesystem;
+
+    std::vector<std::vector<int>> nodes;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return {};
+
+    const fs::path root{"/sys/devices/system/node"};
+    std::error_code ec;
+    if (!fs::is_directory(root, ec))
+        return {};
+    static const std::regex node_re(R"(^node(\d+)$)");
+    std::vector<std::pair<int, std::vector<int>>> found;
+    for (auto&& entry : fs::directory_iterator(root, ec)) {
+        const std::string name = entry.path().filename().string();
+        std::smatch m;
+        if (!std::regex_match(name, m, node_re))
+            continue;
+        std::ifstream ifs{entry.path() / "cpulist"};
+        std::string cpulist;
+        if (!std::getline(ifs, cpulist))
+            continue;
+        std::vector<int> cpus;
+        for (int cpu : parse_cpulist(cpulist))
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+                cpus.push_back(cpu);
+        // Skip the nodes only with memory or with no CPU available to us
+        if (!cpus.empty())
+            found.emplace_back(std::stoi(m[1]), std::move(cpus));
+    }
+    std::sort(found.begin(), found.end());
+    for (auto&& [id, cpus] : found)
+        nodes.push_back(std::move(cpus));
+#endif
+    return nodes;
+}
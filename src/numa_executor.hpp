@@ -0,0 +1,92 @@
+#ifndef HOMFA_NUMA_EXECUTOR_HPP
+#define HOMFA_NUMA_EXECUTOR_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Executor running loops on worker threads pinned to the NUMA nodes. The
+// indices of a loop are split into contiguous shards, one for each node, and
+// the shard of a node is processed only by the threads of the node. Since
+// Linux places a page on the node of the thread touching it first, the memory
+// initialized through the executor stays local to the threads using it.
+class NumaExecutor {
+public:
+    // [begin, end) of the indices processed by each node
+    using Ranges = std::vector<std::pair<size_t, size_t>>;
+    // Called with the node and the index
+    using Task = std::function<void(size_t, size_t)>;
+
+private:
+    struct Node {
+        std::vector<int> cpus;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> next;
+        size_t end;
+    };
+    std::vector<std::unique_ptr<Node>> nodes_;
+    size_t num_workers_;
+
+    // Serializes the calls of parallel_for
+    std::mutex call_mtx_;
+    std::mutex mtx_;
+    std::condition_variable start_cv_, done_cv_;
+    size_t generation_, num_running_;
+    bool stop_;
+    const Task* task_;
+
+public:
+    // Use at most max_nodes nodes. If the NUMA topology is unavailable, all
+    // the CPUs are regarded as a single node and the threads are not pinned.
+    NumaExecutor(size_t max_nodes = std::numeric_limits<size_t>::max());
+    ~NumaExecutor();
+
+    NumaExecutor(const NumaExecutor&) = delete;
+    NumaExecutor& operator=(const NumaExecutor&) = delete;
+
+    size_t num_nodes() const
+    {
+        return nodes_.size();
+    }
+
+    size_t num_workers() const
+    {
+        return num_workers_;
+    }
+
+    const std::vector<int>& cpus(size_t node) const
+    {
+        return nodes_.at(node)->cpus;
+    }
+
+    // Split [0, n) into the shards proportional to the number of the workers
+    // of each node
+    Ranges shards(size_t n) const;
+    // Given sorted indices in [0, n), returns the ranges of the positions of
+    // the indices in each shard of shards(n)
+    Ranges shards_of(const std::vector<size_t>& sorted_indices,
+                     size_t n) const;
+
+    // Call task(node, i) for each i in ranges[node] on the workers of node
+    void parallel_for(const Ranges& ranges, const Task& task);
+    // Call task(node) once on a worker of each node
+    void on_each_node(const std::function<void(size_t)>& task);
+
+    // "0-3,8-11" -> {0, 1, 2, 3, 8, 9, 10, 11}
+    static std::vector<int> parse_cpulist(const std::string& cpulist);
+    // The CPUs of each node available to this process
+    static std::vector<std::vector<int>> detect_nodes();
+
+private:
+    void work(size_t node);
+};
+
+#endif
@@ -13,6 +13,15 @@ OfflineDFARunner::OfflineDFARunner(Graph graph, size_t input_size,
 {
 }
 
+OfflineDFARunner::OfflineDFARunner(Graph graph, size_t input_size,
+                                   std::unique_ptr<BootstrappingPolicy> policy,
+                                   std::shared_ptr<EvalKey> eval_key,
+                                   bool sanitize_result)
+    : runner_(std::move(graph), std::move(policy), input_size, eval_key,
+              sanitize_result)
+{
+}
+
 TLWELvl1 OfflineDFARunner::result() const
 {
     return runner_.result();
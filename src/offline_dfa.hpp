@@ -10,6 +10,9 @@ private:
 public:
     OfflineDFARunner(Graph graph, size_t input_size, size_t boot_interval,
                      std::shared_ptr<EvalKey> eval_key, bool sanitize_result);
+    OfflineDFARunner(Graph graph, size_t input_size,
+                     std::unique_ptr<BootstrappingPolicy> policy,
+                     std::shared_ptr<EvalKey> eval_key, bool sanitize_result);
 
     const Graph& graph() const
     {
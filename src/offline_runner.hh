@@ -10,6 +10,7 @@
 
 #include <boost/iterator/zip_iterator.hpp>
 
+#include "bootstrapping_policy.hpp"
 #include "graph.hpp"
 #include "offline_dfa.hpp"
 
@@ -33,9 +34,20 @@ namespace ArithHomFA {
 
     OfflineRunner(const seal::SEALContext &context, double scale, const Graph &graph, size_t input_size,
                   size_t boot_interval, const BootstrappingKey &bkey, const std::vector<double> &references)
-        : runner(graph, input_size, boot_interval, bkey.ekey, false), predicate(context, scale), bkey(bkey),
+        : OfflineRunner(context, scale, graph, input_size, std::make_unique<IntervalBootstrappingPolicy>(boot_interval),
+                        bkey, references) {
+    }
+
+    /*!
+     * @param policy The policy to decide when and which weights of the DFA are bootstrapped
+     */
+    OfflineRunner(const seal::SEALContext &context, double scale, const Graph &graph, size_t input_size,
+                  std::unique_ptr<BootstrappingPolicy> policy, const BootstrappingKey &bkey,
+                  const std::vector<double> &references)
+        : runner(graph, input_size, std::move(policy), bkey.ekey, false), predicate(context, scale), bkey(bkey),
           converter(context), references(references) {
       converter.initializeConverter(this->bkey);
+      converter.prepareAmplifiers(this->references, scale);
     }
 
     /*!
@@ -55,22 +67,8 @@ namespace ArithHomFA {
       this->timer.predicate.toc();
 
       // Construct TRGSW
-      tlwes.resize(ckksCiphers.size());
-      trgsws.resize(ckksCiphers.size());
       this->timer.ckks_to_tfhe.tic();
-      if constexpr (mode == RunnerMode::normal) {
-        for (std::size_t i = 0; i < ckksCiphers.size(); ++i) {
-          converter.toLv1TRGSWFFT(ckksCiphers.at(i), trgsws.at(i), this->references.at(i));
-        }
-      } else if constexpr (mode == RunnerMode::fast) {
-        for (std::size_t i = 0; i < ckksCiphers.size(); ++i) {
-          converter.toLv1TRGSWFFTPoor(ckksCiphers.at(i), trgsws.at(i), this->references.at(i));
-        }
-      } else {
-        for (std::size_t i = 0; i < ckksCiphers.size(); ++i) {
-          converter.toLv1TRGSWFFTGood(ckksCiphers.at(i), trgsws.at(i));
-        }
-      }
+      this->toLv1TRGSWFFTs(converter, ckksCiphers, trgsws, this->references);
       this->timer.ckks_to_tfhe.toc();
 
       for (const auto &trgsw: std::ranges::reverse_view(trgsws)) {
@@ -82,11 +80,132 @@ namespace ArithHomFA {
       return runner.result();
     }
 
+    /*!
+     * @brief Feeds the valuations of several time steps at once
+     *
+     * The predicates are evaluated in the given order. Then, the CKKS ciphertexts of all the time steps are converted to
+     * TRGSW in parallel before the DFA evaluation. This makes the conversion, which is usually the bottleneck,
+     * scale with the number of cores.
+     *
+     * @param [in] valuations The concatenation of the valuations of the time steps. As in feed(), the time steps must be
+     * given from back to front.
+     * @returns The monitoring results after feeding each time step
+     *
+     * @pre valuations.size() is a multiple of the signal size
+     */
+    std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>> feedBatch(const std::vector<seal::Ciphertext> &valuations) {
+      this->timer.total.tic();
+      const std::size_t signalSize = ArithHomFA::CKKSPredicate::getSignalSize();
+      const std::size_t predicateSize = ArithHomFA::CKKSPredicate::getPredicateSize();
+      assert(valuations.size() % signalSize == 0);
+      const std::size_t numSteps = valuations.size() / signalSize;
+
+      // Evaluate the predicates. This must be sequential because a predicate may depend on the previous valuations.
+      std::vector<seal::Ciphertext> valuation(signalSize), results(predicateSize);
+      ckksCiphers.clear();
+      ckksCiphers.reserve(numSteps * predicateSize);
+      this->timer.predicate.tic();
+      for (std::size_t step = 0; step < numSteps; ++step) {
+        std::copy_n(valuations.begin() + step * signalSize, signalSize, valuation.begin());
+        predicate.eval(valuation, results);
+        std::copy(results.begin(), results.end(), std::back_inserter(ckksCiphers));
+      }
+      this->timer.predicate.toc();
+
+      auto monitoringResults = evalCKKSCiphers(numSteps);
+      this->timer.total.toc();
+
+      return monitoringResults;
+    }
+
+    /*!
+     * @brief Feeds the valuations of several time steps packed by CKKSPackedEncoder
+     *
+     * The predicates are evaluated once for all the time steps, and the slots of the results are extracted for each
+     * time step. The modulus chain needs one more level than in feed() for the extraction.
+     *
+     * @param [in] valuations The packed valuations, where the i-th slot of valuations.at(j) is the j-th signal at the
+     * i-th time step. The time steps in the slots are from front to back, and they are fed from the last one.
+     * @param [in] numSteps The number of the time steps in the slots
+     * @returns The monitoring results after feeding each time step, i.e., from the last slot
+     *
+     * @pre The predicate does not depend on the previous valuations
+     */
+    std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>> feedPacked(const std::vector<seal::Ciphertext> &valuations,
+                                                            std::size_t numSteps) {
+      this->timer.total.tic();
+      const std::size_t predicateSize = ArithHomFA::CKKSPredicate::getPredicateSize();
+      assert(valuations.size() == predicate.getSignalSize());
+
+      std::vector<seal::Ciphertext> results(predicateSize);
+      this->timer.predicate.tic();
+      predicate.evalPacked(valuations, results);
+      // The predicates of each time step are in the order of the time steps fed to the DFA
+      ckksCiphers.resize(numSteps * predicateSize);
+#pragma omp parallel for collapse(2) default(none) shared(numSteps, predicateSize, results, ckksCiphers, converter)
+      for (std::size_t step = 0; step < numSteps; ++step) {
+        for (std::size_t i = 0; i < predicateSize; ++i) {
+          converter.extractSlot(results.at(i), numSteps - 1 - step, ckksCiphers.at(step * predicateSize + i));
+        }
+      }
+      this->timer.predicate.toc();
+
+      auto monitoringResults = evalCKKSCiphers(numSteps);
+      this->timer.total.toc();
+
+      return monitoringResults;
+    }
+
+    /*!
+     * @brief Directly feeds the TRGSW ciphertexts of the predicates at a time step to the DFA
+     *
+     * @param ciphers The TRGSW ciphertexts in the order they are evaluated, i.e., in the reversed order of the
+     * predicates, as in feed().
+     */
+    TFHEpp::TLWE<TFHEpp::lvl1param> feedRaw(const std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>> &ciphers) {
+      this->timer.total.tic();
+      this->timer.dfa.tic();
+      for (const auto &trgsw: ciphers) {
+        runner.eval_one(trgsw);
+      }
+      auto result = runner.result();
+      this->timer.dfa.toc();
+      this->timer.total.toc();
+
+      return result;
+    }
+
     void setRelinKeys(const seal::RelinKeys &keys) {
       this->predicate.setRelinKeys(keys);
     }
 
   private:
+    /*!
+     * @brief Converts ckksCiphers, the predicates of numSteps time steps, to TRGSW and feeds them to the DFA
+     */
+    std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>> evalCKKSCiphers(std::size_t numSteps) {
+      const std::size_t predicateSize = ArithHomFA::CKKSPredicate::getPredicateSize();
+      // Construct TRGSW for all the time steps
+      this->timer.ckks_to_tfhe.tic();
+      this->toLv1TRGSWFFTs(converter, ckksCiphers, trgsws, this->references);
+      this->timer.ckks_to_tfhe.toc();
+
+      // Evaluate the DFA
+      std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>> monitoringResults;
+      monitoringResults.reserve(numSteps);
+      for (std::size_t step = 0; step < numSteps; ++step) {
+        const auto begin = trgsws.begin() + step * predicateSize;
+        this->timer.dfa.tic();
+        for (const auto &trgsw: std::ranges::reverse_view(std::ranges::subrange(begin, begin + predicateSize))) {
+          runner.eval_one(trgsw);
+        }
+        monitoringResults.push_back(runner.result());
+        this->timer.dfa.toc();
+      }
+
+      return monitoringResults;
+    }
+
     OfflineDFARunner runner;
     CKKSPredicate predicate;
     const BootstrappingKey &bkey;
@@ -94,7 +213,6 @@ namespace ArithHomFA {
     const std::vector<double> references;
     // temporary variables
     std::vector<seal::Ciphertext> ckksCiphers;
-    std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>> tlwes;
     std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>> trgsws;
   };
 } // namespace ArithHomFA
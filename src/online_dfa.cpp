@@ -77,7 +77,7 @@ void OnlineDFARunner::eval_one(const TRGSWLvl1FFT& input)
                 TRLWELvl1_add(acc1, weight_.at(p1));
                 TRLWELvl1_add(acc1, offset);
             }
-            TFHEpp::CMUXFFT<Lvl1>(out.at(st), input, acc1, acc0);
+            CMUXFFTLvl1(out.at(st), input, acc1, acc0);
         });
     {
         using std::swap;
@@ -100,15 +100,31 @@ void OnlineDFARunner::bootstrap_weight()
 OnlineDFARunner2::OnlineDFARunner2(const Graph& graph, size_t boot_interval_,
                                    bool is_spec_reversed,
                                    std::shared_ptr<EvalKey> eval_key,
-                                   bool sanitize_result)
+                                   bool sanitize_result,
+                                   std::shared_ptr<TFHEpp::TLWE2TRLWEIKSKey<
+                                       TFHEpp::lvl11param>>
+                                       iks_key)
+    : OnlineDFARunner2(
+          graph, std::make_unique<IntervalBootstrappingPolicy>(boot_interval_),
+          is_spec_reversed, std::move(eval_key), sanitize_result,
+          std::move(iks_key))
+{
+}
+
+OnlineDFARunner2::OnlineDFARunner2(
+    const Graph& graph, std::unique_ptr<BootstrappingPolicy> policy,
+    bool is_spec_reversed, std::shared_ptr<EvalKey> eval_key,
+    bool sanitize_result,
+    std::shared_ptr<TFHEpp::TLWE2TRLWEIKSKey<TFHEpp::lvl11param>> iks_key)
     : runner_(is_spec_reversed ? graph : graph.reversed().minimized(),
-              boot_interval_, std::nullopt, eval_key, sanitize_result)
+              std::move(policy), std::nullopt, std::move(eval_key),
+              sanitize_result, std::move(iks_key))
 {
 }
 
-TLWELvl1 OnlineDFARunner2::result() const
+TLWELvl1 OnlineDFARunner2::result(size_t output) const
 {
-    return runner_.result();
+    return runner_.result(output);
 }
 
 void OnlineDFARunner2::eval_one(const TRGSWLvl1FFT& input)
@@ -116,13 +132,18 @@ void OnlineDFARunner2::eval_one(const TRGSWLvl1FFT& input)
     return runner_.eval(input);
 }
 
+void OnlineDFARunner2::set_executor(std::shared_ptr<NumaExecutor> executor)
+{
+    runner_.set_executor(std::move(executor));
+}
+
 /* OnlineDFARunner3 */
 OnlineDFARunner3::OnlineDFARunner3(
     Graph graph, size_t max_second_lut_depth, size_t queue_size,
     size_t bootstrapping_freq, const EvalKey& eval_key,
     const TFHEpp::TLWE2TRLWEIKSKey<TFHEpp::lvl11param>& tlwel1_trlwel1_iks_key,
     std::optional<SecretKey> debug_skey, bool sanitize_result)
-    : graph_(std::move(graph)),
+    : graph_(graph.bfs_ordered()),
       eval_key_(eval_key),
       tlwel1_trlwel1_iks_key_(tlwel1_trlwel1_iks_key),
       weight_(graph_.size(), trivial_TRLWELvl1_zero()),
@@ -187,25 +208,24 @@ void OnlineDFARunner3::eval_one(const TRGSWLvl1FFT& input)
     eval_queued_inputs();
 }
 
-void lookup_table(std::vector<TRLWELvl1>& table,
+void lookup_table(TRLWELvl1Vector& table,
                   std::vector<TRGSWLvl1FFT>::const_iterator input_begin,
                   std::vector<TRGSWLvl1FFT>::const_iterator input_end,
-                  std::vector<TRLWELvl1>& workspace)
+                  TRLWELvl1Vector& workspace)
 {
     const size_t input_size = std::distance(input_begin, input_end);
     assert(table.size() == (1 << input_size));  // FIXME: relax this condition
     if (input_size == 0)
         return;
 
-    std::vector<TRLWELvl1>& tmp = workspace;
+    TRLWELvl1Vector& tmp = workspace;
     tmp.clear();
     tmp.resize(1 << (input_size - 1));
 
     size_t i = 0;
     for (auto it = input_begin; it != input_end; ++it, ++i) {
         tbb::parallel_for(0, 1 << (input_size - i - 1), [&](size_t j) {
-            TFHEpp::CMUXFFT<Lvl1>(tmp.at(j), *it, table.at(j * 2 + 1),
-                                  table.at(j * 2));
+            CMUXFFTLvl1(tmp.at(j), *it, table.at(j * 2 + 1), table.at(j * 2));
         });
         using std::swap;
         swap(tmp, table);
@@ -213,17 +233,17 @@ void lookup_table(std::vector<TRLWELvl1>& table,
 }
 
 void lookup_table_with_timer(
-    std::vector<TRLWELvl1>& table,
+    TRLWELvl1Vector& table,
     std::vector<TRGSWLvl1FFT>::const_iterator input_begin,
     std::vector<TRGSWLvl1FFT>::const_iterator input_end,
-    std::vector<TRLWELvl1>& workspace, TimeRecorder& timer)
+    TRLWELvl1Vector& workspace, TimeRecorder& timer)
 {
     const size_t input_size = std::distance(input_begin, input_end);
     assert(table.size() == (1 << input_size));  // FIXME: relax this condition
     if (input_size == 0)
         return;
 
-    std::vector<TRLWELvl1>& tmp = workspace;
+    TRLWELvl1Vector& tmp = workspace;
     tmp.clear();
     tmp.resize(1 << (input_size - 1));
 
@@ -232,8 +252,8 @@ void lookup_table_with_timer(
         timer.timeit(
             TimeRecorder::TARGET::CMUX, 1 << (input_size - i - 1), [&] {
                 tbb::parallel_for(0, 1 << (input_size - i - 1), [&](size_t j) {
-                    TFHEpp::CMUXFFT<Lvl1>(tmp.at(j), *it, table.at(j * 2 + 1),
-                                          table.at(j * 2));
+                    CMUXFFTLvl1(tmp.at(j), *it, table.at(j * 2 + 1),
+                                table.at(j * 2));
                 });
             });
         using std::swap;
@@ -287,7 +307,7 @@ void OnlineDFARunner3::eval_queued_inputs()
     second_lut_depth_ = second_lut_depth;
 
     // Prepare workspace avoiding malloc in eval
-    std::vector<TRLWELvl1>&table = workspace_table1_,
+    TRLWELvl1Vector&table = workspace_table1_,
     &workspace = workspace_table2_;
     table.clear();
     table.resize(1 << first_lut_depth, trivial_TRLWELvl1_zero());
@@ -302,11 +322,9 @@ void OnlineDFARunner3::eval_queued_inputs()
                 Graph::State st_to = memo.at(
                     ((input2 << first_lut_depth) | input1) * graph_.size() +
                     st_from);
-                TRLWELvl1 c;
-                TRLWELvl1_mult_X_k(
-                    c, weight_.at(st_from),
+                TRLWELvl1_add_mult_X_k(
+                    table.at(input1), weight_.at(st_from),
                     input2 * next_live_states.size() + st2idx.at(st_to));
-                TRLWELvl1_add(table.at(input1), c);
             }
         }
     });
@@ -376,7 +394,7 @@ void OnlineDFARunner3::eval_queued_inputs()
 OnlineDFARunner4::OnlineDFARunner4(Graph graph, size_t queue_size,
                                    const EvalKey& eval_key,
                                    bool sanitize_result)
-    : graph_(std::move(graph)),
+    : graph_(graph.bfs_ordered()),
       eval_key_(eval_key),
       queue_size_(queue_size),
       queued_inputs_(),
@@ -389,14 +407,15 @@ OnlineDFARunner4::OnlineDFARunner4(Graph graph, size_t queue_size,
         error_die("Sanitization of results is not implemented");
 }
 
-TLWELvl1 OnlineDFARunner4::result()
+TLWELvl1 OnlineDFARunner4::result(size_t output)
 {
     assert(!sanitize_result_);
+    assert(output < graph_.num_outputs());
 
     eval_queued_inputs();
     assert(selector_);
     TLWELvl1 ret;
-    TFHEpp::SampleExtractIndex<Lvl1>(ret, *selector_, 0);
+    TFHEpp::SampleExtractIndex<Lvl1>(ret, *selector_, output);
     return ret;
 }
 
@@ -408,6 +427,20 @@ void OnlineDFARunner4::eval_one(const TRGSWLvl1FFT& input)
     eval_queued_inputs();
 }
 
+void OnlineDFARunner4::set_executor(std::shared_ptr<NumaExecutor> executor)
+{
+    executor_ = std::move(executor);
+    // The weights are first touched in eval_queued_inputs()
+    workspace1_.clear();
+    workspace1_.shrink_to_fit();
+    workspace2_.clear();
+    workspace2_.shrink_to_fit();
+    input_replicas_.resize(executor_->num_nodes());
+    executor_->on_each_node([&](size_t node) {
+        input_replicas_.at(node) = std::make_unique<TRGSWLvl1FFT>();
+    });
+}
+
 void OnlineDFARunner4::eval_queued_inputs()
 {
     const size_t input_size = queued_inputs_.size();
@@ -449,46 +482,75 @@ void OnlineDFARunner4::eval_queued_inputs()
     for (size_t i = 0; i < next_live_states.size(); i++)
         next_live_to_index.at(next_live_states.at(i)) = i;
 
-    std::vector<TRLWELvl1>&weight = workspace1_, &out = workspace2_;
+    TRLWELvl1Vector&weight = workspace1_, &out = workspace2_;
     weight.clear();
     out.clear();
-    weight.resize(graph_.size(), trivial_TRLWELvl1_zero());
+    if (executor_) {
+        // Initialize the weights on the nodes processing them
+        weight.resize(graph_.size());
+        executor_->parallel_for(
+            executor_->shards(graph_.size()), [&](size_t, size_t q) {
+                weight.at(q) = trivial_TRLWELvl1_zero();
+            });
+    }
+    else {
+        weight.resize(graph_.size(), trivial_TRLWELvl1_zero());
+    }
     out.resize(graph_.size());
 
     const size_t next_width =
         std::floor(std::log2(next_live_states.size())) + 1;
+    const size_t num_outputs = graph_.num_outputs();
     // Initialize weights.
     // The content of a weight (TRLWE) at index i:
-    //   [0]: true iff the state is final
-    //   [1..]: index of the state (sum(2^{i-1} * w[i]))
+    //   [0..num_outputs): true iff the state is final for the output
+    //   [num_outputs..]: index of the state (sum(2^{i-num_outputs} * w[i]))
     for (Graph::State q : next_live_states) {
-        if (graph_.is_final_state(q))
-            weight.at(q)[1][0] = (1u << 31);  // 1/2
-        else
-            weight.at(q)[1][0] = 0;  // 0
+        for (size_t i = 0; i < num_outputs; i++)
+            if (graph_.is_final_state(q, i))
+                weight.at(q)[1][i] = (1u << 31);  // 1/2
+            else
+                weight.at(q)[1][i] = 0;  // 0
 
         size_t t = next_live_to_index.at(q);
         for (size_t i = 0; i < next_width; i++)
             if (((t >> i) & 1u) == 0)
-                weight.at(q)[1][i + 1] = -(1u << 29);  // -1/8
+                weight.at(q)[1][i + num_outputs] = -(1u << 29);  // -1/8
             else
-                weight.at(q)[1][i + 1] = (1u << 29);  // 1/8
+                weight.at(q)[1][i + num_outputs] = (1u << 29);  // 1/8
     }
 
     // Propagate weight from back to front
     for (int i = input_size - 1; i >= 0; i--) {
         const auto& states = live_states_at_depth.at(i);
-        timer_.timeit(TimeRecorder::TARGET::CMUX, states.size(), [&] {
-            std::for_each(std::execution::par, states.begin(), states.end(),
-                          [&](Graph::State q) {
-                              Graph::State q0 = graph_.next_state(q, false),
-                                           q1 = graph_.next_state(q, true);
-                              const auto &w0 = weight.at(q0),
-                                         &w1 = weight.at(q1);
-                              TFHEpp::CMUXFFT<Lvl1>(
-                                  out.at(q), queued_inputs_.at(i), w1, w0);
-                          });
-        });
+        const CMUXBatch batch =
+            CMUXBatch::plan(states, [&](Graph::State q) {
+                return std::make_pair(graph_.next_state(q, false),
+                                      graph_.next_state(q, true));
+            });
+        timer_.timeit(
+            TimeRecorder::TARGET::CMUX, batch.cmux_states.size(), [&] {
+                if (executor_) {
+                    // Each node reads its own replica of the input
+                    executor_->on_each_node([&](size_t node) {
+                        *input_replicas_.at(node) = queued_inputs_.at(i);
+                    });
+                    executor_->parallel_for(
+                        executor_->shards_of(batch.cmux_states,
+                                             graph_.size()),
+                        [&](size_t node, size_t j) {
+                            auto [q0, q1] = batch.cmux_children.at(j);
+                            CMUXFFTLvl1(
+                                out.at(batch.cmux_states.at(j)),
+                                *input_replicas_.at(node), weight.at(q1),
+                                weight.at(q0));
+                        });
+                    batch.copy(out, weight);
+                }
+                else {
+                    batch_CMUXFFT(out, queued_inputs_.at(i), weight, batch);
+                }
+            });
         {
             using std::swap;
             swap(out, weight);
@@ -513,7 +575,8 @@ void OnlineDFARunner4::eval_queued_inputs()
     const TRLWELvl1& sel = *selector_;
     workspace4_.resize(width);
     tbb::parallel_for(0ul, width, [&](size_t i) {
-        TFHEpp::SampleExtractIndex<Lvl1>(workspace4_.at(i), sel, i + 1);
+        TFHEpp::SampleExtractIndex<Lvl1>(workspace4_.at(i), sel,
+                                         i + num_outputs);
     });
     timer_.timeit(TimeRecorder::TARGET::CIRCUIT_BOOTSTRAPPING, width, [&] {
         tbb::parallel_for(0ul, width, [&](size_t i) {
@@ -528,7 +591,7 @@ void OnlineDFARunner4::eval_queued_inputs()
         using std::swap;
         swap(weight, out);
     }
-    weight.resize(1 << width);
+    weight.resize(1 << width, trivial_TRLWELvl1_zero());
     out.resize(1 << width);
     lookup_table_with_timer(weight, cond.begin(), cond.end(), out, timer_);
     selector_ = weight.at(0);
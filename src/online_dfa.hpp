@@ -32,7 +32,17 @@ private:
 public:
     OnlineDFARunner2(const Graph& graph, size_t boot_interval_,
                      bool is_spec_reversed, std::shared_ptr<EvalKey> eval_key,
-                     bool sanitize_result);
+                     bool sanitize_result,
+                     std::shared_ptr<
+                         TFHEpp::TLWE2TRLWEIKSKey<TFHEpp::lvl11param>>
+                         iks_key = nullptr);
+    OnlineDFARunner2(const Graph& graph,
+                     std::unique_ptr<BootstrappingPolicy> policy,
+                     bool is_spec_reversed, std::shared_ptr<EvalKey> eval_key,
+                     bool sanitize_result,
+                     std::shared_ptr<
+                         TFHEpp::TLWE2TRLWEIKSKey<TFHEpp::lvl11param>>
+                         iks_key = nullptr);
 
     const Graph& graph() const
     {
@@ -44,8 +54,9 @@ public:
         return runner_.timer();
     }
 
-    TLWELvl1 result() const;
+    TLWELvl1 result(size_t output = 0) const;
     void eval_one(const TRGSWLvl1FFT& input);
+    void set_executor(std::shared_ptr<NumaExecutor> executor);
 };
 
 class OnlineDFARunner3 {
@@ -53,7 +64,7 @@ private:
     Graph graph_;
     const EvalKey& eval_key_;
     const TFHEpp::TLWE2TRLWEIKSKey<TFHEpp::lvl11param>& tlwel1_trlwel1_iks_key_;
-    std::vector<TRLWELvl1> weight_;
+    TRLWELvl1Vector weight_;
     std::vector<TRGSWLvl1FFT> queued_inputs_;
     size_t max_second_lut_depth_, queue_size_;
     std::vector<Graph::State> live_states_;
@@ -63,7 +74,7 @@ private:
     bool sanitize_result_;
 
     // Workspace for eval_queued_inputs()
-    std::vector<TRLWELvl1> workspace_table1_, workspace_table2_;
+    TRLWELvl1Vector workspace_table1_, workspace_table2_;
 
 public:
     OnlineDFARunner3(Graph graph, size_t max_second_lut_depth,
@@ -114,8 +125,10 @@ private:
     std::optional<TRLWELvl1> selector_;
     std::vector<Graph::State> live_states_;
     bool sanitize_result_;
+    std::shared_ptr<NumaExecutor> executor_;
+    std::vector<std::unique_ptr<TRGSWLvl1FFT>> input_replicas_;
 
-    std::vector<TRLWELvl1> workspace1_, workspace2_;
+    TRLWELvl1Vector workspace1_, workspace2_;
     std::vector<TRGSWLvl1FFT> workspace3_;
     std::vector<TLWELvl1> workspace4_;
 
@@ -145,8 +158,9 @@ public:
         return timer_;
     }
 
-    TLWELvl1 result();
+    TLWELvl1 result(size_t output = 0);
     void eval_one(const TRGSWLvl1FFT& input);
+    void set_executor(std::shared_ptr<NumaExecutor> executor);
 
 private:
     void eval_queued_inputs();
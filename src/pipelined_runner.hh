@@ -0,0 +1,211 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#pragma once
+
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "bootstrapping_policy.hpp"
+#include "graph.hpp"
+
+#include "abstract_runner.hh"
+#include "bounded_queue.hh"
+#include "ckks_predicate.hh"
+#include "ckks_to_tfhe.hh"
+#include "online_dfa.hpp"
+#include "seal_config.hh"
+#include "sized_cipher_reader.hh"
+#include "tlwe_writer.hh"
+#include "tic_toc.hh"
+
+namespace ArithHomFA {
+  /*!
+   * @brief Class for online monitoring with the reverse algorithm, where the stages are pipelined
+   *
+   * The monitoring consists of the following four stages: reading the valuations, evaluating the predicates in CKKS,
+   * converting the CKKS ciphertexts to TRGSW, and evaluating the DFA. In run(), each stage runs in its own thread,
+   * and they are connected by bounded queues. Thus, for example, the conversion of the (t+1)-th valuation overlaps with
+   * the DFA evaluation of the t-th valuation, and the throughput is bounded by the slowest stage rather than the sum
+   * of the stages.
+   */
+  template<RunnerMode mode>
+  class PipelinedReverseRunner : public AbstractRunner<mode> {
+  public:
+    PipelinedReverseRunner(const seal::SEALContext &context, double scale, const std::string &spec_filename,
+                           size_t boot_interval, const BootstrappingKey &bkey, const std::vector<double> &references,
+                           std::size_t depth, bool reversed = false)
+        : PipelinedReverseRunner(context, scale, Graph::from_file(spec_filename), boot_interval, bkey, references,
+                                 depth, reversed) {
+    }
+
+    /*!
+     * @param depth The capacity of the queues between the stages
+     */
+    PipelinedReverseRunner(const seal::SEALContext &context, double scale, const Graph &graph, size_t boot_interval,
+                           const BootstrappingKey &bkey, const std::vector<double> &references, std::size_t depth,
+                           bool reversed = false)
+        : PipelinedReverseRunner(context, scale, graph, std::make_unique<IntervalBootstrappingPolicy>(boot_interval),
+                                 bkey, references, depth, reversed) {
+    }
+
+    /*!
+     * @param policy The policy to decide when and which weights of the DFA are bootstrapped
+     * @param depth The capacity of the queues between the stages
+     */
+    PipelinedReverseRunner(const seal::SEALContext &context, double scale, const Graph &graph,
+                           std::unique_ptr<BootstrappingPolicy> policy, const BootstrappingKey &bkey,
+                           const std::vector<double> &references, std::size_t depth, bool reversed = false)
+        : runner(graph, std::move(policy), reversed, bkey.ekey, false), predicate(context, scale), bkey(bkey),
+          converter(context), references(references), depth(depth) {
+      converter.initializeConverter(this->bkey);
+      converter.prepareAmplifiers(this->references, scale);
+    }
+
+    /*!
+     * @brief Feeds a valuation to the DFA with valuations without pipelining
+     */
+    TFHEpp::TLWE<TFHEpp::lvl1param> feed(const std::vector<seal::Ciphertext> &valuations) override {
+      this->timer.total.tic();
+      std::vector<seal::Ciphertext> ckksCiphers;
+      std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>> trgsws;
+      evalPredicate(valuations, ckksCiphers);
+      convert(ckksCiphers, trgsws);
+      auto result = evalDFA(trgsws);
+      this->timer.total.toc();
+
+      return result;
+    }
+
+    /*!
+     * @brief Monitors all the valuations in the reader and writes the results to the writer with pipelining
+     *
+     * If a stage throws an exception, the other stages are stopped, and the exception is rethrown.
+     */
+    void run(const seal::SEALContext &context, SizedCipherReader &reader, TLWEWriter<TFHEpp::lvl1param> &writer) {
+      BoundedQueue<std::vector<seal::Ciphertext>> valuationQueue{depth}, predicateQueue{depth};
+      BoundedQueue<std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>>> trgswQueue{depth};
+      std::exception_ptr error;
+      std::mutex errorMutex;
+      auto abort = [&](std::exception_ptr e) {
+        {
+          std::lock_guard lock(errorMutex);
+          if (!error) {
+            error = std::move(e);
+          }
+        }
+        valuationQueue.close();
+        predicateQueue.close();
+        trgswQueue.close();
+      };
+
+      this->timer.total.tic();
+      std::thread readerThread([&] {
+        try {
+          const std::size_t signalSize = CKKSPredicate::getSignalSize();
+          while (true) {
+            std::vector<seal::Ciphertext> valuations(signalSize);
+            for (auto &valuation: valuations) {
+              if (!reader.read(context, valuation)) {
+                valuationQueue.close();
+                return;
+              }
+            }
+            if (!valuationQueue.push(std::move(valuations))) {
+              return;
+            }
+          }
+        } catch (...) {
+          abort(std::current_exception());
+        }
+      });
+      std::thread predicateThread([&] {
+        try {
+          while (auto valuations = valuationQueue.pop()) {
+            std::vector<seal::Ciphertext> ckksCiphers;
+            evalPredicate(*valuations, ckksCiphers);
+            if (!predicateQueue.push(std::move(ckksCiphers))) {
+              return;
+            }
+          }
+          predicateQueue.close();
+        } catch (...) {
+          abort(std::current_exception());
+        }
+      });
+      std::thread converterThread([&] {
+        try {
+          while (auto ckksCiphers = predicateQueue.pop()) {
+            std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>> trgsws;
+            convert(*ckksCiphers, trgsws);
+            if (!trgswQueue.push(std::move(trgsws))) {
+              return;
+            }
+          }
+          trgswQueue.close();
+        } catch (...) {
+          abort(std::current_exception());
+        }
+      });
+      // The DFA stage runs in the current thread
+      try {
+        while (auto trgsws = trgswQueue.pop()) {
+          writer.write(evalDFA(*trgsws));
+          // The result of each step is sent to the client immediately
+          writer.flush();
+        }
+      } catch (...) {
+        abort(std::current_exception());
+      }
+      readerThread.join();
+      predicateThread.join();
+      converterThread.join();
+      this->timer.total.toc();
+
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+
+    void setRelinKeys(const seal::RelinKeys &keys) {
+      this->predicate.setRelinKeys(keys);
+    }
+
+  private:
+    OnlineDFARunner2 runner;
+    CKKSPredicate predicate;
+    const BootstrappingKey &bkey;
+    CKKSToTFHE converter;
+    const std::vector<double> references;
+    const std::size_t depth;
+
+    void evalPredicate(const std::vector<seal::Ciphertext> &valuations, std::vector<seal::Ciphertext> &ckksCiphers) {
+      assert(valuations.size() == predicate.getSignalSize());
+      ckksCiphers.resize(CKKSPredicate::getPredicateSize());
+      this->timer.predicate.tic();
+      predicate.eval(valuations, ckksCiphers);
+      this->timer.predicate.toc();
+    }
+
+    void convert(const std::vector<seal::Ciphertext> &ckksCiphers,
+                 std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>> &trgsws) {
+      this->timer.ckks_to_tfhe.tic();
+      this->toLv1TRGSWFFTs(converter, ckksCiphers, trgsws, this->references);
+      this->timer.ckks_to_tfhe.toc();
+    }
+
+    TFHEpp::TLWE<TFHEpp::lvl1param> evalDFA(const std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>> &trgsws) {
+      this->timer.dfa.tic();
+      for (const auto &trgsw: trgsws) {
+        runner.eval_one(trgsw);
+      }
+      auto result = runner.result();
+      this->timer.dfa.toc();
+
+      return result;
+    }
+  };
+} // namespace ArithHomFA
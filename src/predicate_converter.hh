@@ -0,0 +1,78 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <seal/seal.h>
+
+#include "tfhepp_util.hpp"
+
+#include "abstract_runner.hh"
+#include "bootstrapping_key.hh"
+#include "ckks_predicate.hh"
+#include "ckks_to_tfhe.hh"
+#include "tic_toc.hh"
+
+namespace ArithHomFA {
+  /*!
+   * @brief Class to evaluate the predicates and convert them to TRGSW without monitoring
+   *
+   * The resulting TRGSW ciphertexts can be saved with TRGSWLvl1FFTSerializer and monitored later, possibly against
+   * many specifications, with the feedRaw functions of the runners.
+   */
+  template<RunnerMode mode>
+  class PredicateConverter {
+  public:
+    PredicateConverter(const seal::SEALContext &context, double scale, const BootstrappingKey &bkey,
+                       const std::vector<double> &references)
+        : predicate(context, scale), bkey(bkey), converter(context), references(references) {
+      converter.initializeConverter(this->bkey);
+      converter.prepareAmplifiers(this->references, scale);
+    }
+
+    /*!
+     * @brief Evaluates the predicates for a valuation and converts them to TRGSW
+     *
+     * @param [in] valuations The valuation of the signal at a time step
+     * @param [out] trgsws The TRGSW ciphertexts of the predicates in the order of the predicates
+     */
+    void convert(const std::vector<seal::Ciphertext> &valuations,
+                 std::vector<TFHEpp::TRGSWFFT<TFHEpp::lvl1param>> &trgsws) {
+      timer.total.tic();
+      assert(valuations.size() == predicate.getSignalSize());
+      ckksCiphers.resize(CKKSPredicate::getPredicateSize());
+      timer.predicate.tic();
+      predicate.eval(valuations, ckksCiphers);
+      timer.predicate.toc();
+
+      timer.ckks_to_tfhe.tic();
+      AbstractRunner<mode>::toLv1TRGSWFFTs(converter, ckksCiphers, trgsws, references);
+      timer.ckks_to_tfhe.toc();
+      timer.total.toc();
+    }
+
+    void setRelinKeys(const seal::RelinKeys &keys) {
+      this->predicate.setRelinKeys(keys);
+    }
+
+    /*!
+     * @brief Prints the time consumed by different stages of computations.
+     */
+    void printTime() const {
+      timer.print();
+    }
+
+  private:
+    CKKSPredicate predicate;
+    const BootstrappingKey &bkey;
+    CKKSToTFHE converter;
+    const std::vector<double> references;
+    TicTocForRunner timer;
+    // temporary variables
+    std::vector<seal::Ciphertext> ckksCiphers;
+  };
+} // namespace ArithHomFA
@@ -0,0 +1,168 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <ThreadPool.h>
+
+#include "tfhe++.hpp"
+
+#include "sized_tlwe_writer.hh"
+#include "tlwe_writer.hh"
+
+namespace ArithHomFA {
+  /*!
+   * @brief The header of the raw format of TLWE ciphertexts
+   *
+   * The stream starts with this header, followed by the raw little-endian images of the ciphertexts without any
+   * delimiter, since all the ciphertexts of a parameter have the same size. The parameter is recorded so that a
+   * ciphertext is not decrypted with a binary built with another parameter.
+   *
+   * @note The first four bytes of the magic are too large as the size of a record in the format of SizedTLWEWriter,
+   * which is how TLWEReader detects the format.
+   */
+  struct RawTLWEHeader {
+    static constexpr std::array<char, 8> expectedMagic = {'A', 'H', 'F', 'A', 'T', 'L', 'W', 'E'};
+    static constexpr uint32_t currentVersion = 1;
+
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t headerSize;
+    //! The parameter of the ciphertexts
+    uint32_t k, n, elementSize;
+    //! Padding for the alignment of alpha, which is always zero
+    uint32_t reserved;
+    double alpha;
+
+    template <class Param> static RawTLWEHeader make() {
+      return {expectedMagic, currentVersion, sizeof(RawTLWEHeader), Param::k, Param::n,
+              sizeof(typename Param::T), 0, Param::α};
+    }
+
+    /*!
+     * @brief Throws if the header is not of the current version or not for the given parameter
+     */
+    template <class Param> void validate() const {
+      if (magic != expectedMagic || headerSize != sizeof(RawTLWEHeader)) {
+        throw std::runtime_error("The TLWE ciphertexts are not in the raw format");
+      }
+      if (version != currentVersion) {
+        throw std::runtime_error("Unsupported version of the raw TLWE format: " + std::to_string(version));
+      }
+      const auto expected = make<Param>();
+      if (k != expected.k || n != expected.n || elementSize != expected.elementSize || alpha != expected.alpha) {
+        throw std::runtime_error("The TLWE ciphertexts are encrypted with another parameter");
+      }
+    }
+  };
+
+  /*!
+   * @brief Write TLWE ciphertexts in the raw format
+   *
+   * The ciphertexts are buffered and written in batches by a background thread, so that the monitoring does not wait
+   * for the output. A result may be written only after batchSize results unless flush() is called, which online
+   * monitoring does after each step.
+   */
+  template <class Param> class RawTLWEWriter : public TLWEWriter<Param> {
+  public:
+    /*!
+     * @param stream The stream to write. It must not be used until this writer is destructed or flushed.
+     * @param batchSize The number of the ciphertexts written at once
+     */
+    explicit RawTLWEWriter(std::ostream &stream, std::size_t batchSize = 256)
+        : ostream(stream), batchSize(std::max<std::size_t>(batchSize, 1)), pool(1) {
+      if constexpr (std::endian::native != std::endian::little) {
+        throw std::runtime_error("The raw TLWE format is supported only on little-endian machines");
+      }
+      const auto header = RawTLWEHeader::make<Param>();
+      ostream.write(reinterpret_cast<const char *>(&header), sizeof(RawTLWEHeader));
+      if (!ostream.good()) {
+        throw std::runtime_error("Failed to write the header of the TLWE ciphertexts");
+      }
+      batch.reserve(this->batchSize);
+    }
+
+    ~RawTLWEWriter() override {
+      try {
+        flush();
+      } catch (...) {
+        // A destructor must not throw. Call flush() explicitly to handle the error.
+      }
+    }
+
+    void write(const TFHEpp::TLWE<Param> &cipher) override {
+      batch.push_back(cipher);
+      if (batch.size() >= batchSize) {
+        startWriting();
+      }
+    }
+
+    /*!
+     * @brief Write all the buffered ciphertexts and wait for it
+     */
+    void flush() override {
+      startWriting();
+      if (writing.valid()) {
+        writing.get();
+      }
+      ostream.flush();
+      if (!ostream.good()) {
+        throw std::runtime_error("Failed to write the TLWE ciphertexts");
+      }
+    }
+
+  private:
+    std::ostream &ostream;
+    const std::size_t batchSize;
+    //! The ciphertexts not given to the background thread
+    std::vector<TFHEpp::TLWE<Param>> batch;
+    //! The ciphertexts written by the background thread
+    std::vector<TFHEpp::TLWE<Param>> written;
+    std::future<void> writing;
+    // The pool must be destructed first because the background thread uses the other members
+    ThreadPool pool;
+
+    void startWriting() {
+      if (batch.empty()) {
+        return;
+      }
+      // Wait for the previous batch, whose buffer is reused
+      if (writing.valid()) {
+        writing.get();
+      }
+      std::swap(batch, written);
+      batch.clear();
+      writing = pool.enqueue([this] {
+        // TLWE is an array of integers, so the vector is already in the raw format
+        ostream.write(reinterpret_cast<const char *>(written.data()),
+                      static_cast<std::streamsize>(written.size() * sizeof(TFHEpp::TLWE<Param>)));
+        if (!ostream.good()) {
+          throw std::runtime_error("Failed to write the TLWE ciphertexts");
+        }
+      });
+    }
+  };
+
+  /*!
+   * @brief Make the writer in the raw format if raw is true, and otherwise in the format of SizedTLWEWriter
+   */
+  template <class Param> std::unique_ptr<TLWEWriter<Param>> makeTLWEWriter(std::ostream &stream, bool raw) {
+    if (raw) {
+      return std::make_unique<RawTLWEWriter<Param>>(stream);
+    }
+    return std::make_unique<SizedTLWEWriter<Param>>(stream);
+  }
+} // namespace ArithHomFA
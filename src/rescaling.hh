@@ -5,15 +5,22 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <vector>
 
 #include <seal/seal.h>
 
+#include "cpu_dispatch.hpp"
+
 namespace ArithHomFA {
   /*!
    * @brief Rescale a coefficient in an arbitrary modulus to 64bit
    *
-   * In this class, we use bigint
+   * The quotient floor(|c| * 2^64 / Q) is estimated from the top 64 bits of |c| and a precomputed fixed-point
+   * reciprocal of the decryption modulus Q, and then corrected with the exact remainder. This gives the same result as
+   * the bigint division in rescaleBigint with a few 64x64->128bit multiplications.
    */
   class Rescaling {
   public:
@@ -25,6 +32,21 @@ namespace ArithHomFA {
       quotient = seal::util::allocate_uint(original_modulus_size + 1, seal::MemoryManager::GetPool());
       decryption_modulus = seal::util::allocate_zero_uint(original_modulus_size + 1, seal::MemoryManager::GetPool());
       seal::util::set_uint(context_data.total_coeff_modulus(), original_modulus_size, decryption_modulus.get());
+
+      // reciprocal = floor(2^(t + 64) / Q) - 2^64, where t is the bit length of Q. Since Q is odd and 2^(t-1) < Q <
+      // 2^t, floor(2^(t + 64) / Q) is in (2^64, 2^65).
+      modulus_bit_count = context_data.total_coeff_modulus_bit_count();
+      const std::size_t size = std::max(original_modulus_size, (modulus_bit_count + 64) / 64 + 1);
+      auto pool = seal::MemoryManager::GetPool();
+      auto power = seal::util::allocate_zero_uint(size, pool);
+      seal::util::set_bit_uint(power.get(), size, modulus_bit_count + 64);
+      auto modulus = seal::util::allocate_zero_uint(size, pool);
+      seal::util::set_uint(context_data.total_coeff_modulus(), original_modulus_size, modulus.get());
+      auto reciprocalWords = seal::util::allocate_uint(size, pool);
+      auto remainder = seal::util::allocate_uint(size, pool);
+      seal::util::divide_uint(power.get(), modulus.get(), size, reciprocalWords.get(), remainder.get(), pool);
+      assert(reciprocalWords[1] == 1);
+      reciprocal = reciprocalWords[0];
     }
 
     /*!
@@ -34,7 +56,77 @@ namespace ArithHomFA {
      *
      * @pre coefficient is in the modulus specified in the constructor
      */
-    std::uint64_t rescale(const std::uint64_t *const coefficient) const {
+    HOMFA_MULTIVERSION std::uint64_t rescale(const std::uint64_t *const coefficient) const {
+      const std::size_t size = original_modulus_size;
+      // 0. Assert the precondition
+      assert(seal::util::is_less_than_uint(coefficient, decryption_modulus.get(), size));
+
+      // 1. Take the absolute value x, which is at most Q / 2
+      const bool isNegative = seal::util::is_greater_than_or_equal_uint(coefficient, upper_half_threshold, size);
+      std::array<std::uint64_t, SEAL_COEFF_MOD_COUNT_MAX + 1> x, product;
+      if (isNegative) {
+        seal::util::sub_uint(decryption_modulus.get(), coefficient, size, x.data());
+      } else {
+        seal::util::set_uint(coefficient, size, x.data());
+      }
+
+      // 2. Estimate the quotient by the top 64 bits of x, i.e., floor(x / 2^(t - 64)). The estimate is at most 3
+      // smaller than the quotient.
+      std::uint64_t top;
+      if (modulus_bit_count <= 64) {
+        top = x[0] << (64 - modulus_bit_count);
+      } else {
+        const std::size_t shift = modulus_bit_count - 64, word = shift / 64, bit = shift % 64;
+        top = x[word] >> bit;
+        if (bit != 0 && word + 1 < size) {
+          top |= x[word + 1] << (64 - bit);
+        }
+      }
+      std::uint64_t result = top + static_cast<std::uint64_t>((static_cast<unsigned __int128>(top) * reciprocal) >> 64);
+
+      // 3. Correct the estimate with the remainder x * 2^64 - result * Q
+      seal::util::multiply_uint(decryption_modulus.get(), size, result, size + 1, product.data());
+      const unsigned char borrow = seal::util::sub_uint64(std::uint64_t{0}, product[0], product.data());
+      seal::util::sub_uint(x.data(), size, product.data() + 1, size, borrow, size, product.data() + 1);
+      while (seal::util::is_greater_than_or_equal_uint(product.data(), decryption_modulus.get(), size + 1)) {
+        seal::util::sub_uint(product.data(), decryption_modulus.get(), size + 1, product.data());
+        ++result;
+      }
+
+      // 4. Put the sign back
+      result = isNegative ? -result : result;
+      assert(isNegative == (result >> 63));
+
+      return result;
+    }
+
+    /*!
+     * @brief Rescale the coefficients of a polynomial
+     *
+     * @param coefficients The coefficients in SEAL's bigint representation, i.e., count coefficients each of which
+     * has the size of the modulus
+     * @param count The number of the coefficients
+     * @param result The rescaled coefficients
+     * @param negate If true, the rescaled coefficients are negated
+     */
+    HOMFA_MULTIVERSION void rescale(const std::uint64_t *coefficients, std::size_t count, std::uint64_t *result,
+                                    bool negate = false) const {
+      for (std::size_t i = 0; i < count; ++i) {
+        const std::uint64_t value = rescale(coefficients + i * original_modulus_size);
+        result[i] = negate ? -value : value;
+      }
+    }
+
+    /*!
+     * @brief Rescale a coefficient by bigint division
+     *
+     * This is slow but kept as the reference of rescale.
+     *
+     * @param coefficient Pointer corresponding to the coefficient in SEAL's bigint representation
+     *
+     * @pre coefficient is in the modulus specified in the constructor
+     */
+    std::uint64_t rescaleBigint(const std::uint64_t *const coefficient) const {
       // 0. Assert the precondition
       assert(seal::util::is_less_than_uint(coefficient, decryption_modulus.get(), original_modulus_size));
 
@@ -42,7 +134,9 @@ namespace ArithHomFA {
       bool isNegative =
           seal::util::is_greater_than_or_equal_uint(coefficient, upper_half_threshold, original_modulus_size);
 
-      // 2. Take the absolute value and multiply 2^64 (left shift of 64bits)
+      // 2. Take the absolute value and multiply 2^64 (left shift of 64bits). The lowest word must be cleared since the
+      // division of the previous call leaves the remainder there.
+      numerator[0] = 0;
       if (isNegative) {
         seal::util::sub_uint(decryption_modulus.get(), coefficient, original_modulus_size, numerator.get() + 1);
       } else {
@@ -72,5 +166,110 @@ namespace ArithHomFA {
     seal::util::Pointer<std::uint64_t> quotient;
     std::size_t original_modulus_size;
     const std::uint64_t *upper_half_threshold;
+    //! @brief The bit length of the decryption modulus
+    std::size_t modulus_bit_count;
+    //! @brief The lower 64 bits of floor(2^(modulus_bit_count + 64) / decryption_modulus)
+    std::uint64_t reciprocal;
+  };
+
+  /*!
+   * @brief Rescale the coefficients in the RNS representation to 64bit without CRT composition
+   *
+   * For a coefficient x in [0, Q) given by its residues c_i modulo the primes q_i, x / Q is the fractional part of
+   * sum_i y_i / q_i, where y_i = c_i * (Q / q_i)^-1 mod q_i. We compute it in 192-bit fixed point, i.e., S = sum_i y_i
+   * * floor(2^192 / q_i) mod 2^192, which is below 2^192 * x / Q by less than sum_i q_i. The upper 64 bits of S give
+   * the rescaled value unless the lower 128 bits are so close to the carry that the error may change them, in which
+   * case, which is rare, the coefficient is composed and rescaled by Rescaling. Thus, the result is the same as
+   * composing the polynomial and rescaling it by Rescaling.
+   */
+  class RNSRescaling {
+  public:
+    explicit RNSRescaling(const seal::SEALContext::ContextData &context_data)
+        : base(*context_data.rns_tool()->base_q()), rescaling(context_data), error_bound(0) {
+      auto pool = seal::MemoryManager::GetPool();
+      for (std::size_t i = 0; i < base.size(); ++i) {
+        // weight = floor(2^192 / q_i)
+        std::array<std::uint64_t, 4> power{0, 0, 0, 1}, modulus{base[i].value(), 0, 0, 0}, weight, remainder;
+        seal::util::divide_uint(power.data(), modulus.data(), power.size(), weight.data(), remainder.data(), pool);
+        assert(weight[3] == 0);
+        weights.push_back({weight[0], weight[1], weight[2]});
+        error_bound += base[i].value();
+      }
+    }
+
+    /*!
+     * @brief Rescale the coefficients of a polynomial
+     *
+     * @param coefficients The coefficients in the RNS representation, i.e., the residues modulo the i-th prime are at
+     * coefficients + i * count
+     * @param count The number of the coefficients
+     * @param result The rescaled coefficients
+     * @param negate If true, the rescaled coefficients are negated
+     */
+    HOMFA_MULTIVERSION void rescale(const std::uint64_t *coefficients, std::size_t count, std::uint64_t *result,
+                                    bool negate = false) const {
+      if (base.size() == 1) {
+        // The RNS representation is already the bigint representation
+        rescaling.rescale(coefficients, count, result, negate);
+        return;
+      }
+      for (std::size_t j = 0; j < count; ++j) {
+        const std::uint64_t value = rescale(coefficients + j, count);
+        result[j] = negate ? -value : value;
+      }
+    }
+
+    /*!
+     * @brief Rescale a coefficient
+     *
+     * @param coefficient The coefficient in the RNS representation, i.e., the residue modulo the i-th prime is at
+     * coefficient + i * stride
+     * @param stride The distance between the residues
+     */
+    std::uint64_t rescale(const std::uint64_t *coefficient, std::size_t stride) const {
+      if (base.size() == 1) {
+        return rescaling.rescale(coefficient);
+      }
+      const auto *inv_punctured_prod = base.inv_punctured_prod_mod_base_array();
+      // S = high * 2^128 + low
+      unsigned __int128 low = 0;
+      std::uint64_t high = 0;
+      for (std::size_t i = 0; i < base.size(); ++i) {
+        const std::uint64_t y = seal::util::multiply_uint_mod(coefficient[i * stride], inv_punctured_prod[i], base[i]);
+        const auto &weight = weights[i];
+        const unsigned __int128 product0 = static_cast<unsigned __int128>(y) * weight[0],
+                                product1 = static_cast<unsigned __int128>(y) * weight[1];
+        const unsigned __int128 shifted1 = product1 << 64;
+        low += product0;
+        std::uint64_t carry = low < product0;
+        low += shifted1;
+        carry += low < shifted1;
+        high += y * weight[2] + static_cast<std::uint64_t>(product1 >> 64) + carry;
+      }
+
+      // S must be at most 2^128 - error_bound modulo 2^128 for the upper 64 bits to be exact
+      if (low <= -error_bound) {
+        // floor(2^64 * x / Q) for a positive coefficient and ceil(2^64 * x / Q) for a negative one, as Rescaling
+        return (high >> 63) ? high + 1 : high;
+      }
+      return rescaleComposed(coefficient, stride);
+    }
+
+  private:
+    std::uint64_t rescaleComposed(const std::uint64_t *coefficient, std::size_t stride) const {
+      std::array<std::uint64_t, SEAL_COEFF_MOD_COUNT_MAX> value;
+      for (std::size_t i = 0; i < base.size(); ++i) {
+        value[i] = coefficient[i * stride];
+      }
+      base.compose(value.data(), seal::MemoryManager::GetPool());
+      return rescaling.rescale(value.data());
+    }
+
+    const seal::util::RNSBase &base;
+    const Rescaling rescaling;
+    //! @brief floor(2^192 / q_i) for each prime q_i, in the little endian words
+    std::vector<std::array<std::uint64_t, 3>> weights;
+    //! @brief sum_i q_i, which bounds the error of the fixed point
+    unsigned __int128 error_bound;
   };
-} // namespace ArithHomFA
\ No newline at end of file
+} // namespace ArithHomFA
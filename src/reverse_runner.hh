@@ -11,6 +11,7 @@
 
 #include <boost/iterator/zip_iterator.hpp>
 
+#include "bootstrapping_policy.hpp"
 #include "graph.hpp"
 #include "offline_dfa.hpp"
 
@@ -36,9 +37,20 @@ namespace ArithHomFA {
 
     ReverseRunner(const seal::SEALContext &context, double scale, const Graph &graph, size_t boot_interval,
                   const BootstrappingKey &bkey, const std::vector<double> &references, bool reversed = false)
-        : runner(graph, boot_interval, reversed, bkey.ekey, false), predicate(context, scale), bkey(bkey),
+        : ReverseRunner(context, scale, graph, std::make_unique<IntervalBootstrappingPolicy>(boot_interval), bkey,
+                        references, reversed) {
+    }
+
+    /*!
+     * @param policy The policy to decide when and which weights of the DFA are bootstrapped
+     */
+    ReverseRunner(const seal::SEALContext &context, double scale, const Graph &graph,
+                  std::unique_ptr<BootstrappingPolicy> policy, const BootstrappingKey &bkey,
+                  const std::vector<double> &references, bool reversed = false)
+        : runner(graph, std::move(policy), reversed, bkey.ekey, false), predicate(context, scale), bkey(bkey),
           converter(context), references(references) {
       converter.initializeConverter(this->bkey);
+      converter.prepareAmplifiers(this->references, scale);
     }
 
     /*!
@@ -106,6 +118,13 @@ namespace ArithHomFA {
       this->predicate.setRelinKeys(keys);
     }
 
+    /*!
+     * @brief Runs the DFA evaluation on the workers pinned to the NUMA nodes
+     */
+    void setExecutor(std::shared_ptr<NumaExecutor> executor) {
+      runner.set_executor(std::move(executor));
+    }
+
   private:
     OnlineDFARunner2 runner;
     CKKSPredicate predicate;
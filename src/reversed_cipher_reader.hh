@@ -0,0 +1,136 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <ThreadPool.h>
+#include <seal/seal.h>
+
+namespace ArithHomFA {
+  /*!
+   * @brief Read the ciphertexts with their sizes from a file in the reversed order
+   *
+   * The file is in the format written by SizedCipherWriter. At construction, only the length prefixes are scanned to
+   * index the offsets of the records. Then, the ciphertexts are read backwards in chunks, and the next chunk is read
+   * in background while the current chunk is consumed. Therefore, at most two chunks of ciphertexts are kept in memory
+   * regardless of the length of the file.
+   */
+  class ReversedSizedCipherReader {
+  public:
+    /*!
+     * @param filename The file to read
+     * @param context The SEAL context of the ciphertexts
+     * @param chunkSize The number of the ciphertexts read at once
+     */
+    ReversedSizedCipherReader(const std::string &filename, const seal::SEALContext &context, std::size_t chunkSize)
+        : ifs(filename, std::ios::binary), context(context), chunkSize(std::max<std::size_t>(chunkSize, 1)), pool(1) {
+      if (!ifs) {
+        throw std::runtime_error("Failed to open the input file: " + filename);
+      }
+      ifs.seekg(0, std::ios_base::end);
+      const auto fileSize = static_cast<uint64_t>(ifs.tellg());
+      ifs.seekg(0, std::ios_base::beg);
+      // Index the offsets of the records. As SizedCipherReader, the incomplete record at the end is ignored. Since
+      // seekg past the end of the file does not fail, the end of each record is compared with the size of the file.
+      while (true) {
+        uint32_t length;
+        ifs.read(reinterpret_cast<char *>(&length), sizeof(uint32_t));
+        if (!ifs.good()) {
+          break;
+        }
+        const auto offset = static_cast<uint64_t>(ifs.tellg());
+        if (offset + length > fileSize) {
+          break;
+        }
+        ifs.seekg(length, std::ios_base::cur);
+        if (!ifs.good()) {
+          break;
+        }
+        offsets.push_back(offset);
+        lengths.push_back(length);
+      }
+      ifs.clear();
+      remaining = offsets.size();
+      unloaded = offsets.size();
+      startLoadingNext();
+    }
+
+    /*!
+     * @brief The number of the ciphertexts not read yet
+     */
+    [[nodiscard]] std::size_t size() const {
+      return remaining;
+    }
+
+    /*!
+     * @brief Reads the last ciphertext not read yet
+     *
+     * @returns false if all the ciphertexts are already read
+     */
+    bool read(seal::Ciphertext &cipher) {
+      if (remaining == 0) {
+        return false;
+      }
+      if (current.empty()) {
+        current = loading.get();
+        startLoadingNext();
+      }
+      cipher = std::move(current.back());
+      current.pop_back();
+      --remaining;
+
+      return true;
+    }
+
+  private:
+    std::ifstream ifs;
+    const seal::SEALContext &context;
+    const std::size_t chunkSize;
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> lengths;
+    //! The number of the ciphertexts not read by read()
+    std::size_t remaining;
+    //! The number of the ciphertexts not loaded from the file
+    std::size_t unloaded;
+    //! The loaded ciphertexts in the original order, i.e., the next ciphertext to read is at the back
+    std::vector<seal::Ciphertext> current;
+    ThreadPool pool;
+    std::future<std::vector<seal::Ciphertext>> loading;
+
+    void startLoadingNext() {
+      if (unloaded == 0) {
+        return;
+      }
+      const std::size_t end = unloaded;
+      const std::size_t begin = end > chunkSize ? end - chunkSize : 0;
+      unloaded = begin;
+      loading = pool.enqueue([this, begin, end] {
+        // The records in the chunk are contiguous, so we read them at once
+        const uint64_t chunkBegin = offsets.at(begin);
+        const uint64_t chunkEnd = offsets.at(end - 1) + lengths.at(end - 1);
+        std::vector<char> buffer(chunkEnd - chunkBegin);
+        ifs.seekg(static_cast<std::streamoff>(chunkBegin));
+        ifs.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (!ifs.good()) {
+          throw std::runtime_error("Failed to read the ciphertexts");
+        }
+        std::vector<seal::Ciphertext> ciphers(end - begin);
+        for (std::size_t i = begin; i < end; ++i) {
+          const auto *data = reinterpret_cast<const seal::seal_byte *>(buffer.data() + (offsets.at(i) - chunkBegin));
+          ciphers.at(i - begin).load(context, data, lengths.at(i));
+        }
+        return ciphers;
+      });
+    }
+  };
+} // namespace ArithHomFA
@@ -5,12 +5,16 @@
 
 #pragma once
 #include <ostream>
+#include <stdexcept>
+#include <type_traits>
 
 #include "seal/seal.h"
 
 namespace ArithHomFA {
     /*!
      * @brief Read a cipher text with its size from istream
+     *
+     * The cipher text may be seeded or at any level of the modulus chain, as written by ahomfa_util ckks enc --compact.
      */
     class SizedCipherReader {
         std::vector<seal::seal_byte> midArray;
@@ -40,5 +44,29 @@ namespace ArithHomFA {
 
             return true;
         }
+
+        /*!
+         * @brief Read a header written by SizedCipherWriter::writeHeader
+         *
+         * @returns false if there is no more record
+         */
+        template<class Header>
+        bool readHeader(Header &header) {
+            static_assert(std::is_trivially_copyable_v<Header>);
+            if (!istream.good()) {
+                return false;
+            }
+            uint32_t length;
+            istream.read(reinterpret_cast<char *>(&length), sizeof(uint32_t));
+            if (!istream.good()) {
+                return false;
+            }
+            if (length != sizeof(Header)) {
+                throw std::runtime_error("Unexpected record in place of a header");
+            }
+            istream.read(reinterpret_cast<char *>(&header), sizeof(Header));
+
+            return istream.good();
+        }
     };
 }
\ No newline at end of file
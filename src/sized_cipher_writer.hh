@@ -5,6 +5,8 @@
 
 #pragma once
 #include <ostream>
+#include <type_traits>
+#include <vector>
 
 #include "seal/seal.h"
 
@@ -13,17 +15,43 @@ namespace ArithHomFA {
      * @brief Write a cipher text with its size to ostream
      */
     class SizedCipherWriter {
-        std::stringstream midStream;
+        std::vector<seal::seal_byte> midArray;
         std::ostream &ostream;
+
+        template<class Cipher>
+        void writeInternal(const Cipher &cipher) {
+            // Serialize to the reused buffer, whose size is an upper bound of the actual size
+            midArray.resize(cipher.save_size());
+            const auto length = static_cast<uint32_t>(cipher.save(midArray.data(), midArray.size()));
+            ostream.write(reinterpret_cast<const char *>(&length), sizeof(uint32_t));
+            ostream.write(reinterpret_cast<const char *>(midArray.data()), length);
+        }
     public:
         explicit SizedCipherWriter(std::ostream &stream) : ostream(stream) {}
 
         void write(const seal::Ciphertext &cipher) {
-            midStream.str(std::string());
-            cipher.save(midStream);
-            uint32_t length = midStream.str().size();
-            ostream.write(reinterpret_cast<char *>(&length), sizeof(uint32_t));
-            ostream.write(midStream.str().c_str(), length);
+            writeInternal(cipher);
+        }
+
+        /*!
+         * @brief Write a seeded cipher text returned by seal::Encryptor::encrypt_symmetric
+         *
+         * The second polynomial is replaced with the seed to generate it, which almost halves the size. It is expanded
+         * by seal::Ciphertext::load, so SizedCipherReader reads it as usual.
+         */
+        void write(const seal::Serializable<seal::Ciphertext> &cipher) {
+            writeInternal(cipher);
+        }
+
+        /*!
+         * @brief Write the raw image of a header, e.g., PackedBatchHeader, as a record
+         */
+        template<class Header>
+        void writeHeader(const Header &header) {
+            static_assert(std::is_trivially_copyable_v<Header>);
+            const auto length = static_cast<uint32_t>(sizeof(Header));
+            ostream.write(reinterpret_cast<const char *>(&length), sizeof(uint32_t));
+            ostream.write(reinterpret_cast<const char *>(&header), sizeof(Header));
         }
     };
 }
\ No newline at end of file
@@ -33,6 +33,14 @@ namespace ArithHomFA {
       if (!istream.good()) {
         return false;
       }
+
+      return readBody(length, cipher);
+    }
+
+    /*!
+     * @brief Read the ciphertext after its size is already read, e.g., by TLWEReader to detect the format
+     */
+    bool readBody(uint32_t length, TFHEpp::TLWE<Param> &cipher) {
       midArray.resize(length);
       istream.read(midArray.data(), length);
       if (!istream.good()) {
@@ -10,18 +10,20 @@
 
 #include "archive.hpp"
 
+#include "tlwe_writer.hh"
+
 namespace ArithHomFA {
   /*!
    * @brief Write a cipher text with its size to ostream
    */
-  template <class Param> class SizedTLWEWriter {
+  template <class Param> class SizedTLWEWriter : public TLWEWriter<Param> {
     std::ostream &ostream;
 
   public:
     explicit SizedTLWEWriter(std::ostream &stream) : ostream(stream) {
     }
 
-    void write(const TFHEpp::TLWE<Param> &cipher) {
+    void write(const TFHEpp::TLWE<Param> &cipher) override {
       std::stringstream midStream;
       write_to_archive(midStream, cipher);
 
@@ -29,5 +31,9 @@ namespace ArithHomFA {
       ostream.write(reinterpret_cast<char *>(&length), sizeof(uint32_t));
       ostream.write(midStream.str().c_str(), length);
     }
+
+    void flush() override {
+      ostream.flush();
+    }
   };
 } // namespace ArithHomFA
\ No newline at end of file
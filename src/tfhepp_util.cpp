@@ -1,6 +1,14 @@
 #include "tfhepp_util.hpp"
 #include "archive.hpp"
 
+#include <execution>
+#include <map>
+#include <numeric>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 ////////// TRGSWLvl1FFTSerializer
 
 TRGSWLvl1FFTSerializer::TRGSWLvl1FFTSerializer(std::ostream& os) : os_(os)
@@ -255,16 +263,96 @@ void TLWELvl1_add(TLWELvl1& lhs, const TLWELvl1& rhs)
         lhs[i] += rhs[i];
 }
 
+namespace {
+// out[i] += src[i] (or out[i] -= src[i] if negate) for i in [0, len)
+template <bool negate>
+void accumulate_scalar(uint32_t* out, const uint32_t* src, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        if constexpr (negate)
+            out[i] -= src[i];
+        else
+            out[i] += src[i];
+}
+
+#if defined(__x86_64__)
+template <bool negate>
+__attribute__((target("avx2"))) void accumulate_avx2(uint32_t* out,
+                                                     const uint32_t* src,
+                                                     size_t len)
+{
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m256i o =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(out + i));
+        __m256i s =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        o = negate ? _mm256_sub_epi32(o, s) : _mm256_add_epi32(o, s);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), o);
+    }
+    accumulate_scalar<negate>(out + i, src + i, len - i);
+}
+
+template <bool negate>
+__attribute__((target("avx512f"))) void accumulate_avx512(uint32_t* out,
+                                                          const uint32_t* src,
+                                                          size_t len)
+{
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m512i o = _mm512_loadu_si512(out + i);
+        __m512i s = _mm512_loadu_si512(src + i);
+        o = negate ? _mm512_sub_epi32(o, s) : _mm512_add_epi32(o, s);
+        _mm512_storeu_si512(out + i, o);
+    }
+    if (i < len) {
+        const __mmask16 mask = (1u << (len - i)) - 1;
+        __m512i o = _mm512_maskz_loadu_epi32(mask, out + i);
+        __m512i s = _mm512_maskz_loadu_epi32(mask, src + i);
+        o = negate ? _mm512_sub_epi32(o, s) : _mm512_add_epi32(o, s);
+        _mm512_mask_storeu_epi32(out + i, mask, o);
+    }
+}
+#endif
+
+struct AccumulateKernels {
+    void (*add)(uint32_t*, const uint32_t*, size_t);
+    void (*sub)(uint32_t*, const uint32_t*, size_t);
+};
+
+const AccumulateKernels& accumulate_kernels(CpuLevel level)
+{
+    static const AccumulateKernels scalar{accumulate_scalar<false>,
+                                          accumulate_scalar<true>};
+#if defined(__x86_64__)
+    static const AccumulateKernels avx2{accumulate_avx2<false>,
+                                        accumulate_avx2<true>},
+        avx512{accumulate_avx512<false>, accumulate_avx512<true>};
+    assert(level <= detect_cpu_level());
+    switch (level) {
+    case CpuLevel::AVX512:
+        return avx512;
+    case CpuLevel::AVX2:
+        return avx2;
+    case CpuLevel::SCALAR:
+        break;
+    }
+#endif
+    return scalar;
+}
+}  // namespace
+
 // out += src
-void TRLWELvl1_add(TRLWELvl1& out, const TRLWELvl1& src)
+void TRLWELvl1_add(TRLWELvl1& out, const TRLWELvl1& src, CpuLevel level)
 {
-    for (size_t i = 0; i < Lvl1::n; i++) 
-        for(size_t k = 0; k < Lvl1::k+1; k++)
-            out[k][i] += src[k][i];
+    const AccumulateKernels& kernels = accumulate_kernels(level);
+    for (size_t k = 0; k < Lvl1::k + 1; k++)
+        kernels.add(out[k].data(), src[k].data(), Lvl1::n);
 }
 
 namespace {
-void PolyLvl1_mult_X_k(PolyLvl1& out, const PolyLvl1& src, size_t k)
+HOMFA_MULTIVERSION void PolyLvl1_mult_X_k(PolyLvl1& out, const PolyLvl1& src,
+                                          size_t k)
 {
     constexpr size_t n = Lvl1::n;
 
@@ -285,6 +373,23 @@ void PolyLvl1_mult_X_k(PolyLvl1& out, const PolyLvl1& src, size_t k)
             out[i + k2] = -src[i];
     }
 }
+
+// out += src * X^k, split into two contiguous ranges of the coefficients
+void PolyLvl1_add_mult_X_k(PolyLvl1& out, const PolyLvl1& src, size_t k,
+                           const AccumulateKernels& kernels)
+{
+    constexpr size_t n = Lvl1::n;
+
+    if (k < n) {
+        kernels.sub(out.data(), src.data() + n - k, k);
+        kernels.add(out.data() + k, src.data(), n - k);
+    }
+    else {
+        const size_t k2 = k - n;
+        kernels.add(out.data(), src.data() + n - k2, k2);
+        kernels.sub(out.data() + k2, src.data(), n - k2);
+    }
+}
 }  // namespace
 
 // out = src * X^k
@@ -294,6 +399,16 @@ void TRLWELvl1_mult_X_k(TRLWELvl1& out, const TRLWELvl1& src, size_t k)
         PolyLvl1_mult_X_k(out[i], src[i], k);
 }
 
+// out += src * X^k
+void TRLWELvl1_add_mult_X_k(TRLWELvl1& out, const TRLWELvl1& src, size_t k,
+                            CpuLevel level)
+{
+    assert(k < 2 * Lvl1::n);
+    const AccumulateKernels& kernels = accumulate_kernels(level);
+    for (size_t i = 0; i < Lvl1::k + 1; i++)
+        PolyLvl1_add_mult_X_k(out[i], src[i], k, kernels);
+}
+
 uint32_t phase_of_TLWELvl1(const TLWELvl1& src, const SecretKey& skey)
 {
     return TFHEpp::tlweSymPhase<TFHEpp::lvl1param>(src, skey.key.lvl1);
@@ -378,6 +493,90 @@ void do_SEI_IKS_GBTLWE2TRLWE_3(TRLWELvl1& w, const EvalKey& ek)
     BS_TLWE_0_1o2_to_TRLWE_m1o8_1o8(w, tlwel0, ek);
 }
 
+// Apply do_SEI_IKS_GBTLWE2TRLWE_2 to each of the first num_outputs
+// coefficients of w. Since the bootstrapped TRLWE has garbage in the other
+// coefficients, each result is extracted and put back to its coefficient by
+// TLWE-to-TRLWE key switching.
+// {0, 1/2}^num_outputs -> {0, 1/2}^num_outputs
+void do_SEI_IKS_GBTLWE2TRLWE_multi(
+    TRLWELvl1& w, size_t num_outputs, const EvalKey& ek,
+    const TFHEpp::TLWE2TRLWEIKSKey<TFHEpp::lvl11param>& iks_key)
+{
+    using namespace TFHEpp;
+
+    TRLWELvl1 acc = trivial_TRLWELvl1_zero(), bootstrapped, packed, shifted;
+    TLWELvl1 tlwel1;
+    TLWELvl0 tlwel0;
+    for (size_t i = 0; i < num_outputs; i++) {
+        SampleExtractIndex<Lvl1>(tlwel1, w, i);
+        IdentityKeySwitch<lvl10param>(tlwel0, tlwel1, ek.getiksk<lvl10param>());
+        BS_TLWE_0_1o2_to_TRLWE_0_1o2(bootstrapped, tlwel0, ek);
+        SampleExtractIndex<Lvl1>(tlwel1, bootstrapped, 0);
+        TLWE2TRLWEIKS<lvl11param>(packed, tlwel1, iks_key);
+        TRLWELvl1_mult_X_k(shifted, packed, i);
+        TRLWELvl1_add(acc, shifted);
+    }
+    w = acc;
+}
+
+CMUXBatch CMUXBatch::plan(
+    const std::vector<size_t>& states,
+    const std::function<std::pair<size_t, size_t>(size_t)>& children)
+{
+    CMUXBatch batch;
+    std::map<std::pair<size_t, size_t>, size_t> first_parent;
+    for (size_t q : states) {
+        const auto pair = children(q);
+        if (pair.first == pair.second) {
+            batch.copies_of_input.emplace_back(q, pair.first);
+            continue;
+        }
+        auto [it, inserted] = first_parent.emplace(pair, q);
+        if (inserted) {
+            batch.cmux_states.push_back(q);
+            batch.cmux_children.push_back(pair);
+        }
+        else {
+            batch.copies_of_output.emplace_back(q, it->second);
+        }
+    }
+    return batch;
+}
+
+void CMUXBatch::copy(TRLWELvl1Vector& out, const TRLWELvl1Vector& weight) const
+{
+    std::for_each(std::execution::par, copies_of_output.begin(),
+                  copies_of_output.end(), [&](const auto& copy) {
+                      out.at(copy.first) = out.at(copy.second);
+                  });
+    std::for_each(std::execution::par, copies_of_input.begin(),
+                  copies_of_input.end(), [&](const auto& copy) {
+                      out.at(copy.first) = weight.at(copy.second);
+                  });
+}
+
+HOMFA_MULTIVERSION_FLATTEN void CMUXFFTLvl1(TRLWELvl1& out,
+                                            const TRGSWLvl1FFT& cs,
+                                            const TRLWELvl1& c1,
+                                            const TRLWELvl1& c0)
+{
+    TFHEpp::CMUXFFT<Lvl1>(out, cs, c1, c0);
+}
+
+void batch_CMUXFFT(TRLWELvl1Vector& out, const TRGSWLvl1FFT& input,
+                   const TRLWELvl1Vector& weight, const CMUXBatch& batch)
+{
+    std::vector<size_t> indices(batch.cmux_states.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    std::for_each(std::execution::par, indices.begin(), indices.end(),
+                  [&](size_t i) {
+                      auto [q0, q1] = batch.cmux_children.at(i);
+                      CMUXFFTLvl1(out.at(batch.cmux_states.at(i)), input,
+                                  weight.at(q1), weight.at(q0));
+                  });
+    batch.copy(out, weight);
+}
+
 TRGSWLvl1FFT encrypt_bit_to_TRGSWLvl1FFT(bool b, const SecretKey& skey)
 {
     return TFHEpp::trgswfftSymEncrypt<Lvl1>({b}, Lvl1::α, skey.key.lvl1);
@@ -430,8 +629,8 @@ std::string weight2bitstring(const PolyLvl1& w)
     return ss.str();
 }
 
-void CircuitBootstrappingFFTLvl11(TRGSWLvl1FFT& out, const TLWELvl1& src,
-                                  const EvalKey& ek)
+HOMFA_MULTIVERSION_FLATTEN void CircuitBootstrappingFFTLvl11(
+    TRGSWLvl1FFT& out, const TLWELvl1& src, const EvalKey& ek)
 {
     TFHEpp::CircuitBootstrappingFFT<TFHEpp::lvl10param, TFHEpp::lvl02param,
                                     TFHEpp::lvl21param>(out, src, ek);
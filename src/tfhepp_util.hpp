@@ -1,11 +1,18 @@
 #ifndef HOMFA_TFHEPP_UTIL_HPP
 #define HOMFA_TFHEPP_UTIL_HPP
 
+#include <cstddef>
 #include <fstream>
+#include <functional>
+#include <new>
+#include <utility>
+#include <vector>
 
 #include <ThreadPool.h>
 #include <tfhe++.hpp>
 
+#include "cpu_dispatch.hpp"
+
 using Lvl0 = TFHEpp::lvl0param;
 using TLWELvl0 = TFHEpp::TLWE<Lvl0>;
 using Lvl1 = TFHEpp::lvl1param;
@@ -16,6 +23,60 @@ using PolyLvl1 = TFHEpp::Polynomial<Lvl1>;
 using SecretKey = TFHEpp::SecretKey;
 using EvalKey = TFHEpp::EvalKey;
 
+// Allocator aligning the storage to the cache line
+template <class T, std::size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <class U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template <class U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T),
+                                              std::align_val_t{Alignment}));
+    }
+
+    void deallocate(T* p, std::size_t) noexcept
+    {
+        ::operator delete(p, std::align_val_t{Alignment});
+    }
+
+    // Default-initialize the elements unless a value is given, so that the
+    // memory of a new array is first touched by the threads writing it
+    template <class U>
+    void construct(U* p)
+    {
+        ::new (static_cast<void*>(p)) U;
+    }
+
+    template <class U, class... Args>
+    void construct(U* p, Args&&... args)
+    {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+
+    template <class U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept
+    {
+        return true;
+    }
+};
+
+// Contiguous array of the weights of DFA runners. Since the size of a TRLWE is
+// a multiple of the cache line, each weight starts at a cache line. Note that
+// resize() without a value leaves the new weights uninitialized.
+using TRLWELvl1Vector = std::vector<TRLWELvl1, AlignedAllocator<TRLWELvl1>>;
+static_assert(sizeof(TRLWELvl1) % 64 == 0);
+
 class TRGSWLvl1FFTSerializer {
     static_assert(TRGSWLvl1FFT{}.size() == (Lvl1::k+1) * Lvl1::l);
     static_assert(TRGSWLvl1FFT{}[0].size() == Lvl1::k+1);
@@ -143,6 +204,45 @@ struct BKey {
     }
 };
 
+// CMUXes of the weights of the states at a step of a DFA runner. The states
+// with the same pair of children always have the same weight, so the CMUX is
+// computed only for the first of them and copied to the others. The states
+// whose children are identical just copy the weight of the child.
+struct CMUXBatch {
+    // The states whose CMUX is computed, in the given order, and their
+    // children on 0 and 1
+    std::vector<size_t> cmux_states;
+    std::vector<std::pair<size_t, size_t>> cmux_children;
+    // (state, source): the weight of state is the new weight of source
+    std::vector<std::pair<size_t, size_t>> copies_of_output;
+    // (state, child): the weight of state is the old weight of child
+    std::vector<std::pair<size_t, size_t>> copies_of_input;
+
+    // children(q) returns the children of q on 0 and 1
+    static CMUXBatch plan(
+        const std::vector<size_t>& states,
+        const std::function<std::pair<size_t, size_t>(size_t)>& children);
+
+    size_t num_states() const
+    {
+        return cmux_states.size() + copies_of_output.size() +
+               copies_of_input.size();
+    }
+
+    // Fill the weights of the states not in cmux_states
+    void copy(TRLWELvl1Vector& out, const TRLWELvl1Vector& weight) const;
+};
+
+// out = CMUX(cs, c1, c0) of TFHEpp. With HOMFA_RUNTIME_DISPATCH, it is
+// compiled also for x86-64-v4 and chosen at runtime, as well as
+// CircuitBootstrappingFFTLvl11.
+void CMUXFFTLvl1(TRLWELvl1& out, const TRGSWLvl1FFT& cs, const TRLWELvl1& c1,
+                 const TRLWELvl1& c0);
+// out[q] = CMUX(input, weight[q1], weight[q0]) for each state q with children
+// q0 and q1 in the batch
+void batch_CMUXFFT(TRLWELvl1Vector& out, const TRGSWLvl1FFT& input,
+                   const TRLWELvl1Vector& weight, const CMUXBatch& batch);
+
 TLWELvl0 trivial_TLWELvl0_minus_1over8();
 TLWELvl0 trivial_TLWELvl0_1over8();
 TLWELvl1 trivial_TLWELvl1_minus_1over8();
@@ -154,13 +254,21 @@ TRLWELvl1 trivial_TRLWELvl1_1over8();
 TRLWELvl1 trivial_TRLWELvl1_1over2();
 void TLWELvl0_add(TLWELvl0& lhs, const TLWELvl0& rhs);
 void TLWELvl1_add(TLWELvl1& lhs, const TLWELvl1& rhs);
-void TRLWELvl1_add(TRLWELvl1& out, const TRLWELvl1& src);
+// The kernels of TRLWELvl1_add and TRLWELvl1_add_mult_X_k are chosen by
+// cpu_level(). A level not above detect_cpu_level() can be given explicitly.
+void TRLWELvl1_add(TRLWELvl1& out, const TRLWELvl1& src,
+                   CpuLevel level = cpu_level());
 void TRLWELvl1_mult_X_k(TRLWELvl1& out, const TRLWELvl1& src, size_t k);
+void TRLWELvl1_add_mult_X_k(TRLWELvl1& out, const TRLWELvl1& src, size_t k,
+                            CpuLevel level = cpu_level());
 uint32_t phase_of_TLWELvl1(const TLWELvl1& src, const SecretKey& skey);
 PolyLvl1 phase_of_TRLWELvl1(const TRLWELvl1& src, const SecretKey& skey);
 void do_SEI_IKS_GBTLWE2TRLWE(TRLWELvl1& w, const EvalKey& ek);
 void do_SEI_IKS_GBTLWE2TRLWE_2(TRLWELvl1& w, const EvalKey& ek);
 void do_SEI_IKS_GBTLWE2TRLWE_3(TRLWELvl1& w, const EvalKey& ek);
+void do_SEI_IKS_GBTLWE2TRLWE_multi(
+    TRLWELvl1& w, size_t num_outputs, const EvalKey& ek,
+    const TFHEpp::TLWE2TRLWEIKSKey<TFHEpp::lvl11param>& iks_key);
 void BS_TLWE_0_1o2_to_TRLWE_0_1o2(TRLWELvl1& out, TLWELvl0& src,
                                   const EvalKey& ek);
 void BS_TLWE_0_1o2_to_TRLWE_m1o8_1o8(TRLWELvl1& out, TLWELvl0& src,
@@ -0,0 +1,78 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <optional>
+
+#include "tfhe++.hpp"
+
+#include "raw_tlwe_writer.hh"
+#include "sized_tlwe_reader.hh"
+
+namespace ArithHomFA {
+  /*!
+   * @brief Read TLWE ciphertexts written by either SizedTLWEWriter or RawTLWEWriter
+   *
+   * The format is detected by the first four bytes of the stream, which are either the size of the first record or
+   * the beginning of RawTLWEHeader. Thus, the stream does not have to be seekable.
+   */
+  template <class Param> class TLWEReader {
+    std::istream &istream;
+    //! The reader of the sized format, or std::nullopt if the format is raw or not detected yet
+    std::optional<SizedTLWEReader<Param>> sizedReader;
+    bool detected = false;
+
+    //! Read the first four bytes and, if the format is raw, the rest of the header
+    bool detect(TFHEpp::TLWE<Param> &cipher) {
+      detected = true;
+      RawTLWEHeader header{};
+      istream.read(header.magic.data(), sizeof(uint32_t));
+      if (!istream.good()) {
+        return false;
+      }
+      if (std::memcmp(header.magic.data(), RawTLWEHeader::expectedMagic.data(), sizeof(uint32_t)) != 0) {
+        // The four bytes are the size of the first record
+        sizedReader.emplace(istream);
+        uint32_t length;
+        std::memcpy(&length, header.magic.data(), sizeof(uint32_t));
+        return sizedReader->readBody(length, cipher);
+      }
+      istream.read(reinterpret_cast<char *>(&header) + sizeof(uint32_t), sizeof(RawTLWEHeader) - sizeof(uint32_t));
+      if (!istream.good()) {
+        return false;
+      }
+      header.validate<Param>();
+
+      return readRaw(cipher);
+    }
+
+    bool readRaw(TFHEpp::TLWE<Param> &cipher) {
+      istream.read(reinterpret_cast<char *>(cipher.data()), sizeof(TFHEpp::TLWE<Param>));
+      return istream.gcount() == sizeof(TFHEpp::TLWE<Param>);
+    }
+
+  public:
+    explicit TLWEReader(std::istream &stream) : istream(stream) {
+    }
+
+    bool read(TFHEpp::TLWE<Param> &cipher) {
+      if (!detected) {
+        return detect(cipher);
+      }
+      if (sizedReader) {
+        return sizedReader->read(cipher);
+      }
+      if (!istream.good()) {
+        return false;
+      }
+
+      return readRaw(cipher);
+    }
+  };
+} // namespace ArithHomFA
@@ -0,0 +1,27 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#pragma once
+
+#include "tfhe++.hpp"
+
+namespace ArithHomFA {
+  /*!
+   * @brief Interface of the writers of the monitoring results, i.e., SizedTLWEWriter and RawTLWEWriter
+   */
+  template <class Param> class TLWEWriter {
+  public:
+    virtual ~TLWEWriter() = default;
+
+    virtual void write(const TFHEpp::TLWE<Param> &cipher) = 0;
+
+    /*!
+     * @brief Write all the results given so far to the stream
+     *
+     * It throws if a result could not be written. It must be called at the end because the destructor ignores errors.
+     */
+    virtual void flush() = 0;
+  };
+} // namespace ArithHomFA
@@ -9,10 +9,8 @@ namespace ArithHomFA {
   //! @brief Compute glucose > 70
   void CKKSPredicate::evalPredicateInternal(const std::vector<seal::Ciphertext> &valuation,
                                             std::vector<seal::Ciphertext> &result) {
-    seal::Plaintext plain;
-    this->encoder.encode(70, this->scale, plain);
-    this->evaluator.sub_plain(valuation.front(), plain, result.front());
-    this->evaluator.mod_switch_to_inplace(result.front(), context.last_parms_id());
+    this->evaluator.sub_plain(valuation.front(), this->constant(70), result.front());
+    this->evaluator.mod_switch_to_inplace(result.front(), this->lastParmsId());
   }
 
   void CKKSPredicate::evalPredicateInternal(const std::vector<double> &valuation,
@@ -25,4 +23,6 @@ namespace ArithHomFA {
   const std::size_t CKKSPredicate::predicateSize = 1;
   // The approximate maximum value of the difference between the signal and the threshold
   const std::vector<double> CKKSPredicate::references = {230};
+  // The constants encoded in advance
+  const PredicateConstants predicateConstants = {70};
 }
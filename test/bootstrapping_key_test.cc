@@ -1,3 +1,7 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
 #include <sstream>
 
 #include <boost/test/unit_test.hpp>
@@ -8,6 +12,7 @@
 
 #include "bootstrapping_key.hh"
 #include "ckks_to_tfhe.hh"
+#include "mapped_bootstrapping_key.hh"
 
 BOOST_AUTO_TEST_SUITE(BootstrappingKeyTest)
 
@@ -132,4 +137,82 @@ BOOST_AUTO_TEST_SUITE(BootstrappingKeyTest)
     }
   }
 
+  // This also takes quite some time because of the key generation.
+  BOOST_AUTO_TEST_CASE(writeAndMap) {
+    TFHEpp::SecretKey sKey;
+    seal::EncryptionParameters params{seal::scheme_type::ckks};
+    const std::size_t poly_modulus_degree = 1 << TFHEpp::lvl3param::nbit;
+    params.set_poly_modulus_degree(poly_modulus_degree);
+    params.set_coeff_modulus(seal::CoeffModulus::Create(poly_modulus_degree, {60, 40, 60}));
+    seal::SEALContext context{params};
+    seal::KeyGenerator keygen{context};
+    ArithHomFA::CKKSToTFHE converter{context};
+    TFHEpp::Key<TFHEpp::lvl3param> lvl3Key;
+    converter.toLv3Key(keygen.secret_key(), lvl3Key);
+    ArithHomFA::BootstrappingKey bKey{sKey, lvl3Key, sKey.key.lvlhalf};
+
+    const auto path = std::filesystem::temp_directory_path() / "ahomfa_mapped_bkey_test.bkey";
+    {
+      std::ofstream stream{path, std::ios::binary};
+      ArithHomFA::writeMappedBootstrappingKey(stream, bKey);
+    }
+    BOOST_TEST(ArithHomFA::isMappedBootstrappingKey(path));
+    const auto loadedKey = ArithHomFA::loadBootstrappingKey(path);
+    std::filesystem::remove(path);
+
+    // The flat keys are used in place and must be bit-identical
+    BOOST_TEST(std::memcmp(bKey.kskh2m.get(), loadedKey.kskh2m.get(), sizeof(*bKey.kskh2m)) == 0);
+    BOOST_TEST(std::memcmp(bKey.kskm2l.get(), loadedKey.kskm2l.get(), sizeof(*bKey.kskm2l)) == 0);
+    BOOST_TEST(std::memcmp(bKey.bkfft.get(), loadedKey.bkfft.get(), sizeof(*bKey.bkfft)) == 0);
+    BOOST_TEST(std::memcmp(bKey.tlwel1_trlwel1_ikskey.get(), loadedKey.tlwel1_trlwel1_ikskey.get(),
+                           sizeof(*bKey.tlwel1_trlwel1_ikskey)) == 0);
+    BOOST_TEST(std::memcmp(bKey.ekey->iksklvl10.get(), loadedKey.ekey->iksklvl10.get(),
+                           sizeof(*bKey.ekey->iksklvl10)) == 0);
+    BOOST_TEST(std::memcmp(bKey.ekey->bkfftlvl02.get(), loadedKey.ekey->bkfftlvl02.get(),
+                           sizeof(*bKey.ekey->bkfftlvl02)) == 0);
+  }
+
+  // This also takes quite some time because of the key generation.
+  BOOST_AUTO_TEST_CASE(mappedEvalKeyCircuitBootstrapping) {
+    TFHEpp::SecretKey sKey;
+    seal::EncryptionParameters params{seal::scheme_type::ckks};
+    const std::size_t poly_modulus_degree = 1 << TFHEpp::lvl3param::nbit;
+    params.set_poly_modulus_degree(poly_modulus_degree);
+    params.set_coeff_modulus(seal::CoeffModulus::Create(poly_modulus_degree, {60, 40, 60}));
+    seal::SEALContext context{params};
+    seal::KeyGenerator keygen{context};
+    ArithHomFA::CKKSToTFHE converter{context};
+    TFHEpp::Key<TFHEpp::lvl3param> lvl3Key;
+    converter.toLv3Key(keygen.secret_key(), lvl3Key);
+    ArithHomFA::BootstrappingKey bKey{sKey, lvl3Key, sKey.key.lvlhalf};
+
+    const auto path = std::filesystem::temp_directory_path() / "ahomfa_mapped_ekey_test.bkey";
+    {
+      std::ofstream stream{path, std::ios::binary};
+      ArithHomFA::writeMappedBootstrappingKey(stream, bKey);
+    }
+    const auto mappedKey = ArithHomFA::mapBootstrappingKey(path);
+    std::filesystem::remove(path);
+    std::stringstream stream;
+    write_to_archive(stream, bKey);
+    const auto loadedKey = read_from_archive<ArithHomFA::BootstrappingKey>(stream);
+
+    for (const bool value: {false, true}) {
+      // Encrypt 1/4 or -1/4
+      const TLWELvl1 tlwe = TFHEpp::tlweSymEncrypt<TFHEpp::lvl1param>(value ? 1u << 30 : -(1u << 30),
+                                                                      TFHEpp::lvl1param::α, sKey.key.lvl1);
+      TRGSWLvl1FFT mappedTrgsw, loadedTrgsw;
+      CircuitBootstrappingFFTLvl11(mappedTrgsw, tlwe, *mappedKey.ekey);
+      CircuitBootstrappingFFTLvl11(loadedTrgsw, tlwe, *loadedKey.ekey);
+      BOOST_TEST(std::memcmp(&mappedTrgsw, &loadedTrgsw, sizeof(TRGSWLvl1FFT)) == 0);
+
+      // The result of the circuit bootstrapping with the mapped key is valid
+      TRLWELvl1 result, one{}, zero{};
+      zero.at(1).front() = -1u << (std::numeric_limits<TFHEpp::lvl1param::T>::digits - 2);
+      one.at(1).front() = 1u << (std::numeric_limits<TFHEpp::lvl1param::T>::digits - 2);
+      TFHEpp::CMUXFFT<TFHEpp::lvl1param>(result, mappedTrgsw, one, zero);
+      BOOST_TEST(TFHEpp::trlweSymDecrypt<TFHEpp::lvl1param>(result, sKey.key.lvl1).front() == value);
+    }
+  }
+
   BOOST_AUTO_TEST_SUITE_END()
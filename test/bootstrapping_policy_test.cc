@@ -0,0 +1,133 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "archive.hpp"
+
+#include "../src/reverse_runner.hh"
+
+BOOST_AUTO_TEST_SUITE(BootstrappingPolicyTest)
+
+  BOOST_AUTO_TEST_CASE(Interval) {
+    const Graph graph = Graph::from_ltl_formula("G(p0)", 1, true);
+    const auto states = graph.all_states();
+    IntervalBootstrappingPolicy policy{3};
+    for (int i = 1; i <= 9; ++i) {
+      const auto targets = policy.after_cmux(graph, states);
+      BOOST_CHECK_EQUAL(targets.size(), i % 3 == 0 ? states.size() : 0);
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE(DepthIsBelowLimit) {
+    const Graph graph = Graph::from_ltl_formula("G(p0 -> F[0,25] !p0)", 1, true).reversed().minimized();
+    const auto states = graph.all_states();
+    const std::size_t maxDepth = 5;
+    DepthBootstrappingPolicy policy{maxDepth};
+    std::size_t numBootstrapped = 0;
+    for (int i = 0; i < 100; ++i) {
+      numBootstrapped += policy.after_cmux(graph, states).size();
+      for (const auto q: states) {
+        BOOST_TEST(policy.depth(q) < maxDepth);
+      }
+    }
+    BOOST_TEST(numBootstrapped > 0);
+    // Never more than bootstrapping all the weights at the same interval
+    BOOST_TEST(numBootstrapped <= states.size() * (100 / maxDepth));
+  }
+
+  BOOST_AUTO_TEST_CASE(DepthKeepsUntouchedWeights) {
+    const Graph graph = Graph::from_ltl_formula("G(p0)", 1, true);
+    const auto states = graph.all_states();
+    DepthBootstrappingPolicy policy{3};
+    // Only the first state is updated, so the depths of the other states stay 0
+    const std::vector<Graph::State> updated = {states.front()};
+    for (int i = 0; i < 9; ++i) {
+      policy.after_cmux(graph, updated);
+      for (std::size_t j = 1; j < states.size(); ++j) {
+        BOOST_CHECK_EQUAL(policy.depth(states.at(j)), 0);
+      }
+      BOOST_TEST(policy.depth(states.front()) < 3);
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE(NoiseModelIsConsistent) {
+    const NoiseModel model = NoiseModel::from_tfhepp_params();
+    BOOST_TEST(model.bootstrapped_variance > 0);
+    BOOST_TEST(model.cmux_variance > 0);
+    BOOST_TEST(model.decision_variance > 0);
+    // A smaller failure probability requires a smaller variance
+    BOOST_TEST(model.max_variance(1e-12) < model.max_variance(1e-6));
+    BOOST_TEST(model.max_variance(1e-9) > model.bootstrapped_variance + model.cmux_variance);
+  }
+
+  BOOST_AUTO_TEST_CASE(NoiseKeepsVarianceBelowThreshold) {
+    const Graph graph = Graph::from_ltl_formula("G(p0 -> F[0,25] !p0)", 1, true).reversed().minimized();
+    const auto states = graph.all_states();
+    const NoiseModel model = NoiseModel::from_tfhepp_params();
+    NoiseBootstrappingPolicy policy{model, 1e-9};
+    std::size_t numBootstrapped = 0;
+    double maxVariance = 0;
+    const int numInputs = 100000;
+    for (int i = 0; i < numInputs; ++i) {
+      numBootstrapped += policy.after_cmux(graph, states).size();
+      for (const auto q: states) {
+        maxVariance = std::max(maxVariance, policy.variance(q));
+      }
+    }
+    BOOST_TEST(maxVariance + model.cmux_variance <= policy.threshold());
+    BOOST_TEST(numBootstrapped > 0);
+    // Bootstrapping every weight at every input is never necessary with the default parameters
+    BOOST_TEST(numBootstrapped < states.size() * numInputs);
+  }
+
+  void testReverseRunnerWithPolicy(std::unique_ptr<BootstrappingPolicy> &&policy) {
+    Graph graph = Graph::from_ltl_formula("G(p0)", 1, true);
+    const auto scale = std::pow(2, 40);
+    const ArithHomFA::SealConfig config = {
+        8192,                         // poly_modulus_degree
+        std::vector<int>{60, 40, 60}, // base_sizes
+        scale                         // scale
+    };
+    const auto &context = config.makeContext();
+
+    // Make keys
+    seal::KeyGenerator keygen(context);
+    const auto &sealKey = keygen.secret_key();
+    TFHEpp::SecretKey skey;
+    // CKKSToTFHE is necessary to make lvl3Key
+    ArithHomFA::CKKSToTFHE converter(context);
+    TFHEpp::Key<TFHEpp::lvl3param> lvl3Key;
+    converter.toLv3Key(sealKey, lvl3Key);
+    ArithHomFA::BootstrappingKey bkey(skey, lvl3Key);
+
+    // Instantiate encoder and encryptor
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, sealKey);
+
+    ArithHomFA::ReverseRunner<ArithHomFA::RunnerMode::normal> runner{
+        context, scale, graph, std::move(policy), bkey, {1000}};
+    const std::vector<double> input = {100, 90, 80, 75, 60, 80, 90};
+    const std::vector<bool> expected = {true, true, true, true, false, false, false};
+    seal::Plaintext plain;
+    seal::Ciphertext cipher;
+    for (std::size_t i = 0; i < input.size(); ++i) {
+      encoder.encode(input.at(i), scale, plain);
+      encryptor.encrypt_symmetric(plain, cipher);
+      BOOST_CHECK_EQUAL(expected.at(i), decrypt_TLWELvl1_to_bit(runner.feed({cipher}), skey));
+    }
+
+    runner.printTime();
+  }
+
+  BOOST_AUTO_TEST_CASE(ReverseRunnerWithNoisePolicy) {
+    testReverseRunnerWithPolicy(std::make_unique<NoiseBootstrappingPolicy>(NoiseModel::from_tfhepp_params(), 1e-9));
+  }
+
+  BOOST_AUTO_TEST_CASE(ReverseRunnerWithDepthPolicy) {
+    testReverseRunnerWithPolicy(std::make_unique<DepthBootstrappingPolicy>(2));
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
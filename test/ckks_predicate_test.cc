@@ -34,4 +34,62 @@ BOOST_AUTO_TEST_SUITE(CKKSPredicateTest)
         RC_ASSERT((encoder.decode(plain) > 0) == (value > 70));
     }
 
+    // The valuation encrypted at a lower level is evaluated with the constants at that level
+    RC_BOOST_PROP(evalLastLevel, ()) {
+        const auto value = *rc::gen::inRange(-10000, 10000);
+        const ArithHomFA::SealConfig config = {
+                8192, // poly_modulus_degree
+                std::vector<int>{60, 40, 60}, // base_sizes
+                std::pow(2, 40) // scale
+        };
+        const auto context = config.makeContext();
+        ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+        seal::SecretKey secretKey = seal::KeyGenerator(context).secret_key();
+        seal::Encryptor encryptor(context, secretKey);
+        seal::Plaintext plain;
+        encoder.encode(value, context.last_parms_id(), config.scale, plain);
+        std::vector<seal::Ciphertext> valuation(1), result(1);
+        encryptor.encrypt_symmetric(plain, valuation.front());
+        ArithHomFA::CKKSPredicate predicate{context, config.scale};
+        predicate.eval(valuation, result);
+        RC_ASSERT(result.front().parms_id() == context.last_parms_id());
+        seal::Decryptor decryptor(context, secretKey);
+        decryptor.decrypt(result.front(), plain);
+        RC_ASSERT((encoder.decode(plain) > 0) == (value > 70));
+    }
+
+    namespace {
+        struct PreparedPredicate : public ArithHomFA::CKKSPredicate {
+            using ArithHomFA::CKKSPredicate::CKKSPredicate;
+
+            std::size_t numEncodedConstants() const {
+                return plainConstants.size();
+            }
+        };
+    } // namespace
+
+    // The constants are encoded for each level at the construction and not encoded again in the evaluation
+    BOOST_AUTO_TEST_CASE(prepare) {
+        const ArithHomFA::SealConfig config = {
+                8192, // poly_modulus_degree
+                std::vector<int>{60, 40, 60}, // base_sizes
+                std::pow(2, 40) // scale
+        };
+        const auto context = config.makeContext();
+        PreparedPredicate predicate{context, config.scale};
+        // Both {60, 40} and {60} can encode the constants with the scale 2^40
+        const std::size_t numEncoded = ArithHomFA::CKKSPredicate::getConstants().size() * 2;
+        BOOST_CHECK_EQUAL(predicate.numEncodedConstants(), numEncoded);
+
+        ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+        seal::SecretKey secretKey = seal::KeyGenerator(context).secret_key();
+        seal::Encryptor encryptor(context, secretKey);
+        seal::Plaintext plain;
+        encoder.encode(100, config.scale, plain);
+        std::vector<seal::Ciphertext> valuation(1), result(1);
+        encryptor.encrypt_symmetric(plain, valuation.front());
+        predicate.eval(valuation, result);
+        BOOST_CHECK_EQUAL(predicate.numEncodedConstants(), numEncoded);
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
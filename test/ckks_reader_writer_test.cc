@@ -1,3 +1,6 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <sstream>
 
 #include <boost/test/unit_test.hpp>
@@ -6,6 +9,10 @@
 #include "tfhe++.hpp"
 
 #include "../src/ahomfa_runner.hh"
+#include "ckks_packed_encoder.hh"
+#include "direct_cipher_writer.hh"
+#include "mapped_cipher_reader.hh"
+#include "reversed_cipher_reader.hh"
 #include "sized_cipher_reader.hh"
 #include "sized_cipher_writer.hh"
 
@@ -74,4 +81,209 @@ BOOST_AUTO_TEST_SUITE(CKKSReaderWriterTest)
     }
   }
 
+  // The seeded ciphertexts at the last level are read as usual and smaller than the usual ones
+  RC_BOOST_FIXTURE_PROP(writeAndReadCompact, CKKSToTFHEFixture, (const std::vector<int32_t> &given)) {
+    static seal::KeyGenerator keygen{contexts.back()};
+    const auto &secretKey = keygen.secret_key();
+    const seal::SEALContext &context = contexts.back();
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, secretKey);
+    seal::Decryptor decryptor(context, secretKey);
+
+    std::stringstream stream, fullStream;
+    ArithHomFA::SizedCipherWriter writer{stream}, fullWriter{fullStream};
+    ArithHomFA::SizedCipherReader reader{stream};
+
+    for (const auto &value: given) {
+      seal::Plaintext plain;
+      encoder.encode(static_cast<double>(value) * minValue, context.last_parms_id(), scale, plain);
+      writer.write(encryptor.encrypt_symmetric(plain));
+      seal::Ciphertext cipher;
+      encoder.encode(static_cast<double>(value) * minValue, scale, plain);
+      encryptor.encrypt_symmetric(plain, cipher);
+      fullWriter.write(cipher);
+    }
+    RC_ASSERT(given.empty() || stream.str().size() < fullStream.str().size() / 2);
+
+    for (const auto &value: given) {
+      seal::Plaintext plain;
+      seal::Ciphertext cipher;
+      RC_ASSERT(reader.read(context, cipher));
+      RC_ASSERT(cipher.parms_id() == context.last_parms_id());
+      decryptor.decrypt(cipher, plain);
+      RC_ASSERT(std::abs(encoder.decode(plain) - static_cast<double>(value) * minValue) < 0.001);
+    }
+  }
+
+  RC_BOOST_FIXTURE_PROP(writeAndReadReversed, CKKSToTFHEFixture,
+                        (const std::vector<int32_t> &given, const uint8_t &chunkSize)) {
+    static seal::KeyGenerator keygen{contexts.front()};
+    const auto &secretKey = keygen.secret_key();
+    const seal::SEALContext &context = contexts.front();
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, secretKey);
+    seal::Decryptor decryptor(context, secretKey);
+
+    const auto path = std::filesystem::temp_directory_path() / "ahomfa_reversed_reader_test.ctxt";
+    {
+      std::ofstream stream{path, std::ios::binary};
+      ArithHomFA::SizedCipherWriter writer{stream};
+      for (const auto &value: given) {
+        seal::Plaintext plain;
+        seal::Ciphertext cipher;
+        encoder.encode(static_cast<double>(value) * minValue, scale, plain);
+        encryptor.encrypt_symmetric(plain, cipher);
+        writer.write(cipher);
+      }
+    }
+
+    ArithHomFA::ReversedSizedCipherReader reader{path, context, chunkSize};
+    RC_ASSERT(reader.size() == given.size());
+    for (auto it = given.rbegin(); it != given.rend(); ++it) {
+      seal::Plaintext plain;
+      seal::Ciphertext cipher;
+      RC_ASSERT(reader.read(cipher));
+      decryptor.decrypt(cipher, plain);
+      RC_ASSERT(std::abs(encoder.decode(plain) - static_cast<double>(*it) * minValue) < 0.001);
+    }
+    seal::Ciphertext cipher;
+    RC_ASSERT(!reader.read(cipher));
+    std::filesystem::remove(path);
+  }
+
+  // The incomplete record at the end is ignored as by SizedCipherReader
+  RC_BOOST_FIXTURE_PROP(readReversedTruncated, CKKSToTFHEFixture,
+                        (const std::vector<int32_t> &given, const uint8_t &chunkSize)) {
+    RC_PRE(!given.empty());
+    static seal::KeyGenerator keygen{contexts.front()};
+    const auto &secretKey = keygen.secret_key();
+    const seal::SEALContext &context = contexts.front();
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, secretKey);
+    seal::Decryptor decryptor(context, secretKey);
+
+    const auto path = std::filesystem::temp_directory_path() / "ahomfa_reversed_reader_truncated_test.ctxt";
+    {
+      std::ofstream stream{path, std::ios::binary};
+      ArithHomFA::SizedCipherWriter writer{stream};
+      for (const auto &value: given) {
+        seal::Plaintext plain;
+        seal::Ciphertext cipher;
+        encoder.encode(static_cast<double>(value) * minValue, scale, plain);
+        encryptor.encrypt_symmetric(plain, cipher);
+        writer.write(cipher);
+      }
+    }
+    // Drop the last byte of the last record
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+
+    ArithHomFA::ReversedSizedCipherReader reader{path, context, chunkSize};
+    RC_ASSERT(reader.size() == given.size() - 1);
+    for (auto it = std::next(given.rbegin()); it != given.rend(); ++it) {
+      seal::Plaintext plain;
+      seal::Ciphertext cipher;
+      RC_ASSERT(reader.read(cipher));
+      decryptor.decrypt(cipher, plain);
+      RC_ASSERT(std::abs(encoder.decode(plain) - static_cast<double>(*it) * minValue) < 0.001);
+    }
+    seal::Ciphertext cipher;
+    RC_ASSERT(!reader.read(cipher));
+    std::filesystem::remove(path);
+  }
+
+  RC_BOOST_FIXTURE_PROP(writeDirectAndReadMapped, CKKSToTFHEFixture,
+                        (const std::vector<int32_t> &given, const bool &direct)) {
+    static seal::KeyGenerator keygen{contexts.front()};
+    const auto &secretKey = keygen.secret_key();
+    const seal::SEALContext &context = contexts.front();
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, secretKey);
+    seal::Decryptor decryptor(context, secretKey);
+
+    const auto path = std::filesystem::temp_directory_path() / "ahomfa_direct_writer_test.ctxt";
+    {
+      // The buffer is smaller than a ciphertext to test its growth
+      ArithHomFA::DirectSizedCipherWriter writer{path, direct, ArithHomFA::DirectSizedCipherWriter::alignment};
+      for (std::size_t i = 0; i < given.size(); ++i) {
+        seal::Plaintext plain;
+        encoder.encode(static_cast<double>(given.at(i)) * minValue, scale, plain);
+        // The headers are interleaved as in `ahomfa_util ckks enc --pack`
+        writer.writeHeader(ArithHomFA::PackedBatchHeader::make(i + 1));
+        writer.write(encryptor.encrypt_symmetric(plain));
+      }
+    }
+
+    ArithHomFA::MappedSizedCipherReader reader{path};
+    for (std::size_t i = 0; i < given.size(); ++i) {
+      const auto value = given.at(i);
+      ArithHomFA::PackedBatchHeader header{};
+      RC_ASSERT(reader.readHeader(header));
+      RC_ASSERT(header.numSteps == i + 1);
+      seal::Plaintext plain;
+      seal::Ciphertext cipher;
+      RC_ASSERT(reader.read(context, cipher));
+      decryptor.decrypt(cipher, plain);
+      RC_ASSERT(std::abs(encoder.decode(plain) - static_cast<double>(value) * minValue) < 0.001);
+    }
+    RC_ASSERT(!reader.good());
+    std::filesystem::remove(path);
+  }
+
+  // Report the throughput of writing and reading 100k ciphertexts in each format
+  BOOST_AUTO_TEST_CASE(throughputBenchmark, *boost::unit_test::disabled()) {
+    const std::size_t numCiphers = 100000;
+    seal::EncryptionParameters smallParms(seal::scheme_type::ckks);
+    // The smallest parameter keeps the file about 3 GB
+    smallParms.set_poly_modulus_degree(2048);
+    smallParms.set_coeff_modulus(seal::CoeffModulus::Create(2048, {54}));
+    const seal::SEALContext context(smallParms);
+    seal::KeyGenerator keygen(context);
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, keygen.secret_key());
+    seal::Plaintext plain;
+    encoder.encode(1.0, std::pow(2.0, 25), plain);
+    seal::Ciphertext cipher;
+    encryptor.encrypt_symmetric(plain, cipher);
+
+    const auto path = std::filesystem::temp_directory_path() / "ahomfa_throughput_benchmark.ctxt";
+    const auto measure = [&](const std::string &name, auto &&f) {
+      const auto begin = std::chrono::high_resolution_clock::now();
+      f();
+      const double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+      const double megabytes = static_cast<double>(std::filesystem::file_size(path)) / (1 << 20);
+      std::cout << name << ": " << megabytes / elapsed << " MB/s" << std::endl;
+    };
+    measure("SizedCipherWriter", [&] {
+      std::ofstream stream{path, std::ios::binary};
+      ArithHomFA::SizedCipherWriter writer{stream};
+      for (std::size_t i = 0; i < numCiphers; ++i) {
+        writer.write(cipher);
+      }
+    });
+    measure("SizedCipherReader", [&] {
+      std::ifstream stream{path, std::ios::binary};
+      ArithHomFA::SizedCipherReader reader{stream};
+      while (reader.read(context, cipher)) {
+      }
+    });
+    measure("DirectSizedCipherWriter (O_DIRECT)", [&] {
+      ArithHomFA::DirectSizedCipherWriter writer{path};
+      for (std::size_t i = 0; i < numCiphers; ++i) {
+        writer.write(cipher);
+      }
+    });
+    measure("DirectSizedCipherWriter (buffered)", [&] {
+      ArithHomFA::DirectSizedCipherWriter writer{path, false};
+      for (std::size_t i = 0; i < numCiphers; ++i) {
+        writer.write(cipher);
+      }
+    });
+    measure("MappedSizedCipherReader", [&] {
+      ArithHomFA::MappedSizedCipherReader reader{path};
+      while (reader.read(context, cipher)) {
+      }
+    });
+    std::filesystem::remove(path);
+  }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,9 +1,13 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 #include <valarray>
 
 #include <boost/test/unit_test.hpp>
 #include <rapidcheck/boost_test.h>
 
 #include "../src/ckks_no_embed.hh"
+#include "../src/ckks_packed_encoder.hh"
 #include "../src/ckks_predicate.hh"
 #include "../src/ckks_to_tfhe.hh"
 
@@ -148,6 +152,73 @@ BOOST_AUTO_TEST_SUITE(CKKSToTFHETest)
     }
   }
 
+  // The cached plaintexts give the same amplification as the freshly encoded ones
+  RC_BOOST_FIXTURE_PROP(amplifyWithPreparedAmplifiers, CKKSToTFHEFixture, (const bool &useLargerParam)) {
+    const auto intValue = *rc::gen::inRange<int64_t>(-10000, 10000);
+    const double &value = static_cast<double>(intValue) * minValue;
+    const double reference = *rc::gen::element(1.0, 10.0, 100.0);
+
+    const seal::SEALContext &context = contexts.at(useLargerParam);
+    seal::KeyGenerator keygen(context);
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, keygen.secret_key());
+    encoder.encode(value, scale, plain);
+    seal::Ciphertext cipher;
+    encryptor.encrypt_symmetric(plain, cipher);
+
+    ArithHomFA::CKKSToTFHE prepared(context);
+    prepared.prepareAmplifiers({1.0, 10.0, 100.0}, scale);
+    const seal::Evaluator evaluator(context);
+    while (true) {
+      seal::Ciphertext expected = cipher, actual = cipher, again = cipher;
+      ArithHomFA::CKKSToTFHE(context).amplify(expected, reference);
+      prepared.amplify(actual, reference);
+      prepared.amplify(again, reference);
+      RC_ASSERT(std::equal(expected.data(), expected.data() + expected.dyn_array().size(), actual.data()));
+      RC_ASSERT(std::equal(expected.data(), expected.data() + expected.dyn_array().size(), again.data()));
+      if (!context.get_context_data(cipher.parms_id())->next_context_data()) {
+        break;
+      }
+      evaluator.mod_switch_to_next_inplace(cipher);
+    }
+  }
+
+  // A predicate output rescaled to the last level has a slightly different scale. Its plaintext is encoded once at the
+  // first use and reused, in addition to the prepared ones.
+  RC_BOOST_FIXTURE_PROP(amplifyRescaledWithPreparedAmplifiers, CKKSToTFHEFixture, (const bool &useLargerParam)) {
+    const auto intValue = *rc::gen::inRange<int64_t>(-10000, 10000);
+    const double &value = static_cast<double>(intValue) * minValue;
+    const std::vector<double> references = {1.0, 10.0, 100.0};
+    const double reference = *rc::gen::elementOf(references);
+
+    const seal::SEALContext &context = contexts.at(useLargerParam);
+    seal::KeyGenerator keygen(context);
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, keygen.secret_key());
+    encoder.encode(value, scale, plain);
+    seal::Ciphertext cipher;
+    encryptor.encrypt_symmetric(plain, cipher);
+    // Multiply by one and rescale to the last level, as a predicate does
+    const seal::Evaluator evaluator(context);
+    encoder.encode(1.0, scale, plain);
+    evaluator.multiply_plain_inplace(cipher, plain);
+    evaluator.rescale_to_next_inplace(cipher);
+    evaluator.mod_switch_to_inplace(cipher, context.last_parms_id());
+    RC_ASSERT(cipher.scale() != scale);
+
+    ArithHomFA::CKKSToTFHE prepared(context);
+    prepared.prepareAmplifiers(references, scale);
+    RC_ASSERT(prepared.numAmplifiers() == references.size());
+    seal::Ciphertext expected = cipher, actual = cipher, again = cipher;
+    ArithHomFA::CKKSToTFHE(context).amplify(expected, reference);
+    prepared.amplify(actual, reference);
+    RC_ASSERT(prepared.numAmplifiers() == references.size() + 1);
+    prepared.amplify(again, reference);
+    RC_ASSERT(prepared.numAmplifiers() == references.size() + 1);
+    RC_ASSERT(std::equal(expected.data(), expected.data() + expected.dyn_array().size(), actual.data()));
+    RC_ASSERT(std::equal(expected.data(), expected.data() + expected.dyn_array().size(), again.data()));
+  }
+
   RC_BOOST_FIXTURE_PROP(toLv3TRLWE, CKKSToTFHEFixture, (const bool &useLargerParam)) {
     // We require that the given value is in a certain range. Otherwise, the decryption fails.
     const auto intValue =
@@ -550,4 +621,198 @@ BOOST_AUTO_TEST_SUITE(CKKSToTFHETest)
     RC_ASSERT(tlwePlain == (value > 70));
   }
 
+  // The slots of a packed ciphertext are moved to the constant coefficients
+  RC_BOOST_FIXTURE_PROP(extractSlot, CKKSToTFHEFixture, (const bool &useLargerParam)) {
+    const seal::SEALContext &context = contexts.at(useLargerParam);
+    const auto numSteps = *rc::gen::inRange<std::size_t>(1, 16);
+    const auto values = *rc::gen::container<std::vector<double>>(
+        numSteps, rc::gen::map(rc::gen::inRange(-300000, 300000), [](int i) { return i * 0.001; }));
+
+    static std::array<seal::KeyGenerator, 2> keygens{contexts.front(), contexts.back()};
+    const auto &secretKey = keygens.at(useLargerParam).secret_key();
+    ArithHomFA::CKKSPackedEncoder packedEncoder(context);
+    seal::Encryptor encryptor(context, secretKey);
+    packedEncoder.encode(values, scale, plain);
+    seal::Ciphertext packed;
+    encryptor.encrypt_symmetric(plain, packed);
+
+    const ArithHomFA::CKKSToTFHE converter(context);
+    std::vector<seal::Ciphertext> ciphers;
+    converter.extractSlots(packed, numSteps, ciphers);
+    RC_ASSERT(ciphers.size() == numSteps);
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Decryptor decryptor(context, secretKey);
+    for (std::size_t i = 0; i < numSteps; ++i) {
+      RC_ASSERT(ciphers.at(i).parms_id() == context.get_context_data(packed.parms_id())->next_context_data()->parms_id());
+      decryptor.decrypt(ciphers.at(i), plain);
+      RC_ASSERT(std::abs(encoder.decode(plain) - values.at(i)) < minValue);
+    }
+  }
+
+  // The fast rescaling gives the same result as the bigint division at every level
+  RC_BOOST_FIXTURE_PROP(rescaleMatchesBigint, CKKSToTFHEFixture, (const bool &useLargerParam)) {
+    const seal::SEALContext &context = contexts.at(useLargerParam);
+    for (auto context_data = context.first_context_data(); context_data;
+         context_data = context_data->next_context_data()) {
+      const std::size_t size = context_data->parms().coeff_modulus().size();
+      const std::uint64_t *modulus = context_data->total_coeff_modulus();
+      const ArithHomFA::Rescaling rescaling(*context_data);
+      // Random coefficients smaller than the modulus and the ones around the boundary of the sign
+      std::vector<std::vector<std::uint64_t>> coefficients;
+      for (int i = 0; i < 100; ++i) {
+        auto coefficient = *rc::gen::container<std::vector<std::uint64_t>>(size, rc::gen::arbitrary<std::uint64_t>());
+        coefficient.back() %= modulus[size - 1];
+        coefficients.push_back(std::move(coefficient));
+      }
+      std::vector<std::uint64_t> threshold(context_data->upper_half_threshold(),
+                                           context_data->upper_half_threshold() + size);
+      coefficients.push_back(threshold);
+      seal::util::decrement_uint(threshold.data(), size, threshold.data());
+      coefficients.push_back(threshold);
+      coefficients.emplace_back(size, 0);
+      for (const auto &coefficient: coefficients) {
+        RC_ASSERT(rescaling.rescale(coefficient.data()) == rescaling.rescaleBigint(coefficient.data()));
+      }
+    }
+  }
+
+  // The conversion from the RNS representation gives the same TRLWE as the CRT composition at every level
+  RC_BOOST_FIXTURE_PROP(toLv3TRLWEMatchesComposed, CKKSToTFHEFixture, (const bool &useLargerParam)) {
+    const auto intValue =
+        *rc::gen::inRange<int64_t>(static_cast<int64_t>(-10.0 / minValue), static_cast<int64_t>(10.0 / minValue));
+    const double &value = static_cast<double>(intValue) * minValue;
+
+    const seal::SEALContext &context = contexts.at(useLargerParam);
+    seal::KeyGenerator keygen(context);
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, keygen.secret_key());
+    encoder.encode(value, scale, plain);
+    seal::Ciphertext cipher;
+    encryptor.encrypt_symmetric(plain, cipher);
+
+    const seal::Evaluator evaluator(context);
+    ArithHomFA::CKKSToTFHE converter(context);
+    while (true) {
+      TFHEpp::TRLWE<TFHEpp::lvl3param> trlwe, composed;
+      converter.toLv3TRLWE(cipher, trlwe);
+      converter.toLv3TRLWEComposed(cipher, composed);
+      RC_ASSERT(trlwe == composed);
+      if (!context.get_context_data(cipher.parms_id())->next_context_data()) {
+        break;
+      }
+      evaluator.mod_switch_to_next_inplace(cipher);
+    }
+  }
+
+  // The direct conversion to TLWE gives the same TLWE as the sample extraction from the TRLWE at every level
+  RC_BOOST_FIXTURE_PROP(toLv3TLWEMatchesSampleExtract, CKKSToTFHEFixture, (const bool &useLargerParam)) {
+    const auto intValue =
+        *rc::gen::inRange<int64_t>(static_cast<int64_t>(-10.0 / minValue), static_cast<int64_t>(10.0 / minValue));
+    const double &value = static_cast<double>(intValue) * minValue;
+
+    const seal::SEALContext &context = contexts.at(useLargerParam);
+    seal::KeyGenerator keygen(context);
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, keygen.secret_key());
+    encoder.encode(value, scale, plain);
+    seal::Ciphertext cipher;
+    encryptor.encrypt_symmetric(plain, cipher);
+
+    const seal::Evaluator evaluator(context);
+    ArithHomFA::CKKSToTFHE converter(context);
+    while (true) {
+      TFHEpp::TRLWE<TFHEpp::lvl3param> trlwe;
+      converter.toLv3TRLWEComposed(cipher, trlwe);
+      TFHEpp::TLWE<TFHEpp::lvl3param> expected, actual;
+      TFHEpp::SampleExtractIndex<TFHEpp::lvl3param>(expected, trlwe, 0);
+      converter.toLv3TLWE(cipher, actual);
+      RC_ASSERT(actual == expected);
+      if (!context.get_context_data(cipher.parms_id())->next_context_data()) {
+        break;
+      }
+      evaluator.mod_switch_to_next_inplace(cipher);
+    }
+  }
+
+  // The coefficients near the boundary of the rounding are handled by the composition
+  RC_BOOST_FIXTURE_PROP(rnsRescaleNearBoundary, CKKSToTFHEFixture, (const bool &useLargerParam)) {
+    const seal::SEALContext &context = contexts.at(useLargerParam);
+    for (auto context_data = context.first_context_data(); context_data;
+         context_data = context_data->next_context_data()) {
+      const std::size_t size = context_data->parms().coeff_modulus().size();
+      const ArithHomFA::Rescaling rescaling(*context_data);
+      const ArithHomFA::RNSRescaling rnsRescaling(*context_data);
+      // x = floor(m * Q / 2^64) and x + 1, i.e., 2^64 * x / Q is right below and above an integer
+      const auto m = *rc::gen::inRange<std::uint64_t>(1, std::numeric_limits<std::uint64_t>::max() - 2);
+      std::vector<std::uint64_t> product(size + 1);
+      seal::util::multiply_uint(context_data->total_coeff_modulus(), size, m, size + 1, product.data());
+      for (int offset = 0; offset < 2; ++offset) {
+        std::vector<std::uint64_t> coefficient(product.begin() + 1, product.end());
+        if (offset) {
+          seal::util::increment_uint(coefficient.data(), size, coefficient.data());
+        }
+        const std::uint64_t expected = rescaling.rescale(coefficient.data());
+        context_data->rns_tool()->base_q()->decompose(coefficient.data(), seal::MemoryManager::GetPool());
+        std::uint64_t actual;
+        rnsRescaling.rescale(coefficient.data(), 1, &actual);
+        RC_ASSERT(actual == expected);
+      }
+    }
+  }
+
+  // Compare the rescaling of a polynomial by the fast path and by the bigint division, and time the whole conversion
+  BOOST_FIXTURE_TEST_CASE(rescaleBenchmark, CKKSToTFHEFixture, *boost::unit_test::disabled()) {
+    const int numIterations = 100;
+    for (const seal::SEALContext &context: contexts) {
+      seal::KeyGenerator keygen(context);
+      ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+      seal::Encryptor encryptor(context, keygen.secret_key());
+      encoder.encode(1.0, scale, plain);
+      seal::Ciphertext cipher;
+      encryptor.encrypt_symmetric(plain, cipher);
+      const auto &context_data = *context.get_context_data(cipher.parms_id());
+      const std::size_t size = context_data.parms().coeff_modulus().size();
+
+      // CRT-compose the first polynomial as in toLv3TRLWE
+      seal::util::PolyIter cipherIter = seal::util::iter(cipher);
+      for (std::size_t j = 0; j < size; ++j) {
+        seal::util::inverse_ntt_negacyclic_harvey(cipherIter[0][j], context_data.small_ntt_tables()[j]);
+      }
+      context_data.rns_tool()->base_q()->compose_array(cipherIter[0], poly_modulus_degree,
+                                                        seal::MemoryManager::GetPool());
+
+      const ArithHomFA::Rescaling rescaling(context_data);
+      std::vector<std::uint64_t> result(poly_modulus_degree);
+      const auto measure = [&](auto &&f) {
+        const auto begin = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < numIterations; ++i) {
+          f();
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - begin).count() /
+               numIterations;
+      };
+      const double bigint = measure([&] {
+        for (std::size_t j = 0; j < poly_modulus_degree; ++j) {
+          result[j] = rescaling.rescaleBigint(cipher.data(0) + j * size);
+        }
+      });
+      const double fast = measure([&] { rescaling.rescale(cipher.data(0), poly_modulus_degree, result.data()); });
+
+      encryptor.encrypt_symmetric(plain, cipher);
+      ArithHomFA::CKKSToTFHE converter(context);
+      TFHEpp::TRLWE<TFHEpp::lvl3param> trlwe;
+      const double conversion = measure([&] { converter.toLv3TRLWE(cipher, trlwe); });
+      const double composed = measure([&] { converter.toLv3TRLWEComposed(cipher, trlwe); });
+      TFHEpp::TLWE<TFHEpp::lvl3param> tlwe;
+      const double extraction = measure([&] {
+        converter.toLv3TRLWE(cipher, trlwe);
+        TFHEpp::SampleExtractIndex<TFHEpp::lvl3param>(tlwe, trlwe, 0);
+      });
+      const double direct = measure([&] { converter.toLv3TLWE(cipher, tlwe); });
+      std::cout << size << " primes: rescaling a polynomial " << bigint << " us (bigint), " << fast
+                << " us (fast); toLv3TRLWE " << conversion << " us, " << composed << " us (composed); toLv3TLWE "
+                << direct << " us, " << extraction << " us (sample extraction)" << std::endl;
+    }
+  }
+
   BOOST_AUTO_TEST_SUITE_END()
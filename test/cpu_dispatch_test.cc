@@ -0,0 +1,25 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/cpu_dispatch.hpp"
+
+BOOST_AUTO_TEST_SUITE(CpuDispatchTest)
+
+  BOOST_AUTO_TEST_CASE(ParseCpuLevel) {
+    for (const CpuLevel level: {CpuLevel::SCALAR, CpuLevel::AVX2, CpuLevel::AVX512}) {
+      BOOST_CHECK(parse_cpu_level(cpu_level_name(level)) == level);
+    }
+    BOOST_CHECK(!parse_cpu_level("sse2"));
+    BOOST_CHECK(!parse_cpu_level(""));
+  }
+
+  BOOST_AUTO_TEST_CASE(CpuLevelIsSupported) {
+    BOOST_CHECK(cpu_level() <= detect_cpu_level());
+    BOOST_TEST_MESSAGE("CPU kernels: " << cpu_level_name(cpu_level()));
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
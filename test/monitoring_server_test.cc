@@ -0,0 +1,166 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+#include "archive.hpp"
+
+#include "../src/monitoring_server.hh"
+#include "../src/reverse_runner.hh"
+#include "../src/sized_cipher_writer.hh"
+#include "../src/sized_tlwe_reader.hh"
+
+BOOST_AUTO_TEST_SUITE(MonitoringServerTest)
+
+  using NormalReverseRunner = ArithHomFA::ReverseRunner<ArithHomFA::RunnerMode::normal>;
+
+  // Note: Boost.Test assertions are not thread-safe, so the clients only record the results
+  int connectTo(const std::string &path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  BOOST_AUTO_TEST_CASE(ConcurrentSessions) {
+    Graph graph = Graph::from_ltl_formula("G(p0)", 1, true);
+    const auto scale = std::pow(2, 40);
+    const ArithHomFA::SealConfig config = {
+        8192,                         // poly_modulus_degree
+        std::vector<int>{60, 40, 60}, // base_sizes
+        scale                         // scale
+    };
+    const auto &context = config.makeContext();
+
+    // Make keys
+    seal::KeyGenerator keygen(context);
+    const auto &sealKey = keygen.secret_key();
+    TFHEpp::SecretKey skey;
+    // CKKSToTFHE is necessary to make lvl3Key
+    ArithHomFA::CKKSToTFHE converter(context);
+    TFHEpp::Key<TFHEpp::lvl3param> lvl3Key;
+    converter.toLv3Key(sealKey, lvl3Key);
+    ArithHomFA::BootstrappingKey bkey(skey, lvl3Key);
+
+    // Instantiate encoder and encryptor
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, sealKey);
+
+    const std::string socketPath =
+        (std::filesystem::temp_directory_path() / ("ahomfa_server_test_" + std::to_string(getpid()))).string();
+    ArithHomFA::MonitoringServer<ArithHomFA::RunnerMode::normal> server(context, socketPath, 2, [&] {
+      return std::make_unique<NormalReverseRunner>(context, scale, graph, 10, bkey, std::vector<double>{1000});
+    });
+    std::thread serverThread([&] { server.serve(); });
+
+    const std::vector<std::vector<double>> inputs = {{100, 90, 80, 75, 60, 80, 90}, {60, 70, 80}};
+    const std::vector<std::vector<bool>> expected = {{true, true, true, true, false, false, false},
+                                                     {false, false, false}};
+    std::vector<std::thread> clients;
+    std::vector<std::vector<bool>> results(inputs.size());
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+      // Encrypt the input in the main thread because seal::Encryptor is shared
+      std::stringstream inputStream;
+      ArithHomFA::SizedCipherWriter cipherWriter{inputStream};
+      seal::Plaintext plain;
+      seal::Ciphertext cipher;
+      for (const double value: inputs.at(i)) {
+        encoder.encode(value, scale, plain);
+        encryptor.encrypt_symmetric(plain, cipher);
+        cipherWriter.write(cipher);
+      }
+      clients.emplace_back([&, i, data = inputStream.str()] {
+        const int fd = connectTo(socketPath);
+        if (fd < 0) {
+          return;
+        }
+        for (std::size_t sent = 0; sent < data.size();) {
+          const ssize_t size = write(fd, data.data() + sent, data.size() - sent);
+          if (size <= 0) {
+            break;
+          }
+          sent += size;
+        }
+        shutdown(fd, SHUT_WR);
+        std::string received;
+        char chunk[4096];
+        for (ssize_t size; (size = read(fd, chunk, sizeof(chunk))) > 0;) {
+          received.append(chunk, size);
+        }
+        close(fd);
+
+        std::stringstream outputStream{received};
+        ArithHomFA::SizedTLWEReader<TFHEpp::lvl1param> tlweReader{outputStream};
+        TFHEpp::TLWE<TFHEpp::lvl1param> result;
+        while (tlweReader.read(result)) {
+          results.at(i).push_back(decrypt_TLWELvl1_to_bit(result, skey));
+        }
+      });
+    }
+    for (auto &client: clients) {
+      client.join();
+    }
+    server.stop();
+    serverThread.join();
+
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+      BOOST_CHECK_EQUAL_COLLECTIONS(expected.at(i).begin(), expected.at(i).end(), results.at(i).begin(),
+                                    results.at(i).end());
+    }
+  }
+
+  // A record larger than a ciphertext finishes the session without buffering it
+  BOOST_AUTO_TEST_CASE(RejectTooLargeRecord) {
+    const ArithHomFA::SealConfig config = {
+        8192,                         // poly_modulus_degree
+        std::vector<int>{60, 40, 60}, // base_sizes
+        std::pow(2, 40)               // scale
+    };
+    const auto &context = config.makeContext();
+    const std::string socketPath =
+        (std::filesystem::temp_directory_path() / ("ahomfa_server_large_" + std::to_string(getpid()))).string();
+    ArithHomFA::MonitoringServer<ArithHomFA::RunnerMode::normal> server(context, socketPath, 1, [] { return nullptr; });
+    std::thread serverThread([&] { server.serve(); });
+
+    const int fd = connectTo(socketPath);
+    BOOST_REQUIRE_GE(fd, 0);
+    const uint32_t length = std::numeric_limits<uint32_t>::max();
+    BOOST_CHECK_EQUAL(write(fd, &length, sizeof(length)), static_cast<ssize_t>(sizeof(length)));
+    // The server closes the connection without waiting for the body of the record
+    char chunk[16];
+    BOOST_CHECK_EQUAL(read(fd, chunk, sizeof(chunk)), 0);
+    close(fd);
+    server.stop();
+    serverThread.join();
+  }
+
+  // The server does not remove a file other than a socket at the given path
+  BOOST_AUTO_TEST_CASE(KeepRegularFile) {
+    const ArithHomFA::SealConfig config = {
+        8192,                         // poly_modulus_degree
+        std::vector<int>{60, 40, 60}, // base_sizes
+        std::pow(2, 40)               // scale
+    };
+    const auto &context = config.makeContext();
+    const auto path = std::filesystem::temp_directory_path() / ("ahomfa_server_file_" + std::to_string(getpid()));
+    std::ofstream(path) << "not a socket";
+    using Server = ArithHomFA::MonitoringServer<ArithHomFA::RunnerMode::normal>;
+    BOOST_CHECK_THROW(Server(context, path.string(), 1, [] { return nullptr; }), std::runtime_error);
+    BOOST_CHECK(std::filesystem::is_regular_file(path));
+    std::filesystem::remove(path);
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
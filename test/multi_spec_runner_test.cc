@@ -0,0 +1,162 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "archive.hpp"
+
+#include "../src/multi_spec_runner.hh"
+
+BOOST_AUTO_TEST_SUITE(MultiSpecRunnerTest)
+
+  struct MultiSpecFixture {
+    const double scale = std::pow(2, 40);
+    const ArithHomFA::SealConfig config = {
+        8192,                         // poly_modulus_degree
+        std::vector<int>{60, 40, 60}, // base_sizes
+        scale                         // scale
+    };
+    const seal::SEALContext context = config.makeContext();
+    seal::KeyGenerator keygen{context};
+    TFHEpp::SecretKey skey;
+    ArithHomFA::CKKSNoEmbedEncoder encoder{context};
+    seal::Encryptor encryptor{context, keygen.secret_key()};
+    std::optional<ArithHomFA::BootstrappingKey> bkey;
+    // G(p0) and its negation
+    std::vector<Graph> graphs;
+
+    MultiSpecFixture() {
+      // CKKSToTFHE is necessary to make lvl3Key
+      ArithHomFA::CKKSToTFHE converter(context);
+      TFHEpp::Key<TFHEpp::lvl3param> lvl3Key;
+      converter.toLv3Key(keygen.secret_key(), lvl3Key);
+      bkey.emplace(skey, lvl3Key);
+      graphs.push_back(Graph::from_ltl_formula("G(p0)", 1, true));
+      graphs.push_back(graphs.front().negated());
+    }
+
+    seal::Ciphertext encrypt(double value) {
+      seal::Plaintext plain;
+      seal::Ciphertext cipher;
+      encoder.encode(value, scale, plain);
+      encryptor.encrypt_symmetric(plain, cipher);
+      return cipher;
+    }
+  };
+
+  BOOST_FIXTURE_TEST_CASE(Reverse, MultiSpecFixture) {
+    auto runner = ArithHomFA::makeMultiSpecReverseRunner<ArithHomFA::RunnerMode::normal>(context, scale, graphs, 10,
+                                                                                         *bkey, {1000});
+    BOOST_CHECK_EQUAL(runner.size(), 2);
+    const std::vector<double> input = {100, 90, 80, 75, 60, 80, 90};
+    const std::vector<bool> expected = {true, true, true, true, false, false, false};
+    for (std::size_t i = 0; i < input.size(); ++i) {
+      const auto results = runner.feed({encrypt(input.at(i))});
+      BOOST_REQUIRE_EQUAL(results.size(), 2);
+      BOOST_CHECK_EQUAL(expected.at(i), decrypt_TLWELvl1_to_bit(results.at(0), skey));
+      BOOST_CHECK_EQUAL(!expected.at(i), decrypt_TLWELvl1_to_bit(results.at(1), skey));
+    }
+
+    runner.printTime();
+  }
+
+  BOOST_FIXTURE_TEST_CASE(Block, MultiSpecFixture) {
+    auto runner =
+        ArithHomFA::makeMultiSpecBlockRunner<ArithHomFA::RunnerMode::normal>(context, scale, graphs, 2, *bkey, {1000});
+    const std::vector<double> input = {100, 90, 80, 60, 80, 90};
+    // The results change only after each block of two valuations
+    const std::vector<bool> expected = {true, true, true, false, false, false};
+    for (std::size_t i = 0; i < input.size(); ++i) {
+      const auto results = runner.feed({encrypt(input.at(i))});
+      BOOST_CHECK_EQUAL(expected.at(i), decrypt_TLWELvl1_to_bit(results.at(0), skey));
+      if (i % 2 == 1) {
+        BOOST_CHECK_EQUAL(!expected.at(i), decrypt_TLWELvl1_to_bit(results.at(1), skey));
+      }
+    }
+
+    runner.printTime();
+  }
+
+  BOOST_AUTO_TEST_CASE(ProductGraph) {
+    std::vector<Graph> graphs;
+    graphs.push_back(Graph::from_ltl_formula("G(p0)", 1, true));
+    graphs.push_back(Graph::from_ltl_formula("G(p0 -> F[0,2] !p0)", 1, true));
+    graphs.push_back(graphs.front().negated());
+    const Graph product = Graph::product(graphs).minimized();
+    BOOST_CHECK_EQUAL(product.num_outputs(), 3);
+
+    // The product automaton must agree with each specification on all the words up to length 8
+    for (int length = 0; length <= 8; ++length) {
+      for (uint64_t word = 0; word < (1u << length); ++word) {
+        const Graph::State state = product.transition64(product.initial_state(), word, length);
+        for (std::size_t i = 0; i < graphs.size(); ++i) {
+          const Graph::State expected = graphs.at(i).transition64(graphs.at(i).initial_state(), word, length);
+          BOOST_CHECK_EQUAL(graphs.at(i).is_final_state(expected), product.is_final_state(state, i));
+        }
+      }
+    }
+  }
+
+  BOOST_FIXTURE_TEST_CASE(ProductReverse, MultiSpecFixture) {
+    auto runner = ArithHomFA::makeProductReverseRunner<ArithHomFA::RunnerMode::normal>(context, scale, graphs, 3,
+                                                                                       *bkey, {1000});
+    BOOST_CHECK_EQUAL(runner.size(), 2);
+    const std::vector<double> input = {100, 90, 80, 75, 60, 80, 90};
+    const std::vector<bool> expected = {true, true, true, true, false, false, false};
+    for (std::size_t i = 0; i < input.size(); ++i) {
+      const auto results = runner.feed({encrypt(input.at(i))});
+      BOOST_REQUIRE_EQUAL(results.size(), 2);
+      BOOST_CHECK_EQUAL(expected.at(i), decrypt_TLWELvl1_to_bit(results.at(0), skey));
+      BOOST_CHECK_EQUAL(!expected.at(i), decrypt_TLWELvl1_to_bit(results.at(1), skey));
+    }
+
+    runner.printTime();
+  }
+
+  BOOST_FIXTURE_TEST_CASE(ProductBlock, MultiSpecFixture) {
+    auto runner =
+        ArithHomFA::makeProductBlockRunner<ArithHomFA::RunnerMode::normal>(context, scale, graphs, 2, *bkey, {1000});
+    BOOST_CHECK_EQUAL(runner.size(), 2);
+    const std::vector<double> input = {100, 90, 80, 60, 80, 90};
+    // The results change only after each block of two valuations
+    const std::vector<bool> expected = {true, true, true, false, false, false};
+    for (std::size_t i = 0; i < input.size(); ++i) {
+      const auto results = runner.feed({encrypt(input.at(i))});
+      BOOST_CHECK_EQUAL(expected.at(i), decrypt_TLWELvl1_to_bit(results.at(0), skey));
+      if (i % 2 == 1) {
+        BOOST_CHECK_EQUAL(!expected.at(i), decrypt_TLWELvl1_to_bit(results.at(1), skey));
+      }
+    }
+
+    runner.printTime();
+  }
+
+  // Compare the product automaton with the separate runners of the specifications
+  BOOST_FIXTURE_TEST_CASE(ProductBenchmark, MultiSpecFixture, *boost::unit_test::disabled()) {
+    graphs.clear();
+    for (int bound: {5, 10, 15, 20}) {
+      graphs.push_back(Graph::from_ltl_formula(fmt::format("G(p0 -> F[0,{}] !p0)", bound), 1, true));
+    }
+    auto separate = ArithHomFA::makeMultiSpecReverseRunner<ArithHomFA::RunnerMode::normal>(context, scale, graphs, 50,
+                                                                                           *bkey, {1000});
+    auto product = ArithHomFA::makeProductReverseRunner<ArithHomFA::RunnerMode::normal>(context, scale, graphs, 50,
+                                                                                        *bkey, {1000});
+    for (int i = 0; i < 200; ++i) {
+      const auto cipher = encrypt(i % 30 < 20 ? 1500 : 500);
+      const auto separateResults = separate.feed({cipher});
+      const auto productResults = product.feed({cipher});
+      for (std::size_t j = 0; j < graphs.size(); ++j) {
+        BOOST_CHECK_EQUAL(decrypt_TLWELvl1_to_bit(separateResults.at(j), skey),
+                          decrypt_TLWELvl1_to_bit(productResults.at(j), skey));
+      }
+    }
+
+    std::cout << "Separate runners:" << std::endl;
+    separate.printTime();
+    std::cout << "Product automaton:" << std::endl;
+    product.printTime();
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/backstream_dfa_runner.hpp"
+#include "../src/numa_executor.hpp"
+
+BOOST_AUTO_TEST_SUITE(NumaExecutorTest)
+
+  BOOST_AUTO_TEST_CASE(ParseCpuList) {
+    const std::vector<int> expected = {0, 1, 2, 3, 8, 10, 11};
+    BOOST_TEST(NumaExecutor::parse_cpulist("0-3,8,10-11\n") == expected, boost::test_tools::per_element());
+    BOOST_TEST(NumaExecutor::parse_cpulist("").empty());
+  }
+
+  BOOST_AUTO_TEST_CASE(ParallelForRunsEachIndexOnItsNode) {
+    NumaExecutor executor;
+    const std::size_t size = 1000;
+    const auto shards = executor.shards(size);
+    BOOST_REQUIRE_EQUAL(shards.size(), executor.num_nodes());
+    BOOST_CHECK_EQUAL(shards.front().first, 0);
+    BOOST_CHECK_EQUAL(shards.back().second, size);
+    for (int iteration = 0; iteration < 10; ++iteration) {
+      std::vector<std::atomic<int>> count(size);
+      std::vector<std::size_t> nodes(size);
+      executor.parallel_for(shards, [&](std::size_t node, std::size_t i) {
+        count.at(i)++;
+        nodes.at(i) = node;
+      });
+      for (std::size_t node = 0; node < shards.size(); ++node) {
+        for (std::size_t i = shards.at(node).first; i < shards.at(node).second; ++i) {
+          BOOST_CHECK_EQUAL(count.at(i).load(), 1);
+          BOOST_CHECK_EQUAL(nodes.at(i), node);
+        }
+      }
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE(ShardsOfSortedIndices) {
+    NumaExecutor executor;
+    const std::vector<std::size_t> indices = {0, 3, 4, 50, 99};
+    const auto shards = executor.shards(100);
+    const auto ranges = executor.shards_of(indices, 100);
+    BOOST_REQUIRE_EQUAL(ranges.size(), shards.size());
+    BOOST_CHECK_EQUAL(ranges.front().first, 0);
+    BOOST_CHECK_EQUAL(ranges.back().second, indices.size());
+    for (std::size_t node = 0; node < ranges.size(); ++node) {
+      for (std::size_t i = ranges.at(node).first; i < ranges.at(node).second; ++i) {
+        BOOST_TEST(shards.at(node).first <= indices.at(i));
+        BOOST_TEST(indices.at(i) < shards.at(node).second);
+      }
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE(RunnerWithExecutor) {
+    const Graph graph = Graph::from_ltl_formula("G(p0)", 1, true).reversed().minimized();
+    TFHEpp::SecretKey skey;
+    // No bootstrapping happens, so the evaluation key is not used
+    BackstreamDFARunner runner{graph, 100, std::nullopt, std::make_shared<EvalKey>(), false},
+        numaRunner{graph, 100, std::nullopt, std::make_shared<EvalKey>(), false};
+    numaRunner.set_executor(std::make_shared<NumaExecutor>());
+    const std::vector<bool> input = {true, true, true, true, false, true, true};
+    for (const bool b: input) {
+      const auto trgsw = encrypt_bit_to_TRGSWLvl1FFT(b, skey);
+      runner.eval(trgsw);
+      numaRunner.eval(trgsw);
+      BOOST_CHECK_EQUAL(decrypt_TLWELvl1_to_bit(runner.result(), skey),
+                        decrypt_TLWELvl1_to_bit(numaRunner.result(), skey));
+    }
+  }
+
+  // Report the scaling efficiency of the CMUX sweep with the number of the NUMA nodes
+  BOOST_AUTO_TEST_CASE(ScalingBenchmark, *boost::unit_test::disabled()) {
+    const std::size_t size = 20000;
+    const int numInputs = 10;
+    Graph::DFADelta delta;
+    std::set<Graph::State> finals;
+    for (Graph::State q = 0; q < size; ++q) {
+      delta.emplace_back(q, (q + 1) % size, (q * 7 + 3) % size);
+      if (q % 2 == 0) {
+        finals.insert(q);
+      }
+    }
+    const Graph graph{0, finals, delta};
+    TFHEpp::SecretKey skey;
+    const auto trgsw = encrypt_bit_to_TRGSWLvl1FFT(true, skey);
+
+    double baseline = 0;
+    const std::size_t maxNodes = std::max<std::size_t>(NumaExecutor::detect_nodes().size(), 1);
+    for (std::size_t numNodes = 1; numNodes <= maxNodes; ++numNodes) {
+      BackstreamDFARunner runner{graph, 100, std::nullopt, std::make_shared<EvalKey>(), false};
+      runner.set_executor(std::make_shared<NumaExecutor>(numNodes));
+      const auto begin = std::chrono::high_resolution_clock::now();
+      for (int i = 0; i < numInputs; ++i) {
+        runner.eval(trgsw);
+      }
+      const double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+      if (numNodes == 1) {
+        baseline = elapsed;
+      }
+      std::cout << numNodes << " node(s): " << elapsed / numInputs << " s/input, scaling efficiency "
+                << baseline / (elapsed * numNodes) << std::endl;
+    }
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
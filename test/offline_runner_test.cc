@@ -3,9 +3,15 @@
  * @date 2023/06/22.
  */
 
+#include <ranges>
+#include <sstream>
+
 #include <boost/test/unit_test.hpp>
 
+#include "../src/ckks_packed_encoder.hh"
 #include "../src/offline_runner.hh"
+#include "../src/sized_cipher_reader.hh"
+#include "../src/sized_cipher_writer.hh"
 
 BOOST_AUTO_TEST_SUITE(OfflineRunnerTest)
 
@@ -59,4 +65,171 @@ BOOST_AUTO_TEST_SUITE(OfflineRunnerTest)
 
     runner.printTime();
   }
+
+  BOOST_AUTO_TEST_CASE(EvalGloballyBatch) {
+    Graph graph = Graph::from_ltl_formula("G(p0)", 1, true);
+    const auto scale = std::pow(2, 40);
+    const ArithHomFA::SealConfig config = {
+        8192,                         // poly_modulus_degree
+        std::vector<int>{60, 40, 60}, // base_sizes
+        scale                         // scale
+    };
+    const auto &context = config.makeContext();
+
+    // Make keys
+    seal::KeyGenerator keygen(context);
+    const auto& sealKey = keygen.secret_key();
+    TFHEpp::SecretKey skey;
+    // CKKSToTFHE is necessary to make lvl3Key
+    ArithHomFA::CKKSToTFHE converter(context);
+    TFHEpp::Key<TFHEpp::lvl3param> lvl3Key;
+    converter.toLv3Key(sealKey, lvl3Key);
+    std::uniform_int_distribution<int32_t> lvlhalfgen(0, 1);
+    static const TFHEpp::Key<typename ArithHomFA::BootstrappingKey::mid2lowP::targetP> lvlhalfkey{
+        keyGen<typename ArithHomFA::BootstrappingKey::mid2lowP::targetP>(lvlhalfgen)};
+    ArithHomFA::BootstrappingKey bkey(skey, lvl3Key, lvlhalfkey);
+
+    // Instantiate encoder and encryptor
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, sealKey);
+
+    std::vector<double> input = {100, 90, 80, 75, 60, 80, 90};
+    ArithHomFA::OfflineRunner<ArithHomFA::RunnerMode::normal> runner{context, scale, graph, input.size(), 10, bkey, {1000}};
+    std::vector<bool> expected = {true, true, true, true, false, false, false};
+    std::vector<seal::Ciphertext> ciphers(input.size());
+    seal::Plaintext plain;
+    for (std::size_t i = 0; i < input.size(); ++i) {
+      encoder.encode(input.at(i), scale, plain);
+      encryptor.encrypt_symmetric(plain, ciphers.at(i));
+    }
+    // Feed the first three time steps and then the rest
+    std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>> results = runner.feedBatch({ciphers.begin(), ciphers.begin() + 3});
+    for (const auto &result: runner.feedBatch({ciphers.begin() + 3, ciphers.end()})) {
+      results.push_back(result);
+    }
+    BOOST_REQUIRE_EQUAL(expected.size(), results.size());
+    for (std::size_t i = 0; i < input.size(); ++i) {
+      BOOST_CHECK_EQUAL(expected.at(i), decrypt_TLWELvl1_to_bit(results.at(i), skey));
+    }
+
+    runner.printTime();
+  }
+
+  BOOST_AUTO_TEST_CASE(EvalGloballyPacked) {
+    Graph graph = Graph::from_ltl_formula("G(p0)", 1, true);
+    const auto scale = std::pow(2, 40);
+    // One more level is necessary to extract the slots
+    const ArithHomFA::SealConfig config = {
+        8192,                             // poly_modulus_degree
+        std::vector<int>{60, 40, 40, 60}, // base_sizes
+        scale                             // scale
+    };
+    const auto &context = config.makeContext();
+
+    // Make keys
+    seal::KeyGenerator keygen(context);
+    const auto& sealKey = keygen.secret_key();
+    TFHEpp::SecretKey skey;
+    // CKKSToTFHE is necessary to make lvl3Key
+    ArithHomFA::CKKSToTFHE converter(context);
+    TFHEpp::Key<TFHEpp::lvl3param> lvl3Key;
+    converter.toLv3Key(sealKey, lvl3Key);
+    std::uniform_int_distribution<int32_t> lvlhalfgen(0, 1);
+    static const TFHEpp::Key<typename ArithHomFA::BootstrappingKey::mid2lowP::targetP> lvlhalfkey{
+        keyGen<typename ArithHomFA::BootstrappingKey::mid2lowP::targetP>(lvlhalfgen)};
+    ArithHomFA::BootstrappingKey bkey(skey, lvl3Key, lvlhalfkey);
+
+    // The time steps are packed from front to back, and they are fed from back to front
+    std::vector<double> input = {100, 90, 80, 75, 60, 80, 90};
+    std::vector<double> packedInput(input.rbegin(), input.rend());
+    ArithHomFA::CKKSPackedEncoder encoder(context);
+    seal::Encryptor encryptor(context, sealKey);
+    seal::Plaintext plain;
+    seal::Ciphertext cipher;
+    encoder.encode(packedInput, scale, plain);
+    encryptor.encrypt_symmetric(plain, cipher);
+
+    ArithHomFA::OfflineRunner<ArithHomFA::RunnerMode::normal> runner{context, scale, graph, input.size(), 10, bkey, {1000}};
+    std::vector<bool> expected = {true, true, true, true, false, false, false};
+    const auto results = runner.feedPacked({cipher}, input.size());
+    BOOST_REQUIRE_EQUAL(expected.size(), results.size());
+    for (std::size_t i = 0; i < input.size(); ++i) {
+      BOOST_CHECK_EQUAL(expected.at(i), decrypt_TLWELvl1_to_bit(results.at(i), skey));
+    }
+
+    runner.printTime();
+  }
+  BOOST_AUTO_TEST_CASE(EvalGloballyPackedPartialBatch) {
+    Graph graph = Graph::from_ltl_formula("G(p0)", 1, true);
+    const auto scale = std::pow(2, 40);
+    // One more level is necessary to extract the slots
+    const ArithHomFA::SealConfig config = {
+        8192,                             // poly_modulus_degree
+        std::vector<int>{60, 40, 40, 60}, // base_sizes
+        scale                             // scale
+    };
+    const auto &context = config.makeContext();
+
+    // Make keys
+    seal::KeyGenerator keygen(context);
+    const auto& sealKey = keygen.secret_key();
+    TFHEpp::SecretKey skey;
+    // CKKSToTFHE is necessary to make lvl3Key
+    ArithHomFA::CKKSToTFHE converter(context);
+    TFHEpp::Key<TFHEpp::lvl3param> lvl3Key;
+    converter.toLv3Key(sealKey, lvl3Key);
+    std::uniform_int_distribution<int32_t> lvlhalfgen(0, 1);
+    static const TFHEpp::Key<typename ArithHomFA::BootstrappingKey::mid2lowP::targetP> lvlhalfkey{
+        keyGen<typename ArithHomFA::BootstrappingKey::mid2lowP::targetP>(lvlhalfgen)};
+    ArithHomFA::BootstrappingKey bkey(skey, lvl3Key, lvlhalfkey);
+    seal::Encryptor encryptor(context, sealKey);
+    seal::Plaintext plain;
+    seal::Ciphertext cipher;
+
+    // The length of the trace is not a multiple of pack, so the last batch has only one time step
+    const std::vector<double> input = {100, 90, 80, 75, 60, 80, 90};
+    constexpr std::size_t pack = 3;
+
+    // The results without packing, where the time steps are fed from back to front as in ahomfa_runner offline
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    ArithHomFA::OfflineRunner<ArithHomFA::RunnerMode::normal> runner{context, scale, graph, input.size(), 10, bkey, {1000}};
+    std::vector<bool> expected;
+    for (const double value: std::ranges::reverse_view(input)) {
+      encoder.encode(value, scale, plain);
+      encryptor.encrypt_symmetric(plain, cipher);
+      expected.push_back(decrypt_TLWELvl1_to_bit(runner.feed({cipher}), skey));
+    }
+
+    // Write the batches with their headers as in ahomfa_util ckks enc --pack
+    ArithHomFA::CKKSPackedEncoder packedEncoder(context);
+    std::stringstream stream;
+    ArithHomFA::SizedCipherWriter writer{stream};
+    for (std::size_t begin = 0; begin < input.size(); begin += pack) {
+      const std::vector<double> batch(input.begin() + begin, input.begin() + std::min(begin + pack, input.size()));
+      writer.writeHeader(ArithHomFA::PackedBatchHeader::make(batch.size()));
+      packedEncoder.encode(batch, scale, plain);
+      encryptor.encrypt_symmetric(plain, cipher);
+      writer.write(cipher);
+    }
+    ArithHomFA::SizedCipherReader reader{stream};
+    std::vector<std::pair<std::size_t, seal::Ciphertext>> batches;
+    for (ArithHomFA::PackedBatchHeader header{}; reader.readHeader(header);) {
+      header.validate(pack);
+      BOOST_REQUIRE(reader.read(context, cipher));
+      batches.emplace_back(header.numSteps, cipher);
+    }
+    BOOST_REQUIRE_EQUAL(3, batches.size());
+    BOOST_CHECK_EQUAL(1, batches.back().first);
+
+    // Only the recorded time steps are fed
+    ArithHomFA::OfflineRunner<ArithHomFA::RunnerMode::normal> packedRunner{context, scale, graph, input.size(), 10,
+                                                                           bkey, {1000}};
+    std::vector<bool> results;
+    for (const auto &[numSteps, packed]: std::ranges::reverse_view(batches)) {
+      for (const auto &result: packedRunner.feedPacked({packed}, numSteps)) {
+        results.push_back(decrypt_TLWELvl1_to_bit(result, skey));
+      }
+    }
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), results.begin(), results.end());
+  }
 BOOST_AUTO_TEST_SUITE_END()
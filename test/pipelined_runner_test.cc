@@ -0,0 +1,75 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#include <sstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include "archive.hpp"
+
+#include "../src/pipelined_runner.hh"
+#include "../src/sized_cipher_writer.hh"
+#include "../src/sized_tlwe_reader.hh"
+
+BOOST_AUTO_TEST_SUITE(PipelinedRunnerTest)
+
+  using NormalPipelinedRunner = ArithHomFA::PipelinedReverseRunner<ArithHomFA::RunnerMode::normal>;
+
+  BOOST_AUTO_TEST_CASE(EvalGlobally) {
+    Graph graph = Graph::from_ltl_formula("G(p0)", 1, true);
+    const auto scale = std::pow(2, 40);
+    const ArithHomFA::SealConfig config = {
+        8192,                         // poly_modulus_degree
+        std::vector<int>{60, 40, 60}, // base_sizes
+        scale                         // scale
+    };
+    const auto &context = config.makeContext();
+
+    // Make keys
+    seal::KeyGenerator keygen(context);
+    const auto &sealKey = keygen.secret_key();
+    TFHEpp::SecretKey skey;
+    // CKKSToTFHE is necessary to make lvl3Key
+    ArithHomFA::CKKSToTFHE converter(context);
+    TFHEpp::Key<TFHEpp::lvl3param> lvl3Key;
+    converter.toLv3Key(sealKey, lvl3Key);
+    ArithHomFA::BootstrappingKey bkey(skey, lvl3Key);
+
+    // Instantiate encoder and encryptor
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, sealKey);
+
+    // Encrypt the input
+    std::vector<double> input = {100, 90, 80, 75, 60, 80, 90};
+    std::stringstream inputStream;
+    ArithHomFA::SizedCipherWriter cipherWriter{inputStream};
+    seal::Plaintext plain;
+    seal::Ciphertext cipher;
+    for (const double value: input) {
+      encoder.encode(value, scale, plain);
+      encryptor.encrypt_symmetric(plain, cipher);
+      cipherWriter.write(cipher);
+    }
+
+    // Run the monitor with a small queue so that the stages block each other
+    NormalPipelinedRunner runner{context, scale, graph, 10, bkey, {1000}, 2};
+    std::stringstream outputStream;
+    ArithHomFA::SizedCipherReader cipherReader{inputStream};
+    ArithHomFA::SizedTLWEWriter<TFHEpp::lvl1param> tlweWriter{outputStream};
+    runner.run(context, cipherReader, tlweWriter);
+
+    std::vector<bool> expected = {true, true, true, true, false, false, false};
+    ArithHomFA::SizedTLWEReader<TFHEpp::lvl1param> tlweReader{outputStream};
+    TFHEpp::TLWE<TFHEpp::lvl1param> result;
+    for (const bool expectedBit: expected) {
+      BOOST_REQUIRE(tlweReader.read(result));
+      BOOST_CHECK_EQUAL(expectedBit, decrypt_TLWELvl1_to_bit(result, skey));
+    }
+    BOOST_CHECK(!tlweReader.read(result));
+
+    runner.printTime();
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
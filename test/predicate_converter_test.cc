@@ -0,0 +1,109 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#include <filesystem>
+#include <fstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include "archive.hpp"
+
+#include "../src/offline_runner.hh"
+#include "../src/predicate_converter.hh"
+#include "../src/reverse_runner.hh"
+
+BOOST_AUTO_TEST_SUITE(PredicateConverterTest)
+
+  using NormalConverter = ArithHomFA::PredicateConverter<ArithHomFA::RunnerMode::normal>;
+
+  BOOST_AUTO_TEST_CASE(ConvertAndMonitor) {
+    Graph graph = Graph::from_ltl_formula("G(p0)", 1, true);
+    const auto scale = std::pow(2, 40);
+    const ArithHomFA::SealConfig config = {
+        8192,                         // poly_modulus_degree
+        std::vector<int>{60, 40, 60}, // base_sizes
+        scale                         // scale
+    };
+    const auto &context = config.makeContext();
+
+    // Make keys
+    seal::KeyGenerator keygen(context);
+    const auto &sealKey = keygen.secret_key();
+    TFHEpp::SecretKey skey;
+    // CKKSToTFHE is necessary to make lvl3Key
+    ArithHomFA::CKKSToTFHE converter(context);
+    TFHEpp::Key<TFHEpp::lvl3param> lvl3Key;
+    converter.toLv3Key(sealKey, lvl3Key);
+    ArithHomFA::BootstrappingKey bkey(skey, lvl3Key);
+
+    // Instantiate encoder and encryptor
+    ArithHomFA::CKKSNoEmbedEncoder encoder(context);
+    seal::Encryptor encryptor(context, sealKey);
+
+    // Convert the input to TRGSW and save them
+    const std::vector<double> input = {100, 90, 80, 75, 60, 80, 90};
+    const auto path = std::filesystem::temp_directory_path() / "ahomfa_predicate_converter_test.trgsw";
+    {
+      NormalConverter predicateConverter{context, scale, bkey, {1000}};
+      std::ofstream stream{path, std::ios::binary};
+      TRGSWLvl1FFTSerializer serializer{stream};
+      seal::Plaintext plain;
+      seal::Ciphertext cipher;
+      std::vector<TRGSWLvl1FFT> trgsws;
+      for (const double value: input) {
+        encoder.encode(value, scale, plain);
+        encryptor.encrypt_symmetric(plain, cipher);
+        predicateConverter.convert({cipher}, trgsws);
+        BOOST_REQUIRE_EQUAL(trgsws.size(), 1);
+        serializer.save(trgsws.front());
+      }
+    }
+
+    // Monitor with the reverse algorithm
+    {
+      const std::vector<bool> expected = {true, true, true, true, false, false, false};
+      ArithHomFA::ReverseRunner<ArithHomFA::RunnerMode::normal> runner{context, scale, graph, 10, bkey, {1000}};
+      TRGSWLvl1InputStreamFromCtxtFile stream{path};
+      BOOST_REQUIRE_EQUAL(stream.size(), input.size());
+      for (const bool expectedBit: expected) {
+        BOOST_CHECK_EQUAL(expectedBit, decrypt_TLWELvl1_to_bit(runner.feedRaw({stream.next()}), skey));
+      }
+    }
+
+    // Monitor with the offline algorithm from the end of the trace
+    {
+      // The trace is read as 90, 80, 60, 75, 80, 90, 100
+      const std::vector<bool> expected = {true, true, false, false, false, false, false};
+      ArithHomFA::OfflineRunner<ArithHomFA::RunnerMode::normal> runner{context, scale, graph, input.size(), 10, bkey,
+                                                                      {1000}};
+      ReversedTRGSWLvl1InputStreamFromCtxtFile stream{path};
+      BOOST_REQUIRE_EQUAL(stream.size(), input.size());
+      for (const bool expectedBit: expected) {
+        BOOST_CHECK_EQUAL(expectedBit, decrypt_TLWELvl1_to_bit(runner.feedRaw({stream.next()}), skey));
+      }
+    }
+    std::filesystem::remove(path);
+  }
+
+  // The conversion with the references is rejected before it divides by the number of the references
+  BOOST_AUTO_TEST_CASE(RejectEmptyReferences) {
+    const ArithHomFA::SealConfig config = {
+        8192,                         // poly_modulus_degree
+        std::vector<int>{60, 40, 60}, // base_sizes
+        std::pow(2, 40)               // scale
+    };
+    const auto &context = config.makeContext();
+    const ArithHomFA::CKKSToTFHE converter(context);
+    const std::vector<seal::Ciphertext> ckksCiphers(1);
+    std::vector<TRGSWLvl1FFT> trgsws;
+    BOOST_CHECK_THROW(ArithHomFA::AbstractRunner<ArithHomFA::RunnerMode::normal>::toLv1TRGSWFFTs(converter, ckksCiphers,
+                                                                                                trgsws, {}),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(ArithHomFA::AbstractRunner<ArithHomFA::RunnerMode::fast>::toLv1TRGSWFFTs(converter, ckksCiphers,
+                                                                                              trgsws, {}),
+                      std::invalid_argument);
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,12 @@
  * @date 2023/06/23.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <numeric>
+#include <random>
+
 #include <boost/test/unit_test.hpp>
 
 #include "archive.hpp"
@@ -25,6 +31,36 @@ BOOST_AUTO_TEST_SUITE(ReverseRunnerTest)
     ArithHomFA::CKKSNoEmbedEncoder encoder{context};
   };
 
+  BOOST_AUTO_TEST_CASE(SkippedStates) {
+    // 0 goes to the rejecting sink 1 with 0 and to the accepting sink 2 with 1. 3 is unreachable.
+    const Graph graph{0, {2, 3}, {{0, 1, 2}, {1, 1, 1}, {2, 2, 2}, {3, 0, 3}}};
+    const std::vector<bool> expectedConstant = {false, true, true, false};
+    const std::vector<bool> expectedReachable = {true, true, true, false};
+    BOOST_TEST(graph.constant_states() == expectedConstant, boost::test_tools::per_element());
+    BOOST_TEST(graph.reachable_states() == expectedReachable, boost::test_tools::per_element());
+
+    // Only the initial state is not constant in the reversed G(p0)
+    const Graph reversed = Graph::from_ltl_formula("G(p0)", 1, true).reversed().minimized();
+    const auto constant = reversed.constant_states();
+    for (Graph::State q = 0; q < reversed.size(); ++q) {
+      BOOST_CHECK_EQUAL(constant.at(q), q != reversed.initial_state());
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE(BfsOrdered) {
+    const Graph graph = Graph::from_ltl_formula("G(p0 -> F[0,5] !p0)", 1, true).reversed().minimized();
+    const Graph ordered = graph.bfs_ordered();
+    BOOST_CHECK_EQUAL(ordered.size(), graph.size());
+    BOOST_CHECK_EQUAL(ordered.initial_state(), 0);
+    // The states are renumbered without changing the language
+    for (int length = 0; length <= 8; ++length) {
+      for (uint64_t word = 0; word < (1u << length); ++word) {
+        BOOST_CHECK_EQUAL(graph.is_final_state(graph.transition64(graph.initial_state(), word, length)),
+                          ordered.is_final_state(ordered.transition64(ordered.initial_state(), word, length)));
+      }
+    }
+  }
+
   BOOST_AUTO_TEST_CASE(EvalGlobally) {
     Graph graph = Graph::from_ltl_formula("G(p0)", 1, true);
     const auto scale = std::pow(2, 40);
@@ -353,4 +389,58 @@ BOOST_AUTO_TEST_SUITE(ReverseRunnerTest)
 
     runner.printTime();
   }
+
+  // Compare the CMUX sweep over the weights indexed by the original state ids with BackstreamDFARunner, which
+  // renumbers the states in the BFS order and keeps the weights in an aligned array
+  BOOST_AUTO_TEST_CASE(WeightLayoutBenchmark, *boost::unit_test::disabled()) {
+    TFHEpp::SecretKey skey;
+    const TRGSWLvl1FFT input = encrypt_bit_to_TRGSWLvl1FFT(true, skey);
+    const int numInputs = 10;
+    std::mt19937 engine(0);
+    for (std::size_t size: {100, 1000, 10000, 100000}) {
+      // Each state moves to nearby states, but the state ids are shuffled
+      std::vector<Graph::State> ids(size);
+      std::iota(ids.begin(), ids.end(), 0);
+      std::shuffle(ids.begin(), ids.end(), engine);
+      std::uniform_int_distribution<std::size_t> offset(1, 4);
+      Graph::DFADelta delta(size);
+      std::set<Graph::State> finals;
+      for (std::size_t i = 0; i < size; ++i) {
+        delta.at(ids.at(i)) = {ids.at(i), ids.at((i + 1) % size), ids.at((i + offset(engine)) % size)};
+        if (i % 2 == 0) {
+          finals.insert(ids.at(i));
+        }
+      }
+      const Graph graph{ids.at(0), finals, delta};
+
+      std::chrono::microseconds before, after;
+      {
+        std::vector<TRLWELvl1> weight(size, trivial_TRLWELvl1_zero()), out(size);
+        const auto states = graph.all_states();
+        const auto begin = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < numInputs; ++i) {
+          std::for_each(std::execution::par, states.begin(), states.end(), [&](Graph::State q) {
+            TFHEpp::CMUXFFT<Lvl1>(out.at(q), input, weight.at(graph.next_state(q, true)),
+                                  weight.at(graph.next_state(q, false)));
+          });
+          std::swap(weight, out);
+        }
+        before = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() -
+                                                                       begin);
+      }
+      {
+        // No bootstrapping happens, so the evaluation key is not used
+        BackstreamDFARunner runner{graph, std::numeric_limits<std::size_t>::max(), std::nullopt,
+                                   std::make_shared<EvalKey>(), false};
+        const auto begin = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < numInputs; ++i) {
+          runner.eval(input);
+        }
+        after = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() -
+                                                                      begin);
+      }
+      std::cout << size << " states: " << before.count() / numInputs << " us/input in the original order, "
+                << after.count() / numInputs << " us/input in the BFS order" << std::endl;
+    }
+  }
 BOOST_AUTO_TEST_SUITE_END()
@@ -158,4 +158,21 @@ BOOST_AUTO_TEST_SUITE(Lvl3ToLvl1Test)
     }
   }
 
+  BOOST_FIXTURE_TEST_CASE(identityKeySwitchMid2Low, Lvl3ToLvl1TestFixture) {
+    using P = ArithHomFA::BootstrappingKey::mid2lowP;
+    constexpr auto numtest = 10;
+    std::uniform_int_distribution<typename P::domainP::T> coefficientgen;
+    for (uint test = 0; test < numtest; test++) {
+      TFHEpp::TLWE<typename P::domainP> input;
+      for (auto &coefficient: input) {
+        coefficient = coefficientgen(TFHEpp::generator);
+      }
+      // The multiversioned loop must be identical to the one of TFHEpp
+      TFHEpp::TLWE<typename P::targetP> expected, result;
+      TFHEpp::IdentityKeySwitch<P>(expected, input, *bootKey.kskm2l);
+      ArithHomFA::Lvl3ToLvl1::identityKeySwitchMid2Low(result, input, *bootKey.kskm2l);
+      BOOST_TEST(expected == result, boost::test_tools::per_element());
+    }
+  }
+
   BOOST_AUTO_TEST_SUITE_END()
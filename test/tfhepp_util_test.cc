@@ -0,0 +1,165 @@
+/**
+ * @author Masaki Waga
+ * @date 2026/10/16.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <numeric>
+
+#include <boost/test/unit_test.hpp>
+#include <rapidcheck/boost_test.h>
+
+#include "../src/tfhepp_util.hpp"
+
+BOOST_AUTO_TEST_SUITE(TFHEppUtilTest)
+
+  BOOST_AUTO_TEST_CASE(PlanCMUXBatch) {
+    // 0, 1, and 3 share the children, and 2 has identical children
+    const std::vector<std::pair<size_t, size_t>> children = {{1, 2}, {1, 2}, {3, 3}, {1, 2}};
+    const std::vector<size_t> states = {0, 1, 2, 3};
+    const auto batch = CMUXBatch::plan(states, [&](size_t q) { return children.at(q); });
+    const std::vector<size_t> expectedCMUXStates = {0};
+    const std::vector<std::pair<size_t, size_t>> expectedOutputCopies = {{1, 0}, {3, 0}};
+    const std::vector<std::pair<size_t, size_t>> expectedInputCopies = {{2, 3}};
+    BOOST_TEST(batch.cmux_states == expectedCMUXStates, boost::test_tools::per_element());
+    BOOST_TEST(batch.copies_of_output == expectedOutputCopies, boost::test_tools::per_element());
+    BOOST_TEST(batch.copies_of_input == expectedInputCopies, boost::test_tools::per_element());
+    BOOST_CHECK_EQUAL(batch.num_states(), states.size());
+  }
+
+  // The batched CMUX gives the same plaintexts as the CMUX of each state
+  RC_BOOST_PROP(BatchCMUXMatchesCMUX, ()) {
+    const auto size = *rc::gen::inRange<size_t>(1, 16);
+    const auto children =
+        *rc::gen::container<std::vector<std::pair<size_t, size_t>>>(
+            size, rc::gen::pair(rc::gen::inRange<size_t>(0, size), rc::gen::inRange<size_t>(0, size)));
+    const bool bit = *rc::gen::arbitrary<bool>();
+
+    SecretKey skey;
+    TRLWELvl1Vector weight(size);
+    for (size_t q = 0; q < size; ++q) {
+      PolyLvl1 plain;
+      for (size_t i = 0; i < Lvl1::n; ++i) {
+        plain[i] = (q + i) % 2 == 0 ? 0 : (1u << 31);
+      }
+      weight.at(q) = TFHEpp::trlweSymEncrypt<Lvl1>(plain, Lvl1::α, skey.key.lvl1);
+    }
+    const TRGSWLvl1FFT input = encrypt_bit_to_TRGSWLvl1FFT(bit, skey);
+
+    std::vector<size_t> states(size);
+    std::iota(states.begin(), states.end(), 0);
+    const auto batch = CMUXBatch::plan(states, [&](size_t q) { return children.at(q); });
+    RC_ASSERT(batch.num_states() == size);
+    TRLWELvl1Vector out(size);
+    batch_CMUXFFT(out, input, weight, batch);
+
+    for (size_t q = 0; q < size; ++q) {
+      const PolyLvl1 expected = phase_of_TRLWELvl1(weight.at(bit ? children.at(q).second : children.at(q).first), skey);
+      const PolyLvl1 actual = phase_of_TRLWELvl1(out.at(q), skey);
+      for (size_t i = 0; i < Lvl1::n; ++i) {
+        // Compare the plaintexts in {0, 1/2}
+        RC_ASSERT(((expected[i] + (1u << 30)) >> 31) == ((actual[i] + (1u << 30)) >> 31));
+      }
+    }
+  }
+
+  namespace {
+    // The levels of the kernels available on this machine
+    std::vector<CpuLevel> supportedCpuLevels() {
+      std::vector<CpuLevel> levels;
+      for (const CpuLevel level: {CpuLevel::SCALAR, CpuLevel::AVX2, CpuLevel::AVX512}) {
+        if (level <= detect_cpu_level()) {
+          levels.push_back(level);
+        }
+      }
+      return levels;
+    }
+
+    TRLWELvl1 randomTRLWELvl1() {
+      TRLWELvl1 c;
+      for (auto &poly: c) {
+        for (auto &coef: poly) {
+          coef = *rc::gen::arbitrary<uint32_t>();
+        }
+      }
+      return c;
+    }
+  } // namespace
+
+  // The fused rotate-and-accumulate kernels agree with the rotation followed by the addition
+  RC_BOOST_PROP(AddMultXkMatchesMultXk, ()) {
+    const TRLWELvl1 src = randomTRLWELvl1(), out = randomTRLWELvl1();
+    const auto k = *rc::gen::inRange<size_t>(0, 2 * Lvl1::n);
+
+    TRLWELvl1 rotated, expected = out;
+    TRLWELvl1_mult_X_k(rotated, src, k);
+    for (size_t i = 0; i < Lvl1::k + 1; ++i) {
+      for (size_t j = 0; j < Lvl1::n; ++j) {
+        expected[i][j] += rotated[i][j];
+      }
+    }
+    for (const CpuLevel level: supportedCpuLevels()) {
+      TRLWELvl1 actual = out;
+      TRLWELvl1_add_mult_X_k(actual, src, k, level);
+      RC_ASSERT(actual == expected);
+    }
+  }
+
+  RC_BOOST_PROP(AddMatchesScalarAdd, ()) {
+    const TRLWELvl1 src = randomTRLWELvl1(), out = randomTRLWELvl1();
+    TRLWELvl1 expected = out;
+    for (size_t i = 0; i < Lvl1::k + 1; ++i) {
+      for (size_t j = 0; j < Lvl1::n; ++j) {
+        expected[i][j] += src[i][j];
+      }
+    }
+    for (const CpuLevel level: supportedCpuLevels()) {
+      TRLWELvl1 actual = out;
+      TRLWELvl1_add(actual, src, level);
+      RC_ASSERT(actual == expected);
+    }
+  }
+
+  // Compare the fused kernel with the rotation followed by the addition, as in the first LUT step of
+  // OnlineDFARunner3::eval_queued_inputs
+  BOOST_AUTO_TEST_CASE(AddMultXkBenchmark, *boost::unit_test::disabled()) {
+    const int numIterations = 1000000;
+    TRLWELvl1 src{}, out{};
+    const auto measure = [&](auto &&f) {
+      const auto begin = std::chrono::high_resolution_clock::now();
+      for (int i = 0; i < numIterations; ++i) {
+        f(static_cast<size_t>(i * 7) % (2 * Lvl1::n));
+      }
+      return std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - begin).count() /
+             numIterations;
+    };
+    const double separated = measure([&](size_t k) {
+      TRLWELvl1 c;
+      TRLWELvl1_mult_X_k(c, src, k);
+      TRLWELvl1_add(out, c, CpuLevel::SCALAR);
+    });
+    std::cout << "mult_X_k + add: " << separated << " ns" << std::endl;
+    for (const CpuLevel level: supportedCpuLevels()) {
+      const double fused = measure([&](size_t k) { TRLWELvl1_add_mult_X_k(out, src, k, level); });
+      std::cout << "add_mult_X_k (" << cpu_level_name(level) << "): " << fused << " ns" << std::endl;
+    }
+    std::cout << "(" << out[0][0] << ")" << std::endl;
+  }
+
+  BOOST_AUTO_TEST_CASE(AddBenchmark, *boost::unit_test::disabled()) {
+    const int numIterations = 1000000;
+    TRLWELvl1 src{}, out{};
+    for (const CpuLevel level: supportedCpuLevels()) {
+      const auto begin = std::chrono::high_resolution_clock::now();
+      for (int i = 0; i < numIterations; ++i) {
+        TRLWELvl1_add(out, src, level);
+      }
+      const double elapsed =
+          std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - begin).count();
+      std::cout << "add (" << cpu_level_name(level) << "): " << elapsed / numIterations << " ns (" << out[0][0]
+                << ")" << std::endl;
+    }
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <chrono>
 #include <sstream>
 
 #include <boost/test/unit_test.hpp>
@@ -5,8 +7,10 @@
 
 #include "tfhe++.hpp"
 
+#include "raw_tlwe_writer.hh"
 #include "sized_tlwe_reader.hh"
 #include "sized_tlwe_writer.hh"
+#include "tlwe_reader.hh"
 
 BOOST_AUTO_TEST_SUITE(TLWEReaderWriterTest)
 
@@ -26,4 +30,128 @@ BOOST_AUTO_TEST_SUITE(TLWEReaderWriterTest)
     }
   }
 
+  // TLWEReader reads both the sized and the raw formats
+  RC_BOOST_PROP(writeAndReadDetected,
+                (const std::vector<TFHEpp::TLWE<TFHEpp::lvl1param>> &given, const bool &raw, const uint8_t &batchSize)) {
+    std::stringstream stream;
+    if (raw) {
+      ArithHomFA::RawTLWEWriter<TFHEpp::lvl1param> writer{stream, batchSize};
+      for (const auto &tlwe: given) {
+        writer.write(tlwe);
+      }
+    } else {
+      ArithHomFA::SizedTLWEWriter<TFHEpp::lvl1param> writer{stream};
+      for (const auto &tlwe: given) {
+        writer.write(tlwe);
+      }
+    }
+
+    ArithHomFA::TLWEReader<TFHEpp::lvl1param> reader{stream};
+    TFHEpp::TLWE<TFHEpp::lvl1param> result;
+    for (const auto &tlwe: given) {
+      RC_ASSERT(reader.read(result));
+      RC_ASSERT(std::equal(tlwe.begin(), tlwe.end(), result.begin()));
+    }
+    RC_ASSERT(!reader.read(result));
+  }
+
+  BOOST_AUTO_TEST_CASE(rejectOtherParameter) {
+    std::stringstream stream;
+    {
+      ArithHomFA::RawTLWEWriter<TFHEpp::lvl0param> writer{stream};
+      writer.write(TFHEpp::TLWE<TFHEpp::lvl0param>{});
+    }
+    ArithHomFA::TLWEReader<TFHEpp::lvl1param> reader{stream};
+    TFHEpp::TLWE<TFHEpp::lvl1param> result;
+    BOOST_CHECK_THROW(reader.read(result), std::runtime_error);
+  }
+
+  // A stream buffer accepting only the first capacity bytes, e.g., of a full disk
+  class LimitedBuffer : public std::streambuf {
+  public:
+    explicit LimitedBuffer(std::size_t capacity) : capacity(capacity) {
+    }
+
+  protected:
+    std::streamsize xsputn(const char *, std::streamsize count) override {
+      const auto written = std::min(count, static_cast<std::streamsize>(capacity));
+      capacity -= written;
+      return written;
+    }
+
+    int_type overflow(int_type ch) override {
+      if (capacity == 0) {
+        return traits_type::eof();
+      }
+      --capacity;
+      return traits_type::not_eof(ch);
+    }
+
+  private:
+    std::size_t capacity;
+  };
+
+  // The failure to write the header is reported by the constructor
+  BOOST_AUTO_TEST_CASE(constructorReportsError) {
+    LimitedBuffer buffer{0};
+    std::ostream stream{&buffer};
+    BOOST_CHECK_THROW(ArithHomFA::RawTLWEWriter<TFHEpp::lvl1param>{stream}, std::runtime_error);
+  }
+
+  // The error of the background thread is reported by flush()
+  BOOST_AUTO_TEST_CASE(flushReportsError) {
+    // Only the header is written
+    LimitedBuffer buffer{sizeof(ArithHomFA::RawTLWEHeader)};
+    std::ostream stream{&buffer};
+    ArithHomFA::RawTLWEWriter<TFHEpp::lvl1param> writer{stream};
+    writer.write(TFHEpp::TLWE<TFHEpp::lvl1param>{});
+    BOOST_CHECK_THROW(writer.flush(), std::runtime_error);
+  }
+
+  // Report the time to write and read a monitoring result in each format
+  BOOST_AUTO_TEST_CASE(formatBenchmark, *boost::unit_test::disabled()) {
+    const std::size_t numCiphers = 100000;
+    const TFHEpp::TLWE<TFHEpp::lvl1param> cipher{};
+    TFHEpp::TLWE<TFHEpp::lvl1param> result;
+    const auto measure = [&](const std::string &name, auto &&write, auto &&read) {
+      std::stringstream stream;
+      auto begin = std::chrono::high_resolution_clock::now();
+      write(stream);
+      const double writing =
+          std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - begin).count();
+      begin = std::chrono::high_resolution_clock::now();
+      read(stream);
+      const double reading =
+          std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - begin).count();
+      std::cout << name << ": writing " << writing / numCiphers << " us/verdict, reading " << reading / numCiphers
+                << " us/verdict" << std::endl;
+    };
+    measure(
+        "sized",
+        [&](std::ostream &stream) {
+          ArithHomFA::SizedTLWEWriter<TFHEpp::lvl1param> writer{stream};
+          for (std::size_t i = 0; i < numCiphers; ++i) {
+            writer.write(cipher);
+          }
+        },
+        [&](std::istream &stream) {
+          ArithHomFA::SizedTLWEReader<TFHEpp::lvl1param> reader{stream};
+          while (reader.read(result)) {
+          }
+        });
+    measure(
+        "raw",
+        [&](std::ostream &stream) {
+          ArithHomFA::RawTLWEWriter<TFHEpp::lvl1param> writer{stream};
+          for (std::size_t i = 0; i < numCiphers; ++i) {
+            writer.write(cipher);
+          }
+        },
+        [&](std::istream &stream) {
+          ArithHomFA::TLWEReader<TFHEpp::lvl1param> reader{stream};
+          while (reader.read(result)) {
+          }
+        });
+  }
+
 BOOST_AUTO_TEST_SUITE_END()